@@ -1,129 +1,268 @@
-#include "Bootloader.h"
-#include "gpio.h"
-
-/********* 内部函数声明 *********/
-/**
- * @brief   检查是否存在有效的升级镜像，并完成搬运及验证过程
- * @details
- *          - 从Flash中读取升级元数据（BootMeta_t）；
- *          - 判断标志位是否表示有效升级请求；
- *          - 校验镜像大小和CRC值是否合法；
- *          - 将下载区域的数据复制到应用程序区域；
- *          - 最终确认拷贝结果并清除升级标志
- * @note
- *          - 所有非法情况均提前返回，不触发升级动作；
- *          - 只有完全验证无误后才会清除升级标记
- */
-static void Bootloader_CheckAndUpgrade(void);
-/**
- * @brief   跳转到已部署的应用程序
- * @details
- *          - 获取应用程序起始地址处的栈指针和复位处理函数地址；
- *          - 进行基础栈地址范围判断以确认有效性；
- *          - 关闭中断、去初始化部分外设；
- *          - 设置MSP为主程序栈顶地址；
- *          - 更新中断向量表偏移地址；
- *          - 最终通过函数指针跳转到用户程序入口
- * @note
- *          - 必须确保目标应用已被正确烧录且头部信息完整；
- *          - 失败情况下会进入死循环并通过LED快速闪烁提示错误
- */
-static void Bootloader_JumpToApp(void);
-
-
-void Bootloader_Run(void)
-{
-
-    Bootloader_CheckAndUpgrade();
-    Bootloader_JumpToApp();
-
-    // 如果能正常跳转，这里不会执行到
-    while (1)
-    {
-        // 错误处理：比如闪灯、等待调试
-        HAL_GPIO_TogglePin(LED_GPIO_Port, LED_Pin);
-        HAL_Delay(500);
-    }
-}
-
-static void Bootloader_CheckAndUpgrade(void)
-{
-    BootMeta_t meta;
-    FlashCV_ReadMeta(&meta);
-
-    // 没有有效升级，直接 return
-    if (meta.flag != UPGRADE_FLAG_VALID)
-        return;
-
-    // 基本合法性检查
-    if (meta.image_size == 0 ||
-        (FLASH_DOWNLOAD_START_ADDR + meta.image_size) > (FLASH_DOWNLOAD_END_ADDR + 1) ||
-        (FLASH_APP_START_ADDR + meta.image_size) > (FLASH_APP_END_ADDR + 1))
-    {
-        // 元数据不合法，忽略这次升级
-        return;
-    }
-
-    // 先对下载区做一次校验
-    uint32_t crc_calc = FlashCV_CalcCRC(FLASH_DOWNLOAD_START_ADDR, meta.image_size);
-    if (crc_calc != meta.image_crc)
-    {
-        // CRC 不匹配，视为下载失败
-        return;
-    }
-
-    // 搬运固件到App区
-    if (FlashCV_CopyImageToApp(meta.image_size) != HAL_OK)
-    {
-        // 搬运失败，保留旧App
-        return;
-    }
-
-    // 再对App区做一次CRC校验
-    crc_calc = FlashCV_CalcCRC(FLASH_APP_START_ADDR, meta.image_size);
-    if (crc_calc != meta.image_crc)
-    {
-        // 拷贝后验证失败，同样不清除标志，方便上位机重新下发
-        return;
-    }
-
-    // 一切正常，清除升级标志，避免下次再升级
-    FlashCV_ClearMetaFlag();
-}
-
-/**
- * @brief   定义一个函数指针类型，用于跳转到应用程序复位处理函数
- */
-typedef void (*pFunction)(void);
-
-static void Bootloader_JumpToApp(void)
-{
-    uint32_t appStack = *(uint32_t *)FLASH_APP_START_ADDR;
-    uint32_t appResetHandler = *(uint32_t *)(FLASH_APP_START_ADDR + 4);
-
-    // 简单检查栈顶地址是否在 SRAM 范围
-    if (appStack < 0x20000000 || appStack > 0x20020000)
-    {
-        // 说明应用不存在或未正确烧录
-        while (1)
-        {
-            HAL_GPIO_TogglePin(LED_GPIO_Port, LED_Pin);
-            HAL_Delay(100);
-        }
-    }
-
-    __disable_irq();
-
-    HAL_RCC_DeInit();
-    HAL_GPIO_DeInit(LED_GPIO_Port,LED_Pin);
-
-    // 重定位中断向量表
-    SCB->VTOR = FLASH_APP_START_ADDR;
-
-    // 设置 MSP 为应用程序的栈顶
-    __set_MSP(appStack);
-
-    // 跳转到应用复位向量
-    pFunction Jump = (pFunction)appResetHandler;
-    Jump();
-}
+#include "Bootloader.h"
+#include "BootMailbox.h"
+#include "gpio.h"
+#include <string.h>
+
+/********* 内部函数声明 *********/
+/**
+ * @brief   检查是否存在有效的升级镜像，并完成搬运及验证过程
+ * @details
+ *          - 从Flash中读取升级元数据（BootMeta_t）；
+ *          - 旧版单槽元数据留下的待搬运固件（flag 为 VALID）先搬到槽A，作为一次性迁移；
+ *          - 选出启动槽：活动槽镜像有效就用活动槽，否则退到另一个槽；
+ *            试运行的新镜像多次启动都没有确认时回滚到另一个槽
+ * @return  uint32_t 要启动的镜像起始地址
+ * @note
+ *          - 所有非法情况均提前返回，不触发升级动作；
+ *          - 只有完全验证无误后才会清除升级标记；
+ *          - 搬运只用于迁移旧版单槽流程（flag 为 VALID），A/B 流程由应用提交时直接切换活动槽，
+ *            应用不会再写 VALID；
+ *          - 启动计数、处理结果和各阶段耗时写回邮箱，供应用读取
+ */
+static uint32_t Bootloader_CheckAndUpgrade(void);
+/**
+ * @brief   跳转到已部署的应用程序
+ * @details
+ *          - 获取应用程序起始地址处的栈指针和复位处理函数地址；
+ *          - 进行基础栈地址范围判断以确认有效性；
+ *          - 关闭中断、去初始化部分外设；
+ *          - 设置MSP为主程序栈顶地址；
+ *          - 更新中断向量表偏移地址；
+ *          - 最终通过函数指针跳转到用户程序入口
+ * @note
+ *          - 必须确保目标应用已被正确烧录且头部信息完整；
+ *          - 失败情况下会进入死循环并通过LED快速闪烁提示错误
+ * @param   app_addr 启动槽起始地址（向量表位置）
+ */
+static void Bootloader_JumpToApp(uint32_t app_addr);
+
+
+/**
+ * @brief   启动计时起点（DWT 周期计数）
+ */
+static uint32_t boot_t0;
+
+/********* 内部辅助：打开 DWT 周期计数器，用于各阶段计时 *********/
+static void Bootloader_TimerInit(void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0U;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    boot_t0 = DWT->CYCCNT;
+}
+
+/********* 内部辅助：从 since 到现在经过的微秒数 *********/
+static uint32_t Bootloader_ElapsedUs(uint32_t since)
+{
+    return (DWT->CYCCNT - since) / (SystemCoreClock / 1000000U);
+}
+
+void Bootloader_Run(void)
+{
+    Bootloader_TimerInit();
+    BootMailbox_Init();
+
+    Bootloader_JumpToApp(Bootloader_CheckAndUpgrade());
+
+    // 如果能正常跳转，这里不会执行到
+    while (1)
+    {
+        // 错误处理：比如闪灯、等待调试
+        HAL_GPIO_TogglePin(LED_GPIO_Port, LED_Pin);
+        HAL_Delay(500);
+    }
+}
+
+/**
+ * @brief   旧版元数据迁移：按元数据校验并把下载区的固件搬到槽A，各阶段耗时记入邮箱
+ * @details
+ *          - 旧版单槽布局的镜像都按应用区（槽A）链接，所以固定搬到槽A，完成后槽A成为活动槽；
+ *          - 擦除App区之前总是先单独校验下载区，下载区损坏则不动旧App；
+ *          - 搬运与两端CRC校验在 FlashCV_CopyImageToApp 中一趟完成
+ * @param   meta 待搬运固件的元数据
+ * @param   mb   邮箱（写入 phase_us）
+ * @return  uint32_t 处理结果 BOOT_RESULT_xxx
+ */
+static uint32_t Bootloader_Install(const BootMeta_t *meta, BootMailbox_t *mb)
+{
+    uint32_t t;
+    uint32_t src_crc, dst_crc;
+
+    // 基本合法性检查
+    if (meta->image_size == 0 ||
+        (FLASH_DOWNLOAD_START_ADDR + meta->image_size) > (FLASH_DOWNLOAD_END_ADDR + 1) ||
+        (FLASH_APP_START_ADDR + meta->image_size) > (FLASH_APP_END_ADDR + 1))
+    {
+        // 元数据不合法，忽略这次升级
+        return BOOT_RESULT_BAD_META;
+    }
+
+    // 擦除App区之前先确认下载区完好，否则旧App还能继续用
+    t = DWT->CYCCNT;
+    uint32_t crc_calc = FlashCV_CalcCRC(FLASH_DOWNLOAD_START_ADDR, meta->image_size);
+    mb->phase_us[BOOT_PHASE_VERIFY_SRC] = Bootloader_ElapsedUs(t);
+    if (crc_calc != meta->image_crc)
+    {
+        // CRC 不匹配，视为下载失败
+        return BOOT_RESULT_SRC_CRC_ERR;
+    }
+
+    // 搬运固件到App区，同时算出下载区和回读App区的CRC
+    t = DWT->CYCCNT;
+    HAL_StatusTypeDef st = FlashCV_CopyImageToApp(meta->image_size, &src_crc, &dst_crc);
+    mb->phase_us[BOOT_PHASE_COPY] = Bootloader_ElapsedUs(t);
+    if (st != HAL_OK)
+    {
+        // 搬运失败
+        return BOOT_RESULT_COPY_ERR;
+    }
+
+    if (src_crc != meta->image_crc)
+    {
+        // 下载区在校验之后、搬运途中读出错，不清除标志，下次启动重新校验
+        return BOOT_RESULT_SRC_CRC_ERR;
+    }
+
+    if (dst_crc != meta->image_crc)
+    {
+        // 拷贝后验证失败，同样不清除标志，方便上位机重新下发
+        return BOOT_RESULT_DST_CRC_ERR;
+    }
+
+    // 一切正常，清除升级标志，避免下次再升级
+    FlashCV_ClearMetaFlag();
+    return BOOT_RESULT_INSTALLED;
+}
+
+/**
+ * @brief   选出启动槽
+ * @details
+ *          - 活动槽（旧版元数据未记录时为槽A）的镜像通过槽头、向量表和整片CRC检查就从它启动；
+ *          - 活动槽在试运行（BOOT_STATE_TRIAL）时每次启动记一次尝试，已经尝试 BOOT_TRIAL_MAX 次
+ *            应用仍未确认，且另一个槽有效时，切回另一个槽（一条元数据记录），结果记为 BOOT_RESULT_ROLLBACK；
+ *          - 活动槽无效而另一个槽有效时从另一个槽启动，结果记为 BOOT_RESULT_FALLBACK；
+ *          - 两个槽都没有有效槽头时按旧版单槽布局直接启动槽A
+ * @param   meta 元数据
+ * @param   mb   邮箱（写入校验耗时，必要时写入结果）
+ * @return  uint32_t 启动槽起始地址
+ */
+static uint32_t Bootloader_SelectSlot(const BootMeta_t *meta, BootMailbox_t *mb)
+{
+    SlotHeader_t hdr;
+    uint32_t active = (meta->active_slot == BOOT_SLOT_B) ? BOOT_SLOT_B : BOOT_SLOT_A;
+    uint32_t other  = (active == BOOT_SLOT_A) ? BOOT_SLOT_B : BOOT_SLOT_A;
+    uint32_t t = DWT->CYCCNT;
+    uint32_t slot = active;
+
+    FlashCV_ReadSlot(active, &hdr);
+    if (FlashCV_SlotValid(active, &hdr))
+    {
+        if (meta->boot_state == BOOT_STATE_TRIAL)
+        {
+            if (FlashCV_BootAttempts() < BOOT_TRIAL_MAX)
+            {
+                FlashCV_MarkBootAttempt();
+            }
+            else
+            {
+                // 新镜像多次启动都没有确认：另一个槽里的旧镜像还在就切回去
+                FlashCV_ReadSlot(other, &hdr);
+                if (FlashCV_SlotValid(other, &hdr) && FlashCV_SwitchSlot(other) == HAL_OK)
+                {
+                    slot = other;
+                    mb->last_result = BOOT_RESULT_ROLLBACK;
+                }
+            }
+        }
+    }
+    else
+    {
+        FlashCV_ReadSlot(other, &hdr);
+        if (FlashCV_SlotValid(other, &hdr))
+        {
+            slot = other;
+            mb->last_result = BOOT_RESULT_FALLBACK;
+        }
+        else
+        {
+            // 没有可用槽头：旧版单槽布局，由跳转前的栈顶检查兜底
+            slot = BOOT_SLOT_A;
+        }
+    }
+
+    // 把实际启动的镜像信息带给应用（旧版单槽布局没有槽头，全为0）
+    FlashCV_ReadSlot(slot, &hdr);
+    mb->image_size = (hdr.magic == SLOT_HEADER_MAGIC) ? hdr.image_size : 0U;
+    mb->image_crc  = (hdr.magic == SLOT_HEADER_MAGIC) ? hdr.image_crc  : 0U;
+    mb->version    = (hdr.magic == SLOT_HEADER_MAGIC) ? hdr.version    : 0U;
+
+    mb->phase_us[BOOT_PHASE_VERIFY_DST] = Bootloader_ElapsedUs(t);
+    return FlashCV_SlotAddr(slot);
+}
+
+static uint32_t Bootloader_CheckAndUpgrade(void)
+{
+    BootMeta_t meta;
+    BootMailbox_t mb;
+    uint32_t t = DWT->CYCCNT;
+
+    // 邮箱无效（上电）时内容已清零，启动计数从头开始
+    BootMailbox_Read(&mb);
+    mb.boot_count++;
+    mb.last_result = BOOT_RESULT_NONE;
+    memset(mb.phase_us, 0, sizeof(mb.phase_us));
+
+    FlashCV_ReadMeta(&meta);
+    mb.reserved = 0U;
+    mb.phase_us[BOOT_PHASE_META] = Bootloader_ElapsedUs(t);
+
+    // 只有旧版单槽元数据会带着 VALID 标志，搬到槽A后按A/B流程启动
+    if (meta.flag == UPGRADE_FLAG_VALID)
+    {
+        mb.last_result = Bootloader_Install(&meta, &mb);
+        FlashCV_ReadMeta(&meta);    // 搬运成功后活动槽已改为槽A
+    }
+
+    uint32_t app_addr = Bootloader_SelectSlot(&meta, &mb);
+
+    mb.phase_us[BOOT_PHASE_TOTAL] = Bootloader_ElapsedUs(boot_t0);
+    BootMailbox_Write(&mb);
+    return app_addr;
+}
+
+/**
+ * @brief   定义一个函数指针类型，用于跳转到应用程序复位处理函数
+ */
+typedef void (*pFunction)(void);
+
+static void Bootloader_JumpToApp(uint32_t app_addr)
+{
+    uint32_t appStack = *(uint32_t *)app_addr;
+    uint32_t appResetHandler = *(uint32_t *)(app_addr + 4);
+
+    // 简单检查栈顶地址是否在 SRAM 范围
+    if (appStack < 0x20000000 || appStack > 0x20020000)
+    {
+        // 说明应用不存在或未正确烧录
+        while (1)
+        {
+            HAL_GPIO_TogglePin(LED_GPIO_Port, LED_Pin);
+            HAL_Delay(100);
+        }
+    }
+
+    __disable_irq();
+
+    HAL_RCC_DeInit();
+    HAL_GPIO_DeInit(LED_GPIO_Port,LED_Pin);
+
+    // 重定位中断向量表到启动槽
+    SCB->VTOR = app_addr;
+
+    // 设置 MSP 为应用程序的栈顶
+    __set_MSP(appStack);
+
+    // 跳转到应用复位向量
+    pFunction Jump = (pFunction)appResetHandler;
+    Jump();
+}
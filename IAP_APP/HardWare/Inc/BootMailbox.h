@@ -0,0 +1,74 @@
+#ifndef __BOOT_MAILBOX_H
+#define __BOOT_MAILBOX_H
+
+#include "stm32f4xx_hal.h"
+
+/**
+ * @brief 备份SRAM邮箱：应用与 Bootloader 之间跨复位交换状态
+ * @note  备份SRAM在 NVIC_SystemReset 后内容保持，读写只需几微秒，不用擦写Flash；
+ *        上电（无 VBAT）后内容随机，CRC校验失败即视为空邮箱。
+ *        邮箱只用来把 Bootloader 的启动信息带给应用，升级与切换槽都以Flash元数据为准
+ */
+#define BOOT_MAILBOX_ADDR        BKPSRAM_BASE      // 备份SRAM起始地址（4KB）
+#define BOOT_MAILBOX_MAGIC       0xB007B0C5UL      // 邮箱有效标识
+
+/**
+ * @brief Bootloader 本次启动的处理结果（BootMailbox_t.last_result）
+ */
+#define BOOT_RESULT_NONE         0U                // 没有待搬运的固件
+#define BOOT_RESULT_INSTALLED    1U                // 旧版元数据中待搬运的固件已搬到槽A并校验通过
+#define BOOT_RESULT_BAD_META     2U                // 镜像信息不合法，忽略
+#define BOOT_RESULT_SRC_CRC_ERR  3U                // 下载区CRC错误
+#define BOOT_RESULT_COPY_ERR     4U                // 搬运失败
+#define BOOT_RESULT_DST_CRC_ERR  5U                // 搬运后应用区CRC错误
+#define BOOT_RESULT_FALLBACK     6U                // 活动槽镜像无效，从另一个槽启动
+#define BOOT_RESULT_ROLLBACK     7U                // 新镜像试运行次数用完仍未确认，已切回另一个槽
+
+/**
+ * @brief Bootloader 启动各阶段（BootMailbox_t.phase_us 的下标）
+ */
+typedef enum {
+    BOOT_PHASE_META = 0,          /*!< 读取Flash元数据 */
+    BOOT_PHASE_VERIFY_SRC,        /*!< 下载区CRC预校验（仅旧版元数据迁移） */
+    BOOT_PHASE_COPY,              /*!< 擦除应用区并搬运（仅旧版元数据迁移） */
+    BOOT_PHASE_VERIFY_DST,        /*!< 启动槽镜像校验（槽头 + 向量表 + 整片CRC） */
+    BOOT_PHASE_TOTAL,             /*!< Bootloader 从开始到跳转前的总时间 */
+    BOOT_PHASE_COUNT
+} BootPhase_t;
+
+/**
+ * @brief 备份SRAM邮箱内容
+ */
+typedef struct {
+    uint32_t magic;                        /*!< BOOT_MAILBOX_MAGIC */
+    uint32_t reserved;                     /*!< 保留（原搬运请求），恒为0，保持 CMD_QUERY_BOOT 的应答布局 */
+    uint32_t image_size;                   /*!< 本次启动镜像的大小（字节，取自槽头；旧版单槽布局为0） */
+    uint32_t image_crc;                    /*!< 本次启动镜像的CRC32 */
+    uint32_t version;                      /*!< 本次启动镜像的版本号 */
+    uint32_t boot_count;                   /*!< Bootloader 启动次数（邮箱失效时从0重新计数） */
+    uint32_t last_result;                  /*!< 最近一次启动的处理结果 BOOT_RESULT_xxx */
+    uint32_t phase_us[BOOT_PHASE_COUNT];   /*!< 最近一次启动各阶段耗时（微秒），未执行的阶段为0 */
+    uint32_t crc;                          /*!< 以上字段的CRC32 */
+} BootMailbox_t;
+
+/**
+ * @brief 打开备份域写访问和备份SRAM时钟
+ * @note  每次上电/复位后、访问邮箱之前调用一次（HAL_RCC_DeInit 会关掉备份SRAM时钟）
+ */
+void BootMailbox_Init(void);
+
+/**
+ * @brief 读取邮箱
+ * @param[out] mb 邮箱内容；邮箱无效时清零
+ * @return uint8_t 1: magic 与 CRC 都正确；0: 邮箱无效
+ */
+uint8_t BootMailbox_Read(BootMailbox_t *mb);
+
+/**
+ * @brief 写入邮箱
+ * @note  由本函数填写 magic 和 crc
+ * @param[in,out] mb 邮箱内容
+ */
+void BootMailbox_Write(BootMailbox_t *mb);
+
+#endif /* __BOOT_MAILBOX_H */
@@ -0,0 +1,87 @@
+#ifndef __DELTA_PATCH_H
+#define __DELTA_PATCH_H
+
+#include "stm32f4xx_hal.h"
+
+/**
+ * @brief 差分补丁的流式应用
+ * @note  补丁是 bsdiff 风格的顺序格式：16字节头部 {magic, 基线大小, 基线CRC, 新镜像大小}，
+ *        之后是若干记录 {add_len, extra_len, seek}（各4字节）+ add_len 个差值字节 + extra_len 个新字节。
+ *        差值字节与基线对应位置的字节相加（按字节取模）得到新字节，每条记录结束后基线位置移动 seek。
+ *        补丁可以按任意长度分段喂入；基线直接从Flash读取，输出先攒在 DELTA_OUT_BUF_SIZE 的缓冲区里，
+ *        满了或每段结束时交给输出回调，整个过程只占用几百字节SRAM
+ */
+
+/**
+ * @brief 补丁头标识 "BDF1"
+ */
+#define DELTA_PATCH_MAGIC     0x31464442UL
+
+/**
+ * @brief 输出缓冲区大小（字节）
+ */
+#ifndef DELTA_OUT_BUF_SIZE
+#define DELTA_OUT_BUF_SIZE    256U
+#endif
+
+/**
+ * @brief 输出回调：把打好补丁的一段连续数据写到 offset 处
+ * @param offset 新镜像中的偏移
+ * @param data 数据（指向内部缓冲区）
+ * @param len 长度，不超过 DELTA_OUT_BUF_SIZE
+ * @return HAL_StatusTypeDef 非 HAL_OK 时补丁应用器进入错误状态
+ */
+typedef HAL_StatusTypeDef (*DeltaPatch_Sink_t)(uint32_t offset, const uint8_t *data, uint32_t len);
+
+/**
+ * @brief 补丁应用器状态
+ */
+typedef struct {
+    uint8_t           buf[DELTA_OUT_BUF_SIZE];  /*!< 尚未交给输出回调的新数据 */
+    uint32_t          buf_len;     /*!< 缓冲区中的字节数 */
+    const uint8_t    *base;        /*!< 基线镜像（当前运行槽） */
+    uint32_t          base_size;   /*!< 基线镜像大小 */
+    uint32_t          base_crc;    /*!< 基线镜像CRC32，必须与补丁头一致 */
+    uint32_t          base_pos;    /*!< 当前基线位置 */
+    uint32_t          out;         /*!< 已生成的新数据字节数 */
+    uint32_t          out_limit;   /*!< 新镜像大小 */
+    uint32_t          field[4];    /*!< 正在解析的头部 / 记录字段 */
+    uint8_t           field_pos;   /*!< 已收到的字段字节数 */
+    uint32_t          add_len;     /*!< 当前记录剩余的差值字节数 */
+    uint32_t          extra_len;   /*!< 当前记录剩余的新字节数 */
+    uint8_t           state;       /*!< 解析状态（内部使用） */
+    uint8_t           error;       /*!< 1: 数据错误或写入失败，之后的输入全部拒绝 */
+    DeltaPatch_Sink_t sink;        /*!< 输出回调 */
+} DeltaPatch_t;
+
+/**
+ * @brief 初始化补丁应用器
+ * @param p 补丁应用器状态
+ * @param base 基线镜像起始地址
+ * @param base_size 基线镜像大小（字节）
+ * @param base_crc 基线镜像CRC32（槽头中记录的值）
+ * @param out_limit 新镜像大小（字节）
+ * @param sink 输出回调
+ */
+void DeltaPatch_Init(DeltaPatch_t *p, const uint8_t *base, uint32_t base_size, uint32_t base_crc,
+                     uint32_t out_limit, DeltaPatch_Sink_t sink);
+
+/**
+ * @brief 喂入一段补丁数据
+ * @note  整段处理完后把缓冲区中的新数据全部交给输出回调，返回时生成的数据都已写出
+ * @param p 补丁应用器状态
+ * @param data 补丁数据
+ * @param len 长度（字节）
+ * @return HAL_StatusTypeDef HAL_OK 表示整段处理成功；补丁头与基线不符、基线位置越界、
+ *         输出超过 out_limit 或输出回调失败时返回 HAL_ERROR
+ */
+HAL_StatusTypeDef DeltaPatch_Feed(DeltaPatch_t *p, const uint8_t *data, uint32_t len);
+
+/**
+ * @brief 补丁是否已完整应用
+ * @param p 补丁应用器状态
+ * @return uint8_t 1: 停在记录边界且生成了 out_limit 字节；0: 还没结束或出错
+ */
+uint8_t DeltaPatch_Done(const DeltaPatch_t *p);
+
+#endif /* __DELTA_PATCH_H */
@@ -1,77 +1,451 @@
-#ifndef __FLASH_CV_H
-#define __FLASH_CV_H
-
-#include "stm32f4xx_hal.h"
-
-/**
- * @brief Flash 各区域起始与结束地址定义
- */
-#define FLASH_BOOT_START_ADDR      0x08000000UL      // Bootloader 区域起始地址（扇区0~1）
-#define FLASH_BOOT_END_ADDR        0x08007FFFUL      // Bootloader 区域结束地址
-
-#define FLASH_APP_START_ADDR       0x08008000UL      // 应用程序区域起始地址（扇区2~4）
-#define FLASH_APP_END_ADDR         0x0801FFFFUL      // 应用程序区域结束地址
-
-#define FLASH_META_ADDR            0x08007F00UL      // 元数据存储地址（位于扇区1末尾，占用256字节）
-#define FLASH_DOWNLOAD_START_ADDR  0x08020000UL      // 下载缓冲区起始地址（扇区5~6）
-#define FLASH_DOWNLOAD_END_ADDR    0x0805FFFFUL      // 下载缓冲区结束地址
-
-/**
- * @brief 升级状态标识符
- */
-#define UPGRADE_FLAG_EMPTY   0xFFFFFFFFUL           // 空闲状态，无升级任务
-#define UPGRADE_FLAG_VALID   0xA5A5A5A5UL           // 表示存在有效的待升级固件
-#define UPGRADE_FLAG_DONE    0x55AA55AAUL           // 表示固件已成功搬运至应用程序区
-
-/**
- * @brief 固件升级元数据结构体定义
- */
-typedef struct {
-    uint32_t flag;         /*!< 升级标志位 */
-    uint32_t image_size;   /*!< 待升级固件大小（单位：字节）*/
-    uint32_t image_crc;    /*!< 固件校验值（CRC32） */
-    uint32_t version;      /*!< 固件版本号 */
-    uint32_t reserved[4];  /*!< 预留字段，可用于扩展功能 */
-} BootMeta_t;
-
-/**
- * @brief 读取当前Flash中的元数据
- * @param[out] meta 输出参数，指向用于保存读取结果的结构体
- */
-void FlashCV_ReadMeta(BootMeta_t *meta);
-
-/**
- * @brief 写入新的元数据到Flash指定位置（Sector1）
- * @param[in] meta 指向待写入的元数据结构体
- * @return HAL_StatusTypeDef 返回操作状态
- */
-HAL_StatusTypeDef FlashCV_WriteMeta(const BootMeta_t *meta);
-
-/**
- * @brief 清除升级标志位，将flag从VALID改为DONE
- * @return HAL_StatusTypeDef 返回操作状态
- */
-HAL_StatusTypeDef FlashCV_ClearMetaFlag(void);
-
-/**
- * @brief 擦除应用区域（Sector2~4）
- * @return HAL_StatusTypeDef 返回操作状态
- */
-HAL_StatusTypeDef FlashCV_EraseAppArea(void);
-
-/**
- * @brief 将下载区的固件复制到应用程序区
- * @param[in] img_size 待搬运固件的实际大小（字节）
- * @return HAL_StatusTypeDef 返回操作状态
- */
-HAL_StatusTypeDef FlashCV_CopyImageToApp(uint32_t img_size);
-
-/**
- * @brief 使用CRC32算法计算一段Flash内存的数据校验值
- * @param[in] start_addr 起始地址
- * @param[in] length 数据长度（字节）
- * @return uint32_t 计算得到的CRC32值
- */
-uint32_t FlashCV_CalcCRC(uint32_t start_addr, uint32_t length);
-
-#endif /* __FLASH_CV_H */
+#ifndef __FLASH_CV_H
+#define __FLASH_CV_H
+
+#include "stm32f4xx_hal.h"
+
+/**
+ * @brief Flash 各区域起始与结束地址定义
+ */
+#define FLASH_BOOT_START_ADDR      0x08000000UL      // Bootloader 区域起始地址（扇区0~1）
+#define FLASH_BOOT_END_ADDR        0x08007FFFUL      // Bootloader 区域结束地址
+
+#define FLASH_APP_START_ADDR       0x08008000UL      // 应用程序区域起始地址（扇区2~4）
+#define FLASH_APP_END_ADDR         0x0801FFFFUL      // 应用程序区域结束地址
+
+#define FLASH_META_ADDR            0x08007F00UL      // 旧版元数据地址（扇区1末尾），只在日志为空时读一次用于迁移
+#define FLASH_JOURNAL_ADDR         0x08040000UL      // 元数据日志区起始地址（扇区6~7，两个扇区轮流使用）
+#define FLASH_JOURNAL_SIZE         0x00020000UL      // 每个日志扇区的大小（128KB）
+#define FLASH_JOURNAL_SECTOR       FLASH_SECTOR_6    // 第一个日志扇区，第二个紧随其后
+#define FLASH_JOURNAL_BANKS        2U                // 日志扇区个数
+#define FLASH_DOWNLOAD_START_ADDR  0x08020000UL      // 下载缓冲区起始地址（扇区5）
+#define FLASH_DOWNLOAD_END_ADDR    0x0803FFFFUL      // 下载缓冲区结束地址
+
+#define FLASHCV_SECTOR_COUNT       8U                // F407VE 共8个扇区（16/16/16/16/64/128/128/128 KB）
+
+/**
+ * @brief A/B 双槽：槽A即应用区（扇区2~4，96KB），槽B即下载区（扇区5，128KB）
+ * @note  两个槽各自链接一份镜像（BOOTL_APP / BOOTL_APP_B），Bootloader 直接从活动槽启动；
+ *        升级写入非活动槽，提交时只追加一条元数据记录，不再整片搬运
+ */
+#define BOOT_SLOT_A                0U                // 槽A
+#define BOOT_SLOT_B                1U                // 槽B
+#define BOOT_SLOT_COUNT            2U
+#define BOOT_SLOT_NONE             0xFFFFFFFFUL      // 旧版元数据没有记录活动槽，按槽A处理
+
+#define FLASH_SLOT_A_ADDR          FLASH_APP_START_ADDR
+#define FLASH_SLOT_A_SIZE          (FLASH_APP_END_ADDR - FLASH_APP_START_ADDR + 1UL)
+#define FLASH_SLOT_B_ADDR          FLASH_DOWNLOAD_START_ADDR
+#define FLASH_SLOT_B_SIZE          (FLASH_DOWNLOAD_END_ADDR - FLASH_DOWNLOAD_START_ADDR + 1UL)
+
+#define SLOT_HEADER_MAGIC          0x5107AB01UL      // 槽头有效标识
+
+/**
+ * @brief 新镜像的试运行状态（BootMeta_t.boot_state）
+ * @note  提交升级后活动槽处于 TRIAL，应用确认运行正常后改为 CONFIRMED；
+ *        除 TRIAL 以外的任何值（含旧版元数据的0xFFFFFFFF）都按已确认处理。
+ *        TRIAL 状态下 Bootloader 每启动一次记一次尝试，满 BOOT_TRIAL_MAX 次仍未确认就切回另一个槽
+ */
+#define BOOT_STATE_CONFIRMED       0xC0F1B007UL      // 活动槽镜像已确认运行正常
+#define BOOT_STATE_TRIAL           0x7E57B007UL      // 活动槽镜像试运行中，等待应用确认
+
+#ifndef BOOT_TRIAL_MAX
+#define BOOT_TRIAL_MAX             3U                // 试运行最多启动次数（不超过32）
+#endif
+
+/**
+ * @brief 升级状态标识符
+ */
+#define UPGRADE_FLAG_EMPTY   0xFFFFFFFFUL           // 空闲状态，无升级任务
+#define UPGRADE_FLAG_VALID   0xA5A5A5A5UL           // 表示存在有效的待升级固件
+#define UPGRADE_FLAG_DONE    0x55AA55AAUL           // 表示固件已成功搬运至应用程序区
+
+/**
+ * @brief 下载区擦除状态（BootMeta_t.slot_state）
+ * @note  除 CLEAN 以外的任何值（含未初始化的0xFFFFFFFF）都按 DIRTY 处理
+ */
+#define DOWNLOAD_SLOT_CLEAN  0xC1EAC1EAUL           // 下载区已整体擦除，可直接写入
+#define DOWNLOAD_SLOT_DIRTY  0x00000000UL           // 下载区可能有数据，写入前需要擦除
+
+/**
+ * @brief 升级会话的接收进度（保存在最新一条元数据日志记录中）
+ * @note  进度位图只做 1->0 的原地编程，bit=0 表示对应的 FLASHCV_PROGRESS_BLOCK 字节
+ *        已完整写入下载区
+ */
+#define FLASHCV_PROGRESS_BLOCK  1024U                        // 进度位图每位覆盖的字节数
+#define FLASHCV_PROGRESS_WORDS  ((FLASH_SLOT_B_SIZE / FLASHCV_PROGRESS_BLOCK + 31U) / 32U)  // 4 字 128 位，覆盖较大的槽B（128KB）
+#define SESSION_MAGIC           0x5E551017UL                 // 会话记录有效标识
+
+/**
+ * @brief CRC32 计算后端（编译期选择）
+ * @note  0: 仅软件查表
+ *        1: 对齐的整字交给硬件CRC单元，输出做位反转后与 zlib.crc32 一致；
+ *           硬件单元被占用（如中断里的帧校验）或数据太短时自动回退软件查表
+ */
+#ifndef FLASHCV_CRC_USE_HW
+#define FLASHCV_CRC_USE_HW   1
+#endif
+
+#define FLASHCV_CRC_HW_MIN_LEN   64U   // 短于该长度时硬件装载初值的开销不划算，直接走软件
+
+/**
+ * @brief CRC32 查表切片数（编译期选择）
+ * @note  1: 单表逐字节，仅用 1KB 常量表
+ *        4: slicing-by-4，额外占用 3KB SRAM 查表
+ *        8: slicing-by-8，额外占用 7KB SRAM 查表
+ *        默认随后端选择：用硬件CRC时长数据的整字都交给硬件，软件只算短帧、头尾零头和
+ *        抢不到硬件时的中断帧校验，选 1 省下 7KB SRAM；纯软件（FLASHCV_CRC_USE_HW=0）时用 8。
+ *        可在 CMakeLists.txt 中通过 FLASHCV_CRC_SLICES 覆盖
+ */
+#ifndef FLASHCV_CRC_SLICES
+#if FLASHCV_CRC_USE_HW
+#define FLASHCV_CRC_SLICES   1
+#else
+#define FLASHCV_CRC_SLICES   8
+#endif
+#endif
+
+#if (FLASHCV_CRC_SLICES != 1) && (FLASHCV_CRC_SLICES != 4) && (FLASHCV_CRC_SLICES != 8)
+#error "FLASHCV_CRC_SLICES must be 1, 4 or 8"
+#endif
+
+/**
+ * @brief 擦写Flash期间用 BASEPRI 屏蔽的中断优先级门限
+ * @note  优先级数值 >= 该值的中断在擦写期间挂起，结束后再执行。RTOS 的 SysTick/PendSV 和 HAL 时基 TIM7
+ *        都是15，处理函数和内核代码在Flash中，一旦进入就会卡在取指上，连更高优先级的串口中断也进不来；
+ *        串口和DMA中断（10）在SRAM中，不受影响。代价是擦除期间的系统节拍会丢失
+ */
+#ifndef FLASHCV_BUSY_MASK_PRIO
+#define FLASHCV_BUSY_MASK_PRIO   11U
+#endif
+
+/**
+ * @brief 搬运固件时每块的大小（字节，4的整数倍），占用同样大小的SRAM缓冲区
+ */
+#ifndef FLASHCV_COPY_BLOCK
+#define FLASHCV_COPY_BLOCK       1024U
+#endif
+
+/**
+ * @brief 固件升级元数据结构体定义
+ */
+typedef struct {
+    uint32_t flag;         /*!< 升级标志位 */
+    uint32_t image_size;   /*!< 待升级固件大小（单位：字节）*/
+    uint32_t image_crc;    /*!< 固件校验值（CRC32） */
+    uint32_t version;      /*!< 固件版本号 */
+    uint32_t slot_state;   /*!< 下载区（非活动槽）擦除状态：DOWNLOAD_SLOT_CLEAN / DOWNLOAD_SLOT_DIRTY */
+    uint32_t active_slot;  /*!< 活动槽 BOOT_SLOT_A / BOOT_SLOT_B；BOOT_SLOT_NONE 表示旧版单槽布局 */
+    uint32_t boot_state;   /*!< 活动槽试运行状态：BOOT_STATE_TRIAL / BOOT_STATE_CONFIRMED */
+    uint32_t reserved[1];  /*!< 预留字段，可用于扩展功能 */
+} BootMeta_t;
+
+/**
+ * @brief 槽头：记录槽中镜像的大小、CRC和版本（保存在元数据日志记录中）
+ */
+typedef struct {
+    uint32_t magic;        /*!< SLOT_HEADER_MAGIC 表示槽中有已校验的完整镜像 */
+    uint32_t image_size;   /*!< 镜像大小（字节） */
+    uint32_t image_crc;    /*!< 镜像CRC32 */
+    uint32_t version;      /*!< 镜像版本号 */
+} SlotHeader_t;
+
+/**
+ * @brief 升级会话记录：同一固件（大小 + CRC + 版本都相同）断线或复位后可以续传
+ */
+typedef struct {
+    uint32_t magic;        /*!< SESSION_MAGIC 表示有效 */
+    uint32_t image_size;   /*!< 固件大小（字节） */
+    uint32_t image_crc;    /*!< 固件CRC32 */
+    uint32_t version;      /*!< 固件版本号 */
+    uint32_t slot;         /*!< 写入的目标槽 BOOT_SLOT_A / BOOT_SLOT_B */
+} BootSession_t;
+
+/**
+ * @brief 元数据日志记录
+ * @note  元数据每次变化都在日志扇区末尾追加一条，读取时取 CRC 正确的最后一条；
+ *        扇区写满才擦除一次，只把最新状态写回第一条。progress 和 attempts 不在 CRC 范围内，
+ *        收齐一个进度块 / 试运行启动一次就在最新记录里原地清一位
+ */
+typedef struct {
+    uint32_t      seq;                               /*!< 序号，逐条递增；0xFFFFFFFF 表示空白槽 */
+    BootMeta_t    meta;                              /*!< 元数据 */
+    BootSession_t session;                           /*!< 升级会话（magic 不是 SESSION_MAGIC 时无效） */
+    SlotHeader_t  slot[BOOT_SLOT_COUNT];             /*!< 两个槽的槽头 */
+    uint32_t      crc;                               /*!< seq、meta、session、slot 的CRC32 */
+    uint32_t      progress[FLASHCV_PROGRESS_WORDS];  /*!< 进度位图，bit=0 表示已收齐 */
+    uint32_t      attempts;                          /*!< 试运行启动次数位图，每启动一次清一位 */
+} MetaRecord_t;
+
+/**
+ * @brief 把中断向量表复制到SRAM并切换 VTOR
+ * @note  在 main 开头、开中断之前调用，同时一次生成CRC切片查表。配合链接脚本把本模块和串口中断链放进SRAM，
+ *        擦写Flash期间这些中断仍能响应；仍在Flash中的中断会等到擦写结束才执行
+ */
+void FlashCV_RamInit(void);
+
+/**
+ * @brief 查询是否正在擦写Flash
+ * @note  供SRAM中的中断处理使用：擦除或编程期间（包括后台预擦除和日志换扇区）返回1，
+ *        此时调用RTOS接口等仍在Flash中的代码会让中断卡到擦写结束，应推迟到任务里处理
+ * @return uint8_t 1: 擦写进行中
+ */
+uint8_t FlashCV_IsBusy(void);
+
+/**
+ * @brief 读取当前Flash中的元数据
+ * @note  二分查找日志中的第一个空白槽，再往前取 CRC 正确的最后一条；
+ *        日志中没有有效记录时读取旧版元数据页
+ * @param[out] meta 输出参数，指向用于保存读取结果的结构体
+ */
+void FlashCV_ReadMeta(BootMeta_t *meta);
+
+/**
+ * @brief 写入新的元数据：在日志扇区（Sector7）追加一条记录
+ * @note  只编程一条记录（约几百微秒），日志扇区写满时才擦除一次；
+ *        写元数据同时结束升级会话
+ * @param[in] meta 指向待写入的元数据结构体
+ * @return HAL_StatusTypeDef 返回操作状态
+ */
+HAL_StatusTypeDef FlashCV_WriteMeta(const BootMeta_t *meta);
+
+/**
+ * @brief 清除升级标志位，将flag从VALID改为DONE
+ * @note  旧版搬运流程专用：镜像已搬到槽A，同时把槽A记为活动槽并写入槽头
+ * @return HAL_StatusTypeDef 返回操作状态
+ */
+HAL_StatusTypeDef FlashCV_ClearMetaFlag(void);
+
+/**
+ * @brief 把下载区标记为已擦除（CLEAN）
+ * @note  只在后台预擦除整个下载区之后调用一次，同时结束升级会话
+ * @return HAL_StatusTypeDef 返回操作状态
+ */
+HAL_StatusTypeDef FlashCV_MarkDownloadClean(void);
+
+/**
+ * @brief 把下载区标记为已写脏（DIRTY）
+ * @note  追加一条日志记录，会话和进度原样保留；任何写入下载区的操作之前都要先调用
+ * @return HAL_StatusTypeDef 返回操作状态
+ */
+HAL_StatusTypeDef FlashCV_MarkDownloadDirty(void);
+
+/**
+ * @brief 读取升级会话记录和进度位图
+ * @param[out] session 会话记录
+ * @param[out] progress 进度位图，FLASHCV_PROGRESS_WORDS 个字（可为 NULL）
+ */
+void FlashCV_ReadSession(BootSession_t *session, uint32_t *progress);
+
+/**
+ * @brief 开始一个新的升级会话：把下载区标为 DIRTY 并写入会话记录
+ * @note  一条日志记录完成，进度位图清空；目标槽（session->slot）的槽头同时作废
+ * @param[in] session 会话记录（magic 由本函数填写）
+ * @return HAL_StatusTypeDef 返回操作状态
+ */
+HAL_StatusTypeDef FlashCV_BeginSession(const BootSession_t *session);
+
+/**
+ * @brief 作废会话记录
+ * @note  追加一条不带会话的日志记录；下载区即将被擦除时调用
+ * @return HAL_StatusTypeDef 返回操作状态
+ */
+HAL_StatusTypeDef FlashCV_DropSession(void);
+
+/**
+ * @brief 记录一个进度块已完整写入下载区
+ * @note  把最新日志记录的进度位图中对应位原地编程为0，不追加记录
+ * @param[in] index 进度块序号（偏移 / FLASHCV_PROGRESS_BLOCK）
+ * @return HAL_StatusTypeDef 返回操作状态
+ */
+HAL_StatusTypeDef FlashCV_MarkProgress(uint32_t index);
+
+/**
+ * @brief 槽的起始地址
+ * @param[in] slot BOOT_SLOT_A / BOOT_SLOT_B
+ * @return uint32_t 起始地址（向量表所在位置）
+ */
+uint32_t FlashCV_SlotAddr(uint32_t slot);
+
+/**
+ * @brief 槽的大小
+ * @param[in] slot BOOT_SLOT_A / BOOT_SLOT_B
+ * @return uint32_t 字节数
+ */
+uint32_t FlashCV_SlotSize(uint32_t slot);
+
+/**
+ * @brief 读取槽头
+ * @param[in] slot BOOT_SLOT_A / BOOT_SLOT_B
+ * @param[out] hdr 槽头；日志中没有记录时 magic 为0
+ */
+void FlashCV_ReadSlot(uint32_t slot, SlotHeader_t *hdr);
+
+/**
+ * @brief 检查槽中镜像：槽头有效、大小不越界、栈顶和复位向量落在合理范围、整片CRC与槽头一致
+ * @param[in] slot BOOT_SLOT_A / BOOT_SLOT_B
+ * @param[in] hdr 槽头
+ * @return uint8_t 1: 可以启动；0: 不可用
+ */
+uint8_t FlashCV_SlotValid(uint32_t slot, const SlotHeader_t *hdr);
+
+/**
+ * @brief 检查镜像是否按该槽链接：栈顶在SRAM内、复位向量落在 [槽起始, 槽起始 + image_size) 内
+ * @note  槽A/槽B的镜像互不通用，写错槽的镜像在这里被拒绝
+ * @param[in] slot BOOT_SLOT_A / BOOT_SLOT_B
+ * @param[in] image_size 镜像大小（字节）
+ * @return uint8_t 1: 向量表合理；0: 不是为该槽链接的镜像
+ */
+uint8_t FlashCV_CheckVectors(uint32_t slot, uint32_t image_size);
+
+/**
+ * @brief 作废槽头
+ * @note  槽即将被擦除时调用；该槽正是活动槽时把活动槽改为另一个槽
+ * @param[in] slot BOOT_SLOT_A / BOOT_SLOT_B
+ * @return HAL_StatusTypeDef 返回操作状态
+ */
+HAL_StatusTypeDef FlashCV_InvalidateSlot(uint32_t slot);
+
+/**
+ * @brief 提交升级：写入槽头并把该槽设为活动槽
+ * @note  一条日志记录完成（元数据翻转），同时结束升级会话；元数据中的镜像信息换成新镜像，
+ *        原活动槽成为下一次的下载目标，标记为 DIRTY，其中的旧镜像和槽头保留用于回滚；
+ *        新镜像进入试运行（BOOT_STATE_TRIAL），启动次数清零
+ * @param[in] slot 新镜像所在槽
+ * @param[in] hdr 新镜像的槽头（magic 由本函数填写）
+ * @return HAL_StatusTypeDef 返回操作状态
+ */
+HAL_StatusTypeDef FlashCV_CommitSlot(uint32_t slot, const SlotHeader_t *hdr);
+
+/**
+ * @brief 试运行状态下 Bootloader 已经尝试启动活动槽的次数
+ * @return uint32_t 次数（attempts 位图中为0的位数）
+ */
+uint32_t FlashCV_BootAttempts(void);
+
+/**
+ * @brief 记录一次试运行启动
+ * @note  把最新日志记录的 attempts 位图原地清一位，不追加记录
+ * @return HAL_StatusTypeDef 返回操作状态
+ */
+HAL_StatusTypeDef FlashCV_MarkBootAttempt(void);
+
+/**
+ * @brief 确认活动槽镜像运行正常，结束试运行
+ * @note  slot 不是活动槽或活动槽不在试运行时什么都不做
+ * @param[in] slot 当前运行的槽
+ * @return HAL_StatusTypeDef 返回操作状态
+ */
+HAL_StatusTypeDef FlashCV_ConfirmSlot(uint32_t slot);
+
+/**
+ * @brief 切换活动槽（回滚 / 恢复）
+ * @note  一条日志记录完成，不搬运数据；该槽必须有槽头。切换后的镜像视为已确认，
+ *        原活动槽的镜像和槽头保留，之后还可以再切回去
+ * @param[in] slot 新的活动槽
+ * @return HAL_StatusTypeDef 返回操作状态；该槽没有槽头时返回 HAL_ERROR
+ */
+HAL_StatusTypeDef FlashCV_SwitchSlot(uint32_t slot);
+
+/**
+ * @brief 查询地址所在扇区的结束地址（即下一个扇区的起始地址）
+ * @param[in] addr Flash地址
+ * @return uint32_t 下一个扇区的起始地址；地址不在Flash内时返回 addr
+ */
+uint32_t FlashCV_SectorEnd(uint32_t addr);
+
+/**
+ * @brief 擦除应用区域（Sector2~4）
+ * @note  已经空白的扇区会跳过
+ * @return HAL_StatusTypeDef 返回操作状态
+ */
+HAL_StatusTypeDef FlashCV_EraseAppArea(void);
+
+/**
+ * @brief 检查一段Flash是否全为 0xFF
+ * @param[in] start_addr 起始地址
+ * @param[in] length 长度（字节）
+ * @return uint8_t 1: 全部空白；0: 存在已编程的字节
+ */
+uint8_t FlashCV_IsBlank(uint32_t start_addr, uint32_t length);
+
+/**
+ * @brief 按地址范围擦除Flash
+ * @note  依据扇区表找出 [start_addr, start_addr+length) 覆盖到的扇区，逐个擦除；
+ *        若某扇区中落在该范围内的部分已经全为 0xFF 则跳过，小固件不必再擦整个区域。
+ *        函数内部完成解锁/上锁
+ * @param[in] start_addr 起始地址
+ * @param[in] length 长度（字节）
+ * @return HAL_StatusTypeDef 返回操作状态
+ */
+HAL_StatusTypeDef FlashCV_EraseRange(uint32_t start_addr, uint32_t length);
+
+/**
+ * @brief 连续编程一段Flash（需先 HAL_FLASH_Unlock）
+ * @note  整段只做一次"等待上次操作结束 + 清错误标志 + 置 PSIZE=x32/PG"，
+ *        字与字之间只轮询 BSY，结束后统一检查一次错误标志；
+ *        末尾不足4字节的部分用 0xFF 补齐。源数据可以在RAM或Flash中，不要求对齐
+ * @param[in] dst 目标Flash地址，必须4字节对齐且已擦除
+ * @param[in] src 源数据
+ * @param[in] len 数据长度（字节）
+ * @return HAL_StatusTypeDef 返回操作状态
+ */
+HAL_StatusTypeDef FlashCV_ProgramBuffer(uint32_t dst, const uint8_t *src, uint32_t len);
+
+/**
+ * @brief 将下载区的固件复制到应用程序区，同时计算源和目标的CRC32
+ * @note  只用于迁移旧版单槽元数据留下的待搬运固件：旧版镜像按应用区链接，固定搬到槽A。
+ *        按 FLASHCV_COPY_BLOCK 分块：源块读进RAM一次，累加源CRC后编程，再回读目标块累加目标CRC。
+ *        一趟完成"下载区校验 + 搬运 + 应用区校验"，Flash读取量从3遍降到2遍。
+ *        源CRC要在擦除应用区之后才知道结果，调用前必须先单独校验一遍下载区
+ * @param[in] img_size 待搬运固件的实际大小（字节）
+ * @param[out] src_crc 下载区 [0, img_size) 的CRC32（可为 NULL）
+ * @param[out] dst_crc 搬运后应用区 [0, img_size) 回读的CRC32（可为 NULL）
+ * @return HAL_StatusTypeDef 返回操作状态
+ */
+HAL_StatusTypeDef FlashCV_CopyImageToApp(uint32_t img_size, uint32_t *src_crc, uint32_t *dst_crc);
+
+/**
+ * @brief 使用CRC32算法计算一段Flash内存的数据校验值
+ * @note  与 Python zlib.crc32 结果一致；按 FLASHCV_CRC_SLICES 一次处理 4/8 字节，
+ *        起始地址不对齐时先逐字节处理到4字节边界
+ * @param[in] start_addr 起始地址
+ * @param[in] length 数据长度（字节）
+ * @return uint32_t 计算得到的CRC32值
+ */
+uint32_t FlashCV_CalcCRC(uint32_t start_addr, uint32_t length);
+
+/**
+ * @brief 增量CRC32：获取初始状态
+ * @note  用法：crc = FlashCV_CrcInit(); crc = FlashCV_CrcUpdate(crc, ...)（可多次）;
+ *        result = FlashCV_CrcFinal(crc)。分段累加的结果与 FlashCV_CalcCRC 整段计算一致
+ * @return uint32_t 初始CRC状态
+ */
+uint32_t FlashCV_CrcInit(void);
+
+/**
+ * @brief 增量CRC32：把一段数据累加到CRC状态中
+ * @param[in] crc 当前CRC状态（来自 FlashCV_CrcInit 或上一次 FlashCV_CrcUpdate）
+ * @param[in] data 数据指针（RAM 或 Flash 均可）
+ * @param[in] length 数据长度（字节）
+ * @return uint32_t 更新后的CRC状态
+ */
+uint32_t FlashCV_CrcUpdate(uint32_t crc, const uint8_t *data, uint32_t length);
+
+/**
+ * @brief 增量CRC32：由CRC状态得到最终校验值
+ * @param[in] crc 当前CRC状态
+ * @return uint32_t CRC32校验值
+ */
+uint32_t FlashCV_CrcFinal(uint32_t crc);
+
+/**
+ * @brief 合并两段数据的CRC32，效果同 zlib 的 crc32_combine
+ * @note  不需要重新读取数据：CRC(A||B) = FlashCV_CrcCombine(CRC(A), CRC(B), len(B))
+ * @param[in] crc1 前一段数据的CRC32校验值
+ * @param[in] crc2 后一段数据的CRC32校验值
+ * @param[in] len2 后一段数据的长度（字节）
+ * @return uint32_t 两段数据拼接后的CRC32校验值
+ */
+uint32_t FlashCV_CrcCombine(uint32_t crc1, uint32_t crc2, uint32_t len2);
+
+#endif /* __FLASH_CV_H */
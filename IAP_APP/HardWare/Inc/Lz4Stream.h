@@ -0,0 +1,78 @@
+#ifndef __LZ4_STREAM_H
+#define __LZ4_STREAM_H
+
+#include "stm32f4xx_hal.h"
+
+/**
+ * @brief LZ4 块格式的流式解压
+ * @note  压缩数据可以按任意长度分段喂入，解出的字节先放进固定大小的滑动窗口，
+ *        窗口满或每段结束时交给输出回调写入Flash；整个解压器只占用 LZ4S_WINDOW_SIZE
+ *        加几十字节SRAM，不依赖堆，也不回读Flash，可以直接用在 Bootloader 中。
+ *        上位机压缩时匹配距离不得超过 LZ4S_WINDOW_SIZE（标准LZ4最远 64KB，这里被限制）
+ */
+
+/**
+ * @brief 滑动窗口大小（字节，必须是2的幂）
+ * @note  需与上位机 LZ4_WINDOW 一致；窗口越大压缩率越高，占用的SRAM也越多
+ */
+#ifndef LZ4S_WINDOW_SIZE
+#define LZ4S_WINDOW_SIZE   4096U
+#endif
+
+#if (LZ4S_WINDOW_SIZE & (LZ4S_WINDOW_SIZE - 1U)) != 0U
+#error "LZ4S_WINDOW_SIZE must be a power of 2"
+#endif
+
+/**
+ * @brief 输出回调：把解压出来的一段连续数据写到 offset 处
+ * @param offset 解压后数据中的偏移
+ * @param data 数据（指向窗口内部）
+ * @param len 长度，不超过 LZ4S_WINDOW_SIZE
+ * @return HAL_StatusTypeDef 非 HAL_OK 时解压器进入错误状态
+ */
+typedef HAL_StatusTypeDef (*Lz4Stream_Sink_t)(uint32_t offset, const uint8_t *data, uint32_t len);
+
+/**
+ * @brief 解压器状态
+ */
+typedef struct {
+    uint8_t          window[LZ4S_WINDOW_SIZE];  /*!< 最近解出的数据，兼作输出暂存 */
+    uint32_t         out;         /*!< 已解出的字节数 */
+    uint32_t         flushed;     /*!< 已交给输出回调的字节数 */
+    uint32_t         out_limit;   /*!< 解压后大小上限，超出视为数据错误 */
+    uint32_t         lit_len;     /*!< 当前序列剩余的字面量字节数 */
+    uint32_t         match_len;   /*!< 当前序列的匹配长度 */
+    uint32_t         match_off;   /*!< 当前序列的匹配距离 */
+    uint8_t          state;       /*!< 解析状态（内部使用） */
+    uint8_t          error;       /*!< 1: 数据错误或写入失败，之后的输入全部拒绝 */
+    Lz4Stream_Sink_t sink;        /*!< 输出回调 */
+} Lz4Stream_t;
+
+/**
+ * @brief 初始化解压器
+ * @param s 解压器状态
+ * @param out_limit 解压后大小上限（字节）
+ * @param sink 输出回调
+ */
+void Lz4Stream_Init(Lz4Stream_t *s, uint32_t out_limit, Lz4Stream_Sink_t sink);
+
+/**
+ * @brief 喂入一段压缩数据
+ * @note  整段解析完后把窗口中尚未输出的数据全部交给输出回调，返回时解出的数据都已写出
+ * @param s 解压器状态
+ * @param data 压缩数据
+ * @param len 长度（字节）
+ * @return HAL_StatusTypeDef HAL_OK 表示整段解析成功；数据错误（匹配距离越界、
+ *         解出的数据超过 out_limit）或输出回调失败时返回 HAL_ERROR
+ */
+HAL_StatusTypeDef Lz4Stream_Feed(Lz4Stream_t *s, const uint8_t *data, uint32_t len);
+
+/**
+ * @brief 压缩流是否停在结尾
+ * @note  只检查解压器自身；解出的总字节数由调用者核对（out 字段）
+ * @param s 解压器状态
+ * @return uint8_t 1: 停在序列边界且解出的数据都已写出；0: 还没结束或出错
+ */
+uint8_t Lz4Stream_Done(const Lz4Stream_t *s);
+
+#endif /* __LZ4_STREAM_H */
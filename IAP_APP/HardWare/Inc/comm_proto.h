@@ -1,84 +1,266 @@
-/* comm_proto.h */
-#ifndef __COMM_PROTO_H
-#define __COMM_PROTO_H
-
-#include "stm32f4xx_hal.h"
-#include <stdint.h>
-
-#ifdef __cplusplus
-extern "C" {
-#endif
-
-    /**
-     * @brief 通信协议帧头定义
-     */
-#define COMM_HEAD1        0x55  /*!< 帧头第一个字节 */
-#define COMM_HEAD2        0xAA  /*!< 帧头第二个字节 */
-
-    /**
-     * @brief 通信命令字定义
-     */
-#define CMD_HANDSHAKE      0x01  /*!< 握手命令 */
-#define CMD_START_UPDATE   0x02  /*!< 开始升级命令 */
-#define CMD_DATA           0x03  /*!< 数据传输命令 */
-#define CMD_END_UPDATE     0x04  /*!< 结束升级命令 */
-#define CMD_QUERY_VERSION  0x05  /*!< 查询版本命令 */
-#define CMD_ACK            0x06  /*!< 应答命令 */
-
-    /**
-     * @brief 通信应答状态码
-     */
-    typedef enum {
-        COMM_STATUS_OK          = 0x00,  /*!< 操作成功 */
-        COMM_STATUS_FRAME_CRC   = 0x01,  /*!< 帧CRC校验错误 */
-        COMM_STATUS_PARAM_ERR   = 0x02,  /*!< 参数错误 */
-        COMM_STATUS_FLASH_ERR   = 0x03,  /*!< Flash操作错误 */
-        COMM_STATUS_STATE_ERR   = 0x04   /*!< 状态错误 */
-    } CommStatus_t;
-
-    /**
-     * @brief 通信协议最大负载长度定义
-     */
-#define COMM_MAX_PAYLOAD_LEN   1024  /*!< 单帧最大数据负载长度(字节) */
-
-    /**
-     * @brief 初始化通信模块
-     *
-     * 配置UART接收中断，启动接收状态机
-     */
-    void Comm_Init(void);
-
-    /**
-     * @brief 接收字节处理函数
-     *
-     * 在UART接收中断中调用，用于处理接收到的每个字节
-     * @param ch 接收到的字节数据
-     */
-    void Comm_OnByteReceived(uint8_t ch);
-
-    /**
-     * @brief 发送数据帧
-     *
-     * 构造并发送完整的通信帧，自动计算并附加CRC校验
-     * @param cmd 命令字
-     * @param seq 序列号
-     * @param data 数据指针
-     * @param len 数据长度
-     */
-    void Comm_SendFrame(uint8_t cmd, uint8_t seq, const uint8_t *data, uint16_t len);
-
-    /**
-     * @brief 发送应答帧
-     *
-     * 发送ACK应答帧，包含状态信息
-     * @param cmd 原始命令字
-     * @param seq 原始序列号
-     * @param status 应答状态码
-     */
-    void Comm_SendAck(uint8_t cmd, uint8_t seq, CommStatus_t status);
-
-#ifdef __cplusplus
-}
-#endif
-
-#endif /* __COMM_PROTO_H */
+/* comm_proto.h */
+#ifndef __COMM_PROTO_H
+#define __COMM_PROTO_H
+
+#include "stm32f4xx_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    /**
+     * @brief 通信协议帧头定义
+     */
+#define COMM_HEAD1        0x55  /*!< 帧头第一个字节 */
+#define COMM_HEAD2        0xAA  /*!< 帧头第二个字节 */
+
+    /**
+     * @brief 通信命令字定义
+     */
+#define CMD_HANDSHAKE      0x01  /*!< 握手命令 */
+#define CMD_START_UPDATE   0x02  /*!< 开始升级命令 */
+#define CMD_DATA           0x03  /*!< 数据传输命令 */
+#define CMD_END_UPDATE     0x04  /*!< 结束升级命令 */
+#define CMD_QUERY_VERSION  0x05  /*!< 查询版本命令 */
+#define CMD_ACK            0x06  /*!< 应答命令 */
+#define CMD_QUERY_STATS    0x07  /*!< 查询通信统计命令 */
+#define CMD_SET_BAUD       0x08  /*!< 切换波特率命令 */
+#define CMD_BAUD_PROBE     0x09  /*!< 新波特率探测命令 */
+#define CMD_QUERY_MISSING  0x0A  /*!< 查询缺失数据区间命令 */
+#define CMD_QUERY_BOOT     0x0B  /*!< 查询启动信息命令（备份SRAM邮箱：启动计数、处理结果、各阶段耗时） */
+#define CMD_QUERY_SLOT     0x0C  /*!< 查询A/B槽信息命令（运行槽、下载目标槽） */
+#define CMD_ROLLBACK       0x0D  /*!< 回滚命令：切换到另一个槽中的镜像并复位 */
+#define CMD_QUERY_BLOCK_CRCS 0x0E /*!< 查询运行镜像按块计算的CRC32 */
+#define CMD_COPY_BLOCKS    0x0F  /*!< 把运行镜像中未变的区间复制到下载目标槽 */
+
+    /**
+     * @brief 通信应答状态码
+     */
+    typedef enum {
+        COMM_STATUS_OK          = 0x00,  /*!< 操作成功 */
+        COMM_STATUS_FRAME_CRC   = 0x01,  /*!< 帧CRC校验错误 */
+        COMM_STATUS_PARAM_ERR   = 0x02,  /*!< 参数错误 */
+        COMM_STATUS_FLASH_ERR   = 0x03,  /*!< Flash操作错误 */
+        COMM_STATUS_STATE_ERR   = 0x04   /*!< 状态错误 */
+    } CommStatus_t;
+
+    /**
+     * @brief 通信协议最大负载长度定义
+     */
+#define COMM_MAX_PAYLOAD_LEN   1024  /*!< 单帧最大数据负载长度(字节) */
+
+    /**
+     * @brief 接收帧队列槽位数
+     * @note  每个槽位可容纳一整帧，留一个空槽区分满/空，最多缓存 COMM_RX_QUEUE_LEN-1 帧
+     */
+#ifndef COMM_RX_QUEUE_LEN
+#define COMM_RX_QUEUE_LEN      8
+#endif
+
+    /**
+     * @brief 接收方式选择
+     * @note  1：USART1 RX 走 DMA2_Stream2 循环缓冲 + 空闲线检测，按批喂给解析器；
+     *        0：退回每字节一次中断的 HAL_UART_Receive_IT 方式
+     */
+#ifndef COMM_RX_USE_DMA
+#define COMM_RX_USE_DMA        1
+#endif
+
+    /**
+     * @brief DMA循环接收缓冲区大小（字节）
+     * @note  半满/全满/空闲三种事件都会触发一次解析；取两帧左右大小，
+     *        连续传输时约每帧一次中断，且中断延迟内不会被DMA追尾覆盖
+     */
+#ifndef COMM_RX_DMA_BUF_LEN
+#define COMM_RX_DMA_BUF_LEN    2048
+#endif
+
+    /**
+     * @brief 发送环形缓冲区大小（字节）
+     * @note  Comm_SendFrame 把整帧拷进缓冲区后立即返回，由 DMA2_Stream7 在后台发送；
+     *        缓冲区满时丢弃该帧并计数（上位机超时重发）
+     */
+#ifndef COMM_TX_BUF_LEN
+#define COMM_TX_BUF_LEN        2048
+#endif
+
+    /**
+     * @brief 握手能力协商块
+     * @note  上位机在握手帧数据末尾附带该结构表示请求的能力，设备在握手应答末尾
+     *        附带实际同意的取值；不带该结构的旧上位机仍按停等方式工作
+     */
+#define COMM_CAPS_MAGIC        0xC5         /*!< 能力块标识 */
+#define COMM_CAP_WINDOW        (1UL << 0)   /*!< 滑动窗口DATA传输 + 选择性应答 */
+#define COMM_CAP_BAUD          (1UL << 1)   /*!< 支持 CMD_SET_BAUD 切换波特率 */
+#define COMM_CAP_LZ4           (1UL << 2)   /*!< 支持 LZ4 压缩传输（CMD_START_UPDATE 带 encoding） */
+#define COMM_CAP_DELTA         (1UL << 3)   /*!< 支持以运行镜像为基线的差分传输 */
+#define COMM_CAP_BLOCKS        (1UL << 4)   /*!< 支持 CMD_QUERY_BLOCK_CRCS / CMD_COPY_BLOCKS 分块去重 */
+#define COMM_CAP_RELOC         (1UL << 5)   /*!< CMD_COPY_BLOCKS 支持重定位位图（按槽地址差修正绝对地址字） */
+
+    typedef struct {
+        uint8_t  magic;          /*!< 固定为 COMM_CAPS_MAGIC */
+        uint8_t  window;         /*!< 最多未确认的DATA帧数 */
+        uint16_t chunk;          /*!< 窗口模式下每个DATA帧的固定数据长度（设备取 UPDATE_BLOCK_SIZE 的整数倍） */
+        uint32_t flags;          /*!< COMM_CAP_xxx 能力位 */
+    } CommCaps_t;
+
+    /**
+     * @brief 窗口上限（帧）
+     * @note  设备逐帧处理完才应答，未确认帧不超过接收队列容量就不会因队列满丢帧；
+     *        同时受选择性应答位图宽度(32)限制
+     */
+#ifndef COMM_WIN_MAX
+#define COMM_WIN_MAX           (COMM_RX_QUEUE_LEN - 1)
+#endif
+
+    /**
+     * @brief 波特率切换参数
+     * @note  设备以旧波特率应答 CMD_SET_BAUD 后立即切换，之后 COMM_BAUD_PROBE_MS 内
+     *        没有在新波特率下收到 CMD_BAUD_PROBE 就退回 COMM_DEFAULT_BAUD
+     */
+#define COMM_DEFAULT_BAUD      115200U      /*!< 上电默认 / 探测失败回退的波特率 */
+#define COMM_BAUD_MAX_ERR_PPM  20000U       /*!< 实际波特率允许的最大误差（2%） */
+#ifndef COMM_BAUD_PROBE_MS
+#define COMM_BAUD_PROBE_MS     1000U        /*!< 等待探测帧的时间 */
+#endif
+
+    /**
+     * @brief CMD_QUERY_MISSING 一次应答最多携带的缺失区间数
+     * @note  请求数据为可选的4字节起始偏移；应答为 下一次查询的起始偏移(4B) + N 个 {偏移, 长度}(各4B)，
+     *        下一次起始偏移等于固件大小表示已扫描到末尾
+     */
+#define COMM_MISSING_MAX_RANGES  64U
+
+    /**
+     * @brief CMD_QUERY_BLOCK_CRCS 一次应答最多携带的块CRC个数
+     * @note  请求数据为4字节起始块号；应答为 块大小(4B) + 运行镜像大小(4B) + 起始块号(4B) + N 个CRC32(各4B)，
+     *        最后一块按镜像实际长度计算；运行槽没有有效槽头时镜像大小为0、不带CRC
+     */
+#define COMM_BLOCK_CRC_MAX       64U
+
+    /**
+     * @brief 窗口模式下DATA帧的扩展应答（CMD_ACK 数据，小端）
+     * @note  前3字节与普通应答相同；ack_offset 之前的数据已全部写入，
+     *        sack 的 bit i 为 1 表示 ack_offset + i*chunk 处的数据块已写入，
+     *        为 0 的位即是需要补发的缺口。发送忙时连续的成功应答合并为一帧，
+     *        seq 为最后一帧的序列号，count 为合并的帧数
+     */
+    typedef struct {
+        uint8_t  status;         /*!< CommStatus_t */
+        uint8_t  cmd;            /*!< 原始命令字 */
+        uint8_t  seq;            /*!< 原始序列号 */
+        uint8_t  count;          /*!< 本应答确认的DATA帧数 */
+        uint32_t ack_offset;     /*!< 累计确认偏移 */
+        uint32_t sack;           /*!< 选择性应答位图 */
+    } CommWinAck_t;
+
+    /**
+     * @brief 通信统计信息（CMD_QUERY_STATS 原样返回，小端）
+     */
+    typedef struct {
+        uint32_t rx_frames;      /*!< 校验通过的帧数 */
+        uint32_t rx_crc_errors;  /*!< 帧CRC错误次数 */
+        uint32_t rx_dropped;     /*!< 接收队列满被丢弃的帧数 */
+        uint32_t rx_uart_errors; /*!< UART错误（溢出/帧错误/噪声）导致重启接收的次数 */
+        uint8_t  queue_depth;    /*!< 当前接收队列中待处理的帧数 */
+        uint8_t  queue_peak;     /*!< 接收队列深度历史峰值 */
+        uint8_t  queue_size;     /*!< 接收队列容量（帧） */
+        uint8_t  reserved;       /*!< 保留 */
+        uint32_t tx_dropped;     /*!< 发送缓冲区满被丢弃的帧数 */
+        uint32_t tx_acks_merged; /*!< 被合并进同一帧的窗口应答数 */
+        uint16_t tx_queue_used;  /*!< 发送缓冲区当前占用（字节） */
+        uint16_t tx_queue_peak;  /*!< 发送缓冲区占用历史峰值（字节） */
+        uint16_t tx_queue_size;  /*!< 发送缓冲区容量（字节） */
+        uint16_t tx_reserved;    /*!< 保留 */
+        uint32_t rx_overruns;    /*!< 其中由接收溢出（ORE，CPU没来得及取走字节）引起的次数 */
+        uint32_t rx_isr_cycles;      /*!< Comm_OnBytesReceived 累计耗时（DWT周期，32位回绕），除以 rx_frames 即每帧开销 */
+        uint32_t rx_isr_cycles_max;  /*!< Comm_OnBytesReceived 单次调用最长耗时（DWT周期） */
+        uint32_t task_stack_free;    /*!< 调用线程（CMD_QUERY_STATS 时为通信任务）栈的历史最少剩余（字节） */
+    } CommStats_t;
+
+    /**
+     * @brief A/B槽信息（CMD_QUERY_SLOT 原样返回，小端）
+     * @note  上位机在 START_UPDATE 之前查询，按 target 选择对应槽链接的镜像；
+     *        running_xxx 是运行槽的槽头，差分传输时上位机据此确认手里的基线和设备一致
+     */
+    typedef struct {
+        uint8_t  running;        /*!< 当前运行槽 BOOT_SLOT_A / BOOT_SLOT_B */
+        uint8_t  target;         /*!< 下载目标槽（也是回滚目标槽） */
+        uint8_t  confirmed;      /*!< 1: 当前镜像已确认；0: 试运行中 */
+        uint8_t  rollback;       /*!< 1: 目标槽中有有效镜像，可以 CMD_ROLLBACK */
+        uint32_t target_addr;    /*!< 目标槽起始地址（镜像链接地址） */
+        uint32_t target_size;    /*!< 目标槽大小（字节） */
+        uint32_t running_size;   /*!< 运行镜像大小（字节），运行槽没有有效槽头时为0 */
+        uint32_t running_crc;    /*!< 运行镜像CRC32 */
+        uint32_t running_version;/*!< 运行镜像版本号 */
+    } CommSlotInfo_t;
+
+    /**
+     * @brief 初始化通信模块
+     *
+     * 启动UART接收（DMA循环接收或逐字节中断），复位接收状态机；需在RTOS内核启动后、通信任务中调用
+     */
+    void Comm_Init(void);
+
+    /**
+     * @brief 接收字节处理函数
+     *
+     * 在UART接收中断中调用，用于处理接收到的每个字节；
+     * 中断里只组帧和校验，完整的帧放入接收队列，由 Comm_Process 处理
+     * @param ch 接收到的字节数据
+     */
+    void Comm_OnByteReceived(uint8_t ch);
+
+    /**
+     * @brief 批量接收处理函数
+     *
+     * 在DMA接收事件回调中调用，一次消费一段连续的接收数据；
+     * 帧数据段整段拷贝进队头槽位，其余字段逐字节走状态机。每次调用的耗时用 DWT 计入统计
+     * @param data 接收数据指针
+     * @param len 数据长度
+     */
+    void Comm_OnBytesReceived(const uint8_t *data, uint16_t len);
+
+    /**
+     * @brief 处理接收队列中的帧
+     *
+     * 在通信任务中循环调用：队列为空时最多阻塞等待 timeout，
+     * 随后依次处理所有已入队的帧（执行命令、擦写Flash、发送应答）
+     * @param timeout 队列为空时的最长等待时间（RTOS tick）
+     */
+    void Comm_Process(uint32_t timeout);
+
+    /**
+     * @brief 读取通信统计信息
+     * @note  task_stack_free 取调用线程的栈余量，应在通信任务中调用（CMD_QUERY_STATS 即是）
+     * @param stats 输出参数
+     */
+    void Comm_GetStats(CommStats_t *stats);
+
+    /**
+     * @brief 发送数据帧
+     *
+     * 构造完整的通信帧（自动附加CRC）放入发送缓冲区后立即返回，不等待发送完成
+     * @param cmd 命令字
+     * @param seq 序列号
+     * @param data 数据指针
+     * @param len 数据长度
+     */
+    void Comm_SendFrame(uint8_t cmd, uint8_t seq, const uint8_t *data, uint16_t len);
+
+    /**
+     * @brief 发送应答帧
+     *
+     * 发送ACK应答帧，包含状态信息
+     * @param cmd 原始命令字
+     * @param seq 原始序列号
+     * @param status 应答状态码
+     */
+    void Comm_SendAck(uint8_t cmd, uint8_t seq, CommStatus_t status);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __COMM_PROTO_H */
@@ -1,87 +1,305 @@
-/* update_manager.h */
-#ifndef __UPDATE_MANAGER_H
-#define __UPDATE_MANAGER_H
-
-#include "stm32f4xx_hal.h"
-#include "FlashCV.h"   // 里面有 BootMeta_t、UPGRADE_FLAG_xxx、地址宏
-
-#ifdef __cplusplus
-extern "C" {
-#endif
-
-/**
- * @brief 升级状态枚举
- */
-typedef enum {
-    UPDATE_IDLE = 0,              /*!< 空闲状态 */
-    UPDATE_RECEIVING,             /*!< 正在接收数据 */
-    UPDATE_FINISH_REQUESTED,      /*!< 已请求完成升级 */
-    UPDATE_FINISHED               /*!< 升级已完成 */
-} UpdateState_t;
-
-/**
- * @brief 升级上下文结构体
- */
-typedef struct {
-    UpdateState_t state;          /*!< 当前升级状态 */
-    uint32_t total_size;          /*!< 固件总大小（字节） */
-    uint32_t image_crc;           /*!< 固件CRC32校验值 */
-    uint32_t version;             /*!< 固件版本号 */
-    uint32_t received_size;       /*!< 已接收写入的字节数 */
-} UpdateContext_t;
-
-/**
- * @brief 初始化升级管理器上下文
- * @note 在系统启动时调用一次
- */
-void Update_Init(void);
-
-/**
- * @brief 开始升级流程
- * @param total_size 固件总大小（字节），必须大于0且不超过下载区容量
- * @param crc 固件的CRC32校验值
- * @param version 固件版本号
- * @return HAL_StatusTypeDef HAL_OK表示成功，其他值表示失败
- * @retval HAL_OK 成功开始升级
- * @retval HAL_ERROR 参数无效或下载区空间不足
- */
-HAL_StatusTypeDef Update_Start(uint32_t total_size, uint32_t crc, uint32_t version);
-
-/**
- * @brief 接收并写入升级数据块
- * @param offset 数据在固件中的偏移位置（字节）
- * @param data 指向数据缓冲区的指针
- * @param len 数据长度（字节）
- * @return HAL_StatusTypeDef HAL_OK表示成功，其他值表示失败
- * @retval HAL_OK 数据写入成功
- * @retval HAL_ERROR 状态错误、参数无效或超出范围
- */
-HAL_StatusTypeDef Update_ReceiveChunk(uint32_t offset, const uint8_t *data, uint16_t len);
-
-/**
- * @brief 请求完成升级过程
- * @note 此函数仅设置完成标志，实际处理在 update_manager.c#L136-L189 中进行
- * @return HAL_StatusTypeDef HAL_OK表示成功，其他值表示失败
- * @retval HAL_OK 成功请求完成
- * @retval HAL_ERROR 当前状态不允许完成操作
- */
-HAL_StatusTypeDef Update_RequestFinish(void);
-
-/**
- * @brief 在空闲任务中处理升级收尾工作
- * @note 应在FreeRTOS的vApplicationIdleHook中周期性调用
- * @note 包含CRC校验、元数据写入和系统复位
- */
-void Update_ProcessInIdle(void);
-
-/**
- * @brief 获取当前升级状态
- * @return UpdateState_t 当前的升级状态
- */
-UpdateState_t Update_GetState(void);
-
-#ifdef __cplusplus
-}
-#endif
-
-#endif /* __UPDATE_MANAGER_H */
+/* update_manager.h */
+#ifndef __UPDATE_MANAGER_H
+#define __UPDATE_MANAGER_H
+
+#include "stm32f4xx_hal.h"
+#include "FlashCV.h"   // 里面有 BootMeta_t、UPGRADE_FLAG_xxx、地址宏
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief 升级状态枚举
+ */
+typedef enum {
+    UPDATE_IDLE = 0,              /*!< 空闲状态 */
+    UPDATE_RECEIVING,             /*!< 正在接收数据 */
+    UPDATE_FINISH_REQUESTED,      /*!< 已请求完成升级 */
+    UPDATE_FINISHED               /*!< 升级已完成 */
+} UpdateState_t;
+
+/**
+ * @brief 升级上下文结构体
+ */
+typedef struct {
+    UpdateState_t state;          /*!< 当前升级状态 */
+    uint32_t total_size;          /*!< 固件总大小（字节） */
+    uint32_t image_crc;           /*!< 固件CRC32校验值 */
+    uint32_t version;             /*!< 固件版本号 */
+    uint32_t received_size;       /*!< 已收到数据的最大结束偏移（可能有缺口，完整性以接收位图为准） */
+    uint32_t running_crc;         /*!< [0, crc_offset) 这段连续数据的CRC32（最终值形式） */
+    uint32_t crc_offset;          /*!< running_crc 已覆盖到的偏移 */
+    uint8_t  crc_valid;           /*!< 1: 可由各数据块CRC拼出整片CRC；0: 收尾时需整片重算 */
+} UpdateContext_t;
+
+/**
+ * @brief 暂存的乱序数据块CRC个数上限
+ * @note  超过上限（或数据块之间部分重叠）时放弃拼接，收尾时对下载区整片重算CRC
+ */
+#define UPDATE_CRC_PENDING_MAX   16U
+
+/**
+ * @brief 接收位图的块大小（字节）
+ * @note  块内所有Flash字都编程完成后才置位；只被数据块覆盖了一部分的块由半满块槽按字跟踪，
+ *        不足一个字的首尾字节由写合并槽跟踪，因此任意偏移/长度的数据块都能精确记录
+ */
+#define UPDATE_BLOCK_SIZE        256U
+
+/**
+ * @brief 接收位图总块数，按较大的槽B计算（128KB / 256B = 512 块，位图占 64B SRAM）
+ */
+#define UPDATE_BLOCK_COUNT       ((FLASH_DOWNLOAD_END_ADDR - FLASH_DOWNLOAD_START_ADDR + 1U) / UPDATE_BLOCK_SIZE)
+
+/**
+ * @brief 每块的Flash字数
+ */
+#define UPDATE_BLOCK_WORDS       (UPDATE_BLOCK_SIZE / 4U)
+
+/**
+ * @brief 半满块槽个数
+ * @note  每个乱序在途的数据块最多让首尾两个块处于半满状态；块大小和偏移按256字节对齐时不占用，
+ *        与写合并槽一样按最大发送窗口取32个（每个槽12字节）
+ */
+#define UPDATE_PARTIAL_SLOTS     32U
+
+/**
+ * @brief 缺失数据区间（相对固件起始的偏移）
+ */
+typedef struct {
+    uint32_t offset;              /*!< 区间起始偏移（字节） */
+    uint32_t len;                 /*!< 区间长度（字节） */
+} UpdateRange_t;
+
+/**
+ * @brief 写合并槽个数
+ * @note  数据块首尾不足4字节的部分先在RAM里按Flash字合并，凑齐一个字（或收尾时）才编程；
+ *        每个乱序在途的数据块最多占2个槽，32个槽足够覆盖最大发送窗口
+ */
+#define UPDATE_WC_SLOTS          32U
+
+/**
+ * @brief 升级会话无数据超时（ms）
+ * @note  RECEIVING 状态下超过该时间没有收到 START/DATA 帧，视为会话中止，回到空闲；
+ *        下载区数据和会话记录保留，供同一固件续传
+ */
+#define UPDATE_SESSION_TIMEOUT_MS   30000U
+
+/**
+ * @brief 传输编码（CMD_START_UPDATE 的 encoding 字段）
+ * @note  LZ4: DATA 帧携带的是 LZ4 块格式压缩流（匹配距离不超过 LZ4S_WINDOW_SIZE），偏移按压缩流计算；
+ *        设备按顺序流式解压写入目标槽，固件大小和CRC仍是解压后镜像的
+ * @note  DELTA: 压缩流解出的是以当前运行镜像为基线的差分补丁（格式见 DeltaPatch.h），
+ *        设备读运行槽、打补丁，把新镜像写入目标槽；补丁头中的基线大小和CRC必须与运行槽的槽头一致
+ */
+#define UPDATE_ENC_RAW              0U     /*!< 原样传输 */
+#define UPDATE_ENC_LZ4              1U     /*!< LZ4 压缩传输 */
+#define UPDATE_ENC_DELTA            2U     /*!< LZ4 压缩的差分补丁 */
+
+/**
+ * @brief 分块去重的块大小（字节）
+ * @note  上位机按这个大小比较新镜像和运行镜像的块CRC，相同的块让设备用 Update_CopyFromRunning 在本地复制；
+ *        块越小能复用的越多，CRC列表也越长（96KB 镜像为 384 字节）
+ * @note  A/B 两个槽的镜像链接地址不同，向量表、函数指针和文字池等含绝对地址的块在两个槽的构建里
+ *        总是不同。上位机因此拿同一次构建里按运行槽链接的那份比较（同样的链接地址），
+ *        只差在槽地址上的块由 CMD_COPY_BLOCKS 的重定位位图在复制时修正（COMM_CAP_RELOC）
+ */
+#define UPDATE_DEDUP_BLOCK_SIZE     1024U
+
+/**
+ * @brief 运行镜像分块CRC缓存的块数，按较大的槽计算（128KB / 1KB = 128 块，占 512B SRAM）
+ */
+#define UPDATE_DEDUP_BLOCK_COUNT    (((FLASH_SLOT_B_SIZE > FLASH_SLOT_A_SIZE) ? FLASH_SLOT_B_SIZE : FLASH_SLOT_A_SIZE) / \
+                                     UPDATE_DEDUP_BLOCK_SIZE)
+
+/**
+ * @brief 新镜像试运行确认时间（ms，从上电/复位算起）
+ * @note  刚提交的镜像启动后正常运行到这个时刻就确认，之后 Bootloader 不再自动回滚；
+ *        时间必须明显短于 BOOT_TRIAL_MAX 次启动的看门狗/人工复位间隔
+ */
+#ifndef UPDATE_CONFIRM_DELAY_MS
+#define UPDATE_CONFIRM_DELAY_MS     5000U
+#endif
+
+/**
+ * @brief 运行镜像确认后是否预擦除另一个槽里的上一版镜像
+ * @note  0（默认）：上一版镜像保留，CMD_ROLLBACK 和活动槽损坏时 Bootloader 的退回都能用它；
+ *        代价是 A/B 升级过一次之后目标槽总有镜像，后台预擦除不再发生，CMD_START_UPDATE 要在应答前同步擦除。
+ *        1：确认之后（以及启动时运行镜像已确认）在后台擦掉目标槽，下一次 CMD_START_UPDATE 立即应答，
+ *        但确认之后就不能再回滚到上一版
+ */
+#ifndef UPDATE_PREERASE_AFTER_CONFIRM
+#define UPDATE_PREERASE_AFTER_CONFIRM   0
+#endif
+
+/**
+ * @brief 初始化升级管理器上下文
+ * @note 在系统启动时调用一次
+ * @note 下载目标槽取当前运行槽之外的那个槽
+ * @note 没有待搬运的固件、没有可续传的会话、下载区不是 CLEAN，且目标槽里没有留作回滚的镜像时，
+ *       安排后台预擦除目标槽；UPDATE_PREERASE_AFTER_CONFIRM=1 时运行镜像已确认就不再保留回滚镜像
+ * @note 当前镜像是刚提交、还在试运行的活动槽时，记下等待确认
+ */
+void Update_Init(void);
+
+/**
+ * @brief 开始升级流程
+ * @param total_size 固件总大小（字节），必须大于0且不超过目标槽容量
+ * @param crc 固件的CRC32校验值
+ * @param version 固件版本号
+ * @param encoding 传输编码 UPDATE_ENC_RAW / UPDATE_ENC_LZ4 / UPDATE_ENC_DELTA
+ * @param stream_size 压缩流长度（字节），原样传输时忽略
+ * @note  目标槽、大小、CRC、版本与Flash中的会话记录一致时续传：不擦除，按进度位图恢复接收位图，
+ *        上位机用 Update_GetResumeOffset / Update_GetMissing 得到的偏移继续发送
+ * @note  否则开始新会话：下载区已被后台预擦除（CLEAN）时不再擦除，立即返回；
+ *        否则作废目标槽的槽头（留作回滚的上一版镜像从此不可用），只擦固件覆盖到的扇区
+ * @note  还在试运行的当前镜像先被确认
+ * @return HAL_StatusTypeDef HAL_OK表示成功，其他值表示失败
+ * @retval HAL_OK 成功开始升级
+ * @retval HAL_ERROR 参数无效、编码不支持、差分传输时运行槽没有有效槽头或下载区空间不足
+ */
+HAL_StatusTypeDef Update_Start(uint32_t total_size, uint32_t crc, uint32_t version,
+                               uint32_t encoding, uint32_t stream_size);
+
+/**
+ * @brief 接收并写入升级数据块
+ * @note  偏移和长度不要求4字节对齐：中间的整字直接编程，首尾不足一个字的字节
+ *        先放进写合并槽，和相邻数据块拼成整字后再编程，每个Flash字只编程一次
+ * @note  数据块可以任意顺序到达；涉及的块在接收位图中都已置位时视为重传，直接返回成功
+ * @note  每收齐 FLASHCV_PROGRESS_BLOCK 字节就在Flash进度位图中记一位，供断线/复位后续传
+ * @note  每个写入成功的数据块都会单独算一次CRC：紧接在已拼接部分之后的直接用
+ *        FlashCV_CrcCombine 合并进 running_crc，提前到达的先暂存，重传的直接忽略
+ * @note  压缩传输时 offset 是压缩流中的偏移：数据块交给 Lz4Stream 解压，解出的数据走上面同样的写入路径；
+ *        差分传输时解出的补丁再经 DeltaPatch 与运行槽合成新数据；
+ *        压缩流只能按顺序解压，前面有缺口时返回 HAL_BUSY（数据未被消耗，需按顺序重传）
+ * @param offset 数据在固件（压缩传输时为压缩流）中的偏移位置（字节）
+ * @param data 指向数据缓冲区的指针
+ * @param len 数据长度（字节）
+ * @return HAL_StatusTypeDef HAL_OK表示成功，其他值表示失败
+ * @retval HAL_OK 数据写入成功
+ * @retval HAL_BUSY 压缩流前面还有缺口
+ * @retval HAL_ERROR 状态错误、参数无效、超出范围或压缩数据错误
+ */
+HAL_StatusTypeDef Update_ReceiveChunk(uint32_t offset, const uint8_t *data, uint16_t len);
+
+/**
+ * @brief 请求完成升级过程
+ * @note 先把写合并槽里剩下的字（缺的字节按 0xFF）编程进Flash，再设置完成标志，
+ *       实际处理在 Update_ProcessInIdle 中进行
+ * @return HAL_StatusTypeDef HAL_OK表示成功，其他值表示失败
+ * @retval HAL_OK 成功请求完成
+ * @retval HAL_ERROR 当前状态不允许完成操作，接收位图显示还有缺口，或压缩流没有完整解压
+ */
+HAL_StatusTypeDef Update_RequestFinish(void);
+
+/**
+ * @brief 查询尚未收到的数据区间
+ * @note  从 from 所在的块开始扫描接收位图，整字全满/全空时一次跳过32块；
+ *        区间按块（UPDATE_BLOCK_SIZE）对齐，半满的块整块报告为缺失，最后一个区间截止到固件末尾；
+ *        压缩传输时返回压缩流中尚未解压的尾部（最多一个区间）
+ * @param from 起始偏移（字节）
+ * @param ranges 输出缺失区间数组
+ * @param max ranges 容量
+ * @param next 输出下一次查询的起始偏移；扫描到固件末尾时等于固件大小
+ * @return uint32_t 写入 ranges 的区间个数
+ */
+uint32_t Update_GetMissing(uint32_t from, UpdateRange_t *ranges, uint32_t max, uint32_t *next);
+
+/**
+ * @brief 计算当前运行镜像按 UPDATE_DEDUP_BLOCK_SIZE 分块的CRC32
+ * @note  只有运行槽带有效槽头时才计算；最后一块按镜像实际长度计算。
+ *        运行槽在应用运行期间不会被写，槽头校验和各块CRC只在第一次查询时各算一次，之后直接返回缓存
+ * @param first 起始块号
+ * @param crcs 输出CRC数组
+ * @param max crcs 容量
+ * @param image_size 输出运行镜像大小，运行槽没有有效槽头时为0
+ * @return uint32_t 写入 crcs 的个数
+ */
+uint32_t Update_GetBlockCrcs(uint32_t first, uint32_t *crcs, uint32_t max, uint32_t *image_size);
+
+/**
+ * @brief 把运行镜像中 [offset, offset + len) 这段复制到下载目标槽的相同偏移
+ * @note  上位机比较块CRC后，内容没变的块不再传输，由设备从运行槽读出后走和 DATA 帧相同的写入路径
+ *        （接收位图、进度位图、CRC拼接都照常记录），之后 Update_GetMissing 只报告真正变化的块
+ * @note  两个槽的构建只差在绝对地址上：reloc 的 bit i 为1时，第 i 个字加上"目标槽地址 - 运行槽地址"再写入。
+ *        上位机用同一次构建里按运行槽链接的那份镜像和运行槽比较块CRC（链接地址相同才比得上），
+ *        再对照按目标槽链接的那份给出需要修正的字
+ * @note  只能用于原样传输；已经写入的块直接跳过
+ * @param offset 起始偏移（字节），带 reloc 时必须4字节对齐
+ * @param len 长度（字节）
+ * @param reloc 重定位位图，每个字一位（LSB 先），NULL 表示原样复制
+ * @return HAL_StatusTypeDef 操作状态
+ * @retval HAL_ERROR 不在接收状态、不是原样传输、运行槽没有有效槽头、超出新镜像或运行镜像范围，或写Flash失败
+ */
+HAL_StatusTypeDef Update_CopyFromRunning(uint32_t offset, uint32_t len, const uint8_t *reloc);
+
+/**
+ * @brief 查询当前运行的槽
+ * @note  由向量表的链接地址判断，与元数据中记录的活动槽无关
+ * @return uint32_t BOOT_SLOT_A / BOOT_SLOT_B
+ */
+uint32_t Update_GetRunningSlot(void);
+
+/**
+ * @brief 查询下载目标槽
+ * @note  上位机据此选择按该槽链接的镜像（槽A: app.bin，槽B: app_b.bin）
+ * @return uint32_t BOOT_SLOT_A / BOOT_SLOT_B
+ */
+uint32_t Update_GetTargetSlot(void);
+
+/**
+ * @brief 当前镜像是否已确认
+ * @return uint8_t 1: 已确认（或本来就不在试运行）；0: 试运行中
+ */
+uint8_t Update_IsConfirmed(void);
+
+/**
+ * @brief 能否回滚到另一个槽
+ * @note  没有升级在进行，且目标槽的槽头、向量表、整片CRC都有效
+ * @return uint8_t 1: 可以回滚；0: 不可以
+ */
+uint8_t Update_CanRollback(void);
+
+/**
+ * @brief 回滚到另一个槽中的镜像
+ * @note  只追加一条元数据记录把另一个槽设为活动槽，不搬运数据；当前镜像原样保留，
+ *        回滚后还能用同样方式切回来。调用者负责随后复位
+ * @return HAL_StatusTypeDef HAL_OK表示成功，其他值表示失败
+ * @retval HAL_ERROR 升级进行中、另一个槽没有有效镜像或写元数据失败
+ */
+HAL_StatusTypeDef Update_Rollback(void);
+
+/**
+ * @brief 查询续传起点
+ * @return uint32_t 第一个尚未收到的块的偏移；没有缺口时等于固件大小；
+ *         压缩传输时为压缩流中已解压到的偏移
+ */
+uint32_t Update_GetResumeOffset(void);
+
+/**
+ * @brief 查询本次传输的数据总长度
+ * @return uint32_t 原样传输时等于固件大小，压缩传输时为压缩流长度
+ */
+uint32_t Update_GetTransferSize(void);
+
+/**
+ * @brief 处理升级收尾工作
+ * @note 由通信任务在每轮 Comm_Process 之后调用，Flash 操作全部在通信任务中完成
+ * @note 包含CRC校验、元数据写入和系统复位
+ * @note 通常直接使用由各数据块CRC拼出的整片CRC，无需再整片读一遍下载区
+ * @note 空闲时每次调用最多预擦除下载区的一个扇区，擦完整个下载区后把它标记为 CLEAN
+ * @note 试运行的镜像运行满 UPDATE_CONFIRM_DELAY_MS 后在这里确认
+ */
+void Update_ProcessInIdle(void);
+
+/**
+ * @brief 获取当前升级状态
+ * @return UpdateState_t 当前的升级状态
+ */
+UpdateState_t Update_GetState(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __UPDATE_MANAGER_H */
@@ -0,0 +1,45 @@
+#include "BootMailbox.h"
+#include "FlashCV.h"
+#include <string.h>
+#include <stddef.h>
+
+/********* 内部辅助：邮箱CRC（magic 到 crc 之前的全部字段） *********/
+static uint32_t BootMailbox_Crc(const BootMailbox_t *mb)
+{
+    return FlashCV_CrcFinal(FlashCV_CrcUpdate(FlashCV_CrcInit(), (const uint8_t *)mb,
+                                              offsetof(BootMailbox_t, crc)));
+}
+
+/********* 打开备份SRAM访问 *********/
+void BootMailbox_Init(void)
+{
+    __HAL_RCC_PWR_CLK_ENABLE();
+    HAL_PWR_EnableBkUpAccess();
+    __HAL_RCC_BKPSRAM_CLK_ENABLE();
+}
+
+/********* 读取并校验邮箱 *********/
+uint8_t BootMailbox_Read(BootMailbox_t *mb)
+{
+    if (mb == NULL) return 0;
+
+    memcpy(mb, (const void *)BOOT_MAILBOX_ADDR, sizeof(BootMailbox_t));
+
+    if (mb->magic != BOOT_MAILBOX_MAGIC || mb->crc != BootMailbox_Crc(mb))
+    {
+        memset(mb, 0, sizeof(BootMailbox_t));
+        return 0;
+    }
+
+    return 1;
+}
+
+/********* 写入邮箱 *********/
+void BootMailbox_Write(BootMailbox_t *mb)
+{
+    if (mb == NULL) return;
+
+    mb->magic = BOOT_MAILBOX_MAGIC;
+    mb->crc   = BootMailbox_Crc(mb);
+    memcpy((void *)BOOT_MAILBOX_ADDR, mb, sizeof(BootMailbox_t));
+}
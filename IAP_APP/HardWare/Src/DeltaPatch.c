@@ -0,0 +1,161 @@
+#include "DeltaPatch.h"
+#include <string.h>
+
+#define DELTA_HEADER_BYTES   16U
+#define DELTA_RECORD_BYTES   12U
+
+/**
+ * @brief 解析状态：头部只出现一次，之后每条记录依次是控制字段、差值字节、新字节
+ */
+enum {
+    DELTA_HEADER = 0,
+    DELTA_CONTROL,
+    DELTA_ADD,
+    DELTA_EXTRA
+};
+
+/********* 内部辅助：把缓冲区中的新数据交给输出回调 *********/
+static HAL_StatusTypeDef DeltaPatch_Flush(DeltaPatch_t *p)
+{
+    if (p->buf_len == 0U) return HAL_OK;
+    if (p->sink(p->out - p->buf_len, p->buf, p->buf_len) != HAL_OK) return HAL_ERROR;
+    p->buf_len = 0U;
+    return HAL_OK;
+}
+
+/********* 内部辅助：输出一个新字节，缓冲区满时先写出 *********/
+static HAL_StatusTypeDef DeltaPatch_Put(DeltaPatch_t *p, uint8_t b)
+{
+    if (p->out >= p->out_limit) return HAL_ERROR;
+    if (p->buf_len == DELTA_OUT_BUF_SIZE && DeltaPatch_Flush(p) != HAL_OK) return HAL_ERROR;
+
+    p->buf[p->buf_len++] = b;
+    p->out++;
+    return HAL_OK;
+}
+
+/********* 内部辅助：一条记录处理完，移动基线位置并等待下一条记录 *********/
+static void DeltaPatch_NextRecord(DeltaPatch_t *p)
+{
+    if (p->add_len > 0U) {
+        p->state = DELTA_ADD;
+    } else if (p->extra_len > 0U) {
+        p->state = DELTA_EXTRA;
+    } else {
+        /* seek 是有符号数；移到基线之外不算错，真正读基线时再检查 */
+        p->base_pos += p->field[2];
+        p->state = DELTA_CONTROL;
+    }
+}
+
+/********* 内部辅助：头部或控制字段收齐 *********/
+static HAL_StatusTypeDef DeltaPatch_Fields(DeltaPatch_t *p)
+{
+    if (p->state == DELTA_HEADER) {
+        if (p->field[0] != DELTA_PATCH_MAGIC || p->field[1] != p->base_size ||
+            p->field[2] != p->base_crc || p->field[3] != p->out_limit) {
+            return HAL_ERROR;
+        }
+        p->state = DELTA_CONTROL;
+        return HAL_OK;
+    }
+
+    p->add_len   = p->field[0];
+    p->extra_len = p->field[1];
+    DeltaPatch_NextRecord(p);
+    return HAL_OK;
+}
+
+/********* 初始化 *********/
+void DeltaPatch_Init(DeltaPatch_t *p, const uint8_t *base, uint32_t base_size, uint32_t base_crc,
+                     uint32_t out_limit, DeltaPatch_Sink_t sink)
+{
+    memset(p, 0, sizeof(DeltaPatch_t));
+    p->base      = base;
+    p->base_size = base_size;
+    p->base_crc  = base_crc;
+    p->out_limit = out_limit;
+    p->sink      = sink;
+    p->state     = DELTA_HEADER;
+}
+
+/********* 喂入一段补丁：字段逐字节拼接，差值和新字节整段处理 *********/
+HAL_StatusTypeDef DeltaPatch_Feed(DeltaPatch_t *p, const uint8_t *data, uint32_t len)
+{
+    uint32_t i = 0;
+
+    if (p->error) return HAL_ERROR;
+
+    while (i < len)
+    {
+        HAL_StatusTypeDef st = HAL_OK;
+
+        switch (p->state)
+        {
+        case DELTA_HEADER:
+        case DELTA_CONTROL:
+        {
+            uint8_t n = (p->state == DELTA_HEADER) ? DELTA_HEADER_BYTES : DELTA_RECORD_BYTES;
+
+            p->field[p->field_pos >> 2] &= ~(0xFFUL << ((p->field_pos & 3U) * 8U));
+            p->field[p->field_pos >> 2] |= (uint32_t)data[i] << ((p->field_pos & 3U) * 8U);
+            p->field_pos++;
+            i++;
+            if (p->field_pos == n) {
+                p->field_pos = 0U;
+                st = DeltaPatch_Fields(p);
+            }
+        }
+            break;
+
+        case DELTA_ADD:
+            while (i < len && p->add_len > 0U && st == HAL_OK)
+            {
+                if (p->base_pos >= p->base_size) {
+                    st = HAL_ERROR;
+                    break;
+                }
+                st = DeltaPatch_Put(p, (uint8_t)(p->base[p->base_pos] + data[i]));
+                p->base_pos++;
+                p->add_len--;
+                i++;
+            }
+            if (st == HAL_OK && p->add_len == 0U) DeltaPatch_NextRecord(p);
+            break;
+
+        case DELTA_EXTRA:
+            while (i < len && p->extra_len > 0U && st == HAL_OK)
+            {
+                st = DeltaPatch_Put(p, data[i]);
+                p->extra_len--;
+                i++;
+            }
+            if (st == HAL_OK && p->extra_len == 0U) DeltaPatch_NextRecord(p);
+            break;
+
+        default:
+            st = HAL_ERROR;
+            break;
+        }
+
+        if (st != HAL_OK)
+        {
+            p->error = 1U;
+            return HAL_ERROR;
+        }
+    }
+
+    if (DeltaPatch_Flush(p) != HAL_OK)
+    {
+        p->error = 1U;
+        return HAL_ERROR;
+    }
+    return HAL_OK;
+}
+
+/********* 最后一条记录处理完后停在下一条记录的控制字段之前 *********/
+uint8_t DeltaPatch_Done(const DeltaPatch_t *p)
+{
+    return (!p->error && p->state == DELTA_CONTROL && p->field_pos == 0U &&
+            p->out == p->out_limit && p->buf_len == 0U) ? 1U : 0U;
+}
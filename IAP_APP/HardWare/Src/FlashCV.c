@@ -1,202 +1,1059 @@
-//
-// Created by vgc on 2025/11/20.
-//
-
-#include "FlashCV.h"
-#include <string.h>
-
-/********* 内部辅助：擦除某个扇区 *********/
-static HAL_StatusTypeDef FlashCV_EraseSectors(uint32_t first_sector, uint32_t nb_sectors)
-{
-    HAL_StatusTypeDef status;
-    FLASH_EraseInitTypeDef erase;
-    uint32_t sector_error = 0;
-
-    erase.TypeErase     = FLASH_TYPEERASE_SECTORS;
-    erase.VoltageRange  = FLASH_VOLTAGE_RANGE_3;
-    erase.Sector        = first_sector;
-    erase.NbSectors     = nb_sectors;
-
-    status = HAL_FLASHEx_Erase(&erase, &sector_error);
-    return status;
-}
-
-/********* 读取元数据 *********/
-void FlashCV_ReadMeta(BootMeta_t *meta)
-{
-    if (meta == NULL) return;
-    const BootMeta_t *p = (const BootMeta_t *)FLASH_META_ADDR;
-    memcpy(meta, p, sizeof(BootMeta_t));
-}
-
-/********* 写入元数据（会先擦除Sector1） *********/
-HAL_StatusTypeDef FlashCV_WriteMeta(const BootMeta_t *meta)
-{
-    if (meta == NULL) return HAL_ERROR;
-
-    HAL_StatusTypeDef status;
-
-    HAL_FLASH_Unlock();
-
-    // 擦除元数据所在扇区：Sector 1
-    status = FlashCV_EraseSectors(FLASH_SECTOR_1, 1);
-    if (status != HAL_OK)
-    {
-        HAL_FLASH_Lock();
-        return status;
-    }
-
-    // 逐字写入
-    uint32_t addr = FLASH_META_ADDR;
-    const uint32_t *p = (const uint32_t *)meta;
-    for (uint32_t i = 0; i < sizeof(BootMeta_t) / 4; i++)
-    {
-        status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, addr, p[i]);
-        if (status != HAL_OK) break;
-        addr += 4;
-    }
-
-    HAL_FLASH_Lock();
-    return status;
-}
-
-/********* 将 flag 从 VALID 改为 DONE *********/
-HAL_StatusTypeDef FlashCV_ClearMetaFlag(void)
-{
-    BootMeta_t meta;
-    FlashCV_ReadMeta(&meta);
-
-    if (meta.flag != UPGRADE_FLAG_VALID)
-        return HAL_OK; // 本来就不是有效升级，直接返回
-
-    meta.flag = UPGRADE_FLAG_DONE;
-    return FlashCV_WriteMeta(&meta);
-}
-
-/********* 擦除 App 区：Sector 2~4 *********/
-HAL_StatusTypeDef FlashCV_EraseAppArea(void)
-{
-    HAL_StatusTypeDef status;
-
-    HAL_FLASH_Unlock();
-
-    status = FlashCV_EraseSectors(FLASH_SECTOR_2, 3); // 2,3,4
-
-    HAL_FLASH_Lock();
-
-    return status;
-}
-
-/********* 从下载区搬运到 App 区 *********/
-HAL_StatusTypeDef FlashCV_CopyImageToApp(uint32_t img_size)
-{
-    HAL_StatusTypeDef status;
-
-    // 基本保护
-    if (img_size == 0) return HAL_ERROR;
-    if ((FLASH_DOWNLOAD_START_ADDR + img_size) > (FLASH_DOWNLOAD_END_ADDR + 1))
-        return HAL_ERROR;
-    if ((FLASH_APP_START_ADDR + img_size) > (FLASH_APP_END_ADDR + 1))
-        return HAL_ERROR;
-
-    // 先擦除App区
-    status = FlashCV_EraseAppArea();
-    if (status != HAL_OK) return status;
-
-    HAL_FLASH_Unlock();
-
-    uint32_t src = FLASH_DOWNLOAD_START_ADDR;
-    uint32_t dst = FLASH_APP_START_ADDR;
-    uint32_t remaining = img_size;
-    uint32_t data;
-
-    while (remaining > 0)
-    {
-        if (remaining >= 4)
-        {
-            data = *(uint32_t *)src;
-        }
-        else
-        {
-            uint8_t tmp[4] = {0};
-            for (uint32_t i = 0; i < remaining; i++)
-                tmp[i] = *(uint8_t *)(src + i);
-            data = *(uint32_t *)tmp;
-        }
-
-        status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, dst, data);
-        if (status != HAL_OK)
-        {
-            HAL_FLASH_Lock();
-            return status;
-        }
-
-        src += 4;
-        dst += 4;
-        if (remaining >= 4) remaining -= 4;
-        else remaining = 0;
-    }
-
-    HAL_FLASH_Lock();
-    return HAL_OK;
-}
-
-
-/********* 标准CRC-32校验 *********/
-uint32_t FlashCV_CalcCRC(uint32_t start_addr, uint32_t length)
-{
-    static const uint32_t crc_table[256] = {
-        0x00000000, 0x77073096, 0xee0e612c, 0x990951ba, 0x076dc419, 0x706af48f,
-        0xe963a535, 0x9e6495a3, 0x0edb8832, 0x79dcb8a4, 0xe0d5e91e, 0x97d2d988,
-        0x09b64c2b, 0x7eb17cbd, 0xe7b82d07, 0x90bf1d91, 0x1db71064, 0x6ab020f2,
-        0xf3b97148, 0x84be41de, 0x1adad47d, 0x6ddde4eb, 0xf4d4b551, 0x83d385c7,
-        0x136c9856, 0x646ba8c0, 0xfd62f97a, 0x8a65c9ec, 0x14015c4f, 0x63066cd9,
-        0xfa0f3d63, 0x8d080df5, 0x3b6e20c8, 0x4c69105e, 0xd56041e4, 0xa2677172,
-        0x3c03e4d1, 0x4b04d447, 0xd20d85fd, 0xa50ab56b, 0x35b5a8fa, 0x42b2986c,
-        0xdbbbc9d6, 0xacbcf940, 0x32d86ce3, 0x45df5c75, 0xdcd60dcf, 0xabd13d59,
-        0x26d930ac, 0x51de003a, 0xc8d75180, 0xbfd06116, 0x21b4f4b5, 0x56b3c423,
-        0xcfba9599, 0xb8bda50f, 0x2802b89e, 0x5f058808, 0xc60cd9b2, 0xb10be924,
-        0x2f6f7c87, 0x58684c11, 0xc1611dab, 0xb6662d3d, 0x76dc4190, 0x01db7106,
-        0x98d220bc, 0xefd5102a, 0x71b18589, 0x06b6b51f, 0x9fbfe4a5, 0xe8b8d433,
-        0x7807c9a2, 0x0f00f934, 0x9609a88e, 0xe10e9818, 0x7f6a0dbb, 0x086d3d2d,
-        0x91646c97, 0xe6635c01, 0x6b6b51f4, 0x1c6c6162, 0x856530d8, 0xf262004e,
-        0x6c0695ed, 0x1b01a57b, 0x8208f4c1, 0xf50fc457, 0x65b0d9c6, 0x12b7e950,
-        0x8bbeb8ea, 0xfcb9887c, 0x62dd1ddf, 0x15da2d49, 0x8cd37cf3, 0xfbd44c65,
-        0x4db26158, 0x3ab551ce, 0xa3bc0074, 0xd4bb30e2, 0x4adfa541, 0x3dd895d7,
-        0xa4d1c46d, 0xd3d6f4fb, 0x4369e96a, 0x346ed9fc, 0xad678846, 0xda60b8d0,
-        0x44042d73, 0x33031de5, 0xaa0a4c5f, 0xdd0d7cc9, 0x5005713c, 0x270241aa,
-        0xbe0b1010, 0xc90c2086, 0x5768b525, 0x206f85b3, 0xb966d409, 0xce61e49f,
-        0x5edef90e, 0x29d9c998, 0xb0d09822, 0xc7d7a8b4, 0x59b33d17, 0x2eb40d81,
-        0xb7bd5c3b, 0xc0ba6cad, 0xedb88320, 0x9abfb3b6, 0x03b6e20c, 0x74b1d29a,
-        0xead54739, 0x9dd277af, 0x04db2615, 0x73dc1683, 0xe3630b12, 0x94643b84,
-        0x0d6d6a3e, 0x7a6a5aa8, 0xe40ecf0b, 0x9309ff9d, 0x0a00ae27, 0x7d079eb1,
-        0xf00f9344, 0x8708a3d2, 0x1e01f268, 0x6906c2fe, 0xf762575d, 0x806567cb,
-        0x196c3671, 0x6e6b06e7, 0xfed41b76, 0x89d32be0, 0x10da7a5a, 0x67dd4acc,
-        0xf9b9df6f, 0x8ebeeff9, 0x17b7be43, 0x60b08ed5, 0xd6d6a3e8, 0xa1d1937e,
-        0x38d8c2c4, 0x4fdff252, 0xd1bb67f1, 0xa6bc5767, 0x3fb506dd, 0x48b2364b,
-        0xd80d2bda, 0xaf0a1b4c, 0x36034af6, 0x41047a60, 0xdf60efc3, 0xa867df55,
-        0x316e8eef, 0x4669be79, 0xcb61b38c, 0xbc66831a, 0x256fd2a0, 0x5268e236,
-        0xcc0c7795, 0xbb0b4703, 0x220216b9, 0x5505262f, 0xc5ba3bbe, 0xb2bd0b28,
-        0x2bb45a92, 0x5cb36a04, 0xc2d7ffa7, 0xb5d0cf31, 0x2cd99e8b, 0x5bdeae1d,
-        0x9b64c2b0, 0xec63f226, 0x756aa39c, 0x026d930a, 0x9c0906a9, 0xeb0e363f,
-        0x72076785, 0x05005713, 0x95bf4a82, 0xe2b87a14, 0x7bb12bae, 0x0cb61b38,
-        0x92d28e9b, 0xe5d5be0d, 0x7cdcefb7, 0x0bdbdf21, 0x86d3d2d4, 0xf1d4e242,
-        0x68ddb3f8, 0x1fda836e, 0x81be16cd, 0xf6b9265b, 0x6fb077e1, 0x18b74777,
-        0x88085ae6, 0xff0f6a70, 0x66063bca, 0x11010b5c, 0x8f659eff, 0xf862ae69,
-        0x616bffd3, 0x166ccf45, 0xa00ae278, 0xd70dd2ee, 0x4e048354, 0x3903b3c2,
-        0xa7672661, 0xd06016f7, 0x4969474d, 0x3e6e77db, 0xaed16a4a, 0xd9d65adc,
-        0x40df0b66, 0x37d83bf0, 0xa9bcae53, 0xdebb9ec5, 0x47b2cf7f, 0x30b5ffe9,
-        0xbdbdf21c, 0xcabac28a, 0x53b39330, 0x24b4a3a6, 0xbad03605, 0xcdd70693,
-        0x54de5729, 0x23d967bf, 0xb3667a2e, 0xc4614ab8, 0x5d681b02, 0x2a6f2b94,
-        0xb40bbe37, 0xc30c8ea1, 0x5a05df1b, 0x2d02ef8d
-    };
-
-    uint32_t crc = 0xFFFFFFFF;
-    const uint8_t* data = (const uint8_t*)start_addr;
-
-    for (uint32_t i = 0; i < length; i++) {
-        crc = (crc >> 8) ^ crc_table[(crc ^ data[i]) & 0xFF];
-    }
-
-    return crc ^ 0xFFFFFFFF;
-}
+//
+// Created by vgc on 2025/11/20.
+//
+
+#include "FlashCV.h"
+#include <string.h>
+#include <stddef.h>
+
+/*
+ * 本文件的代码和常量由链接脚本整体放入SRAM（随 .data 一起在启动时拷贝）：
+ * 擦写期间Flash总线被占住，取指会让CPU停到操作结束，放在SRAM里的等待循环
+ * 和中断处理才能照常运行。这里只直接操作寄存器，不调用仍在Flash中的HAL函数
+ */
+
+/********* 编程/擦除结束后统一检查的错误标志 *********/
+#define FLASHCV_PROGRAM_ERR_FLAGS  (FLASH_FLAG_OPERR | FLASH_FLAG_WRPERR | FLASH_FLAG_PGAERR | \
+                                    FLASH_FLAG_PGPERR | FLASH_FLAG_PGSERR)
+
+/********* 向量表字数：16个内核异常 + 外设中断（F407最后一个是 FPU_IRQn） *********/
+#define FLASHCV_VECTOR_WORDS       (16U + (uint32_t)FPU_IRQn + 1U)
+
+/**
+ * @brief SRAM中的中断向量表
+ * @note  VTOR 要求按表大小向上取整到2的幂对齐，98个字 -> 512字节
+ */
+static uint32_t flashcv_ram_vectors[FLASHCV_VECTOR_WORDS] __attribute__((aligned(512)));
+
+/**
+ * @brief 擦写进行中标志，中断用它判断能否调用仍在Flash中的代码
+ */
+static volatile uint8_t flashcv_busy = 0U;
+
+/**
+ * @brief F407 扇区起始地址表（512KB：4x16KB + 1x64KB + 3x128KB），最后一项为Flash末尾
+ */
+static const uint32_t flashcv_sector_start[FLASHCV_SECTOR_COUNT + 1U] = {
+    0x08000000UL, 0x08004000UL, 0x08008000UL, 0x0800C000UL,
+    0x08010000UL, 0x08020000UL, 0x08040000UL, 0x08060000UL,
+    0x08080000UL
+};
+
+#if (FLASHCV_CRC_SLICES > 1)
+static void FlashCV_CrcBuildSlices(void);
+#endif
+
+/********* 内部辅助：等待Flash操作结束（轮询循环本身在SRAM中） *********/
+static void FlashCV_WaitBusy(void)
+{
+    while (FLASH->SR & FLASH_SR_BSY) { }
+}
+
+/********* 内部辅助：擦写后复位ART缓存，丢掉擦写前读到的旧内容 *********/
+static void FlashCV_FlushCaches(void)
+{
+    if (FLASH->ACR & FLASH_ACR_ICEN)
+    {
+        __HAL_FLASH_INSTRUCTION_CACHE_DISABLE();
+        __HAL_FLASH_INSTRUCTION_CACHE_RESET();
+        __HAL_FLASH_INSTRUCTION_CACHE_ENABLE();
+    }
+
+    if (FLASH->ACR & FLASH_ACR_DCEN)
+    {
+        __HAL_FLASH_DATA_CACHE_DISABLE();
+        __HAL_FLASH_DATA_CACHE_RESET();
+        __HAL_FLASH_DATA_CACHE_ENABLE();
+    }
+}
+
+/********* 内部辅助：擦写期间屏蔽Flash中的低优先级中断，返回原来的 BASEPRI *********/
+static uint32_t FlashCV_MaskFlashIrqs(void)
+{
+    uint32_t basepri = __get_BASEPRI();
+
+    // 只会提高屏蔽级别：调用者已经在临界区里时保持原样
+    __set_BASEPRI_MAX(FLASHCV_BUSY_MASK_PRIO << (8U - __NVIC_PRIO_BITS));
+    __ISB();
+    return basepri;
+}
+
+/********* 内部辅助：擦除若干连续扇区（需先 HAL_FLASH_Unlock） *********/
+static HAL_StatusTypeDef FlashCV_EraseSectors(uint32_t first_sector, uint32_t nb_sectors)
+{
+    HAL_StatusTypeDef status = HAL_OK;
+    uint8_t busy = flashcv_busy;
+    uint32_t basepri = FlashCV_MaskFlashIrqs();
+
+    flashcv_busy = 1U;
+    FlashCV_WaitBusy();
+
+    for (uint32_t sector = first_sector; sector < (first_sector + nb_sectors); sector++)
+    {
+        __HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_EOP | FLASHCV_PROGRAM_ERR_FLAGS);
+
+        // 2.7~3.6V 供电按字并行擦除，与 HAL 的 FLASH_VOLTAGE_RANGE_3 一致
+        FLASH->CR &= CR_PSIZE_MASK;
+        FLASH->CR |= FLASH_PSIZE_WORD;
+        FLASH->CR &= ~FLASH_CR_SNB;
+        FLASH->CR |= FLASH_CR_SER | (sector << FLASH_CR_SNB_Pos);
+        FLASH->CR |= FLASH_CR_STRT;
+
+        FlashCV_WaitBusy();
+
+        FLASH->CR &= ~(FLASH_CR_SER | FLASH_CR_SNB);
+
+        if (FLASH->SR & FLASHCV_PROGRAM_ERR_FLAGS)
+        {
+            __HAL_FLASH_CLEAR_FLAG(FLASHCV_PROGRAM_ERR_FLAGS);
+            status = HAL_ERROR;
+            break;
+        }
+    }
+
+    FlashCV_FlushCaches();
+    flashcv_busy = busy;
+    __set_BASEPRI(basepri);
+    return status;
+}
+
+/********* 擦写进行中（中断里调用） *********/
+uint8_t FlashCV_IsBusy(void)
+{
+    return flashcv_busy;
+}
+
+/********* 把中断向量表搬到SRAM *********/
+void FlashCV_RamInit(void)
+{
+    const uint32_t *src = (const uint32_t *)SCB->VTOR;
+    uint32_t primask = __get_PRIMASK();
+
+#if (FLASHCV_CRC_SLICES > 1)
+    FlashCV_CrcBuildSlices();   // CRC切片查表也在这里一次生成，之后任务和中断里都只读
+#endif
+
+    if (src == flashcv_ram_vectors) return;
+
+    __disable_irq();
+    for (uint32_t i = 0; i < FLASHCV_VECTOR_WORDS; i++)
+    {
+        flashcv_ram_vectors[i] = src[i];
+    }
+    SCB->VTOR = (uint32_t)flashcv_ram_vectors;
+    __DSB();
+    __ISB();
+    __set_PRIMASK(primask);
+}
+
+/********* 连续编程：一次设置PSIZE/PG，字间只轮询BSY *********/
+HAL_StatusTypeDef FlashCV_ProgramBuffer(uint32_t dst, const uint8_t *src, uint32_t len)
+{
+    volatile uint32_t *p = (volatile uint32_t *)dst;
+    HAL_StatusTypeDef status = HAL_OK;
+    uint32_t basepri;
+    uint32_t word;
+    uint8_t busy;
+
+    if ((dst & 3U) != 0U || src == NULL) return HAL_ERROR;
+    if (len == 0U) return HAL_OK;
+
+    busy = flashcv_busy;
+    basepri = FlashCV_MaskFlashIrqs();
+    flashcv_busy = 1U;
+    FlashCV_WaitBusy();
+
+    __HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_EOP | FLASHCV_PROGRAM_ERR_FLAGS);
+
+    FLASH->CR &= CR_PSIZE_MASK;
+    FLASH->CR |= FLASH_PSIZE_WORD | FLASH_CR_PG;
+
+    while (len >= 4U)
+    {
+        *p++ = __UNALIGNED_UINT32_READ(src);
+        FlashCV_WaitBusy();
+        src += 4;
+        len -= 4U;
+    }
+
+    if (len > 0U)
+    {
+        word = 0xFFFFFFFFUL;
+        for (uint32_t i = 0; i < len; i++)
+        {
+            ((uint8_t *)&word)[i] = src[i];
+        }
+        *p = word;
+        FlashCV_WaitBusy();
+    }
+
+    FLASH->CR &= ~FLASH_CR_PG;
+
+    if (FLASH->SR & FLASHCV_PROGRAM_ERR_FLAGS)
+    {
+        __HAL_FLASH_CLEAR_FLAG(FLASHCV_PROGRAM_ERR_FLAGS);
+        status = HAL_ERROR;
+    }
+    else
+    {
+        // ART 缓存里可能还留着编程前读到的旧值
+        FlashCV_FlushCaches();
+    }
+
+    flashcv_busy = busy;
+    __set_BASEPRI(basepri);
+    return status;
+}
+
+/********* 元数据日志：每个日志扇区的记录槽数 *********/
+#define FLASHCV_JOURNAL_SLOTS      (FLASH_JOURNAL_SIZE / sizeof(MetaRecord_t))
+
+/********* 内部辅助：记录的CRC（覆盖 seq、meta、session、slot，不含原地编程的进度位图和启动次数） *********/
+static uint32_t FlashCV_RecordCrc(const MetaRecord_t *rec)
+{
+    return FlashCV_CrcFinal(FlashCV_CrcUpdate(FlashCV_CrcInit(), (const uint8_t *)rec,
+                                              offsetof(MetaRecord_t, crc)));
+}
+
+/********* 内部辅助：日志扇区 bank 的第一条记录 *********/
+static const MetaRecord_t *FlashCV_JournalBase(uint32_t bank)
+{
+    return (const MetaRecord_t *)(FLASH_JOURNAL_ADDR + bank * FLASH_JOURNAL_SIZE);
+}
+
+/********* 内部辅助：日志扇区 bank 中第一个空白记录槽（记录总是从头连续追加，二分查找即可） *********/
+static uint32_t FlashCV_JournalHead(uint32_t bank)
+{
+    const MetaRecord_t *rec = FlashCV_JournalBase(bank);
+    uint32_t lo = 0U;
+    uint32_t hi = FLASHCV_JOURNAL_SLOTS;
+
+    while (lo < hi)
+    {
+        uint32_t mid = (lo + hi) / 2U;
+        if (rec[mid].seq == 0xFFFFFFFFUL)
+            hi = mid;
+        else
+            lo = mid + 1U;
+    }
+
+    return lo;
+}
+
+/********* 内部辅助：最新的有效记录，取两个日志扇区中序号较大的一条；没有有效记录时返回 NULL *********/
+static const MetaRecord_t *FlashCV_JournalFind(uint32_t *bank)
+{
+    const MetaRecord_t *latest = NULL;
+
+    for (uint32_t b = 0; b < FLASH_JOURNAL_BANKS; b++)
+    {
+        const MetaRecord_t *rec = FlashCV_JournalBase(b);
+        uint32_t i = FlashCV_JournalHead(b);
+
+        // 每个扇区擦除后的第一条都是完整写入的最新状态；第一条就无效的扇区（没写完，
+        // 或旧布局留下的槽B镜像）不会再往里追加，整个跳过
+        if (i == 0U || rec[0].crc != FlashCV_RecordCrc(&rec[0])) continue;
+
+        // 最后一条可能是掉电时写了一半的，往前找CRC正确的一条
+        while (i > 0U)
+        {
+            i--;
+            if (rec[i].crc == FlashCV_RecordCrc(&rec[i]))
+            {
+                if (latest == NULL || rec[i].seq > latest->seq)
+                {
+                    latest = &rec[i];
+                    if (bank != NULL) *bank = b;
+                }
+                break;
+            }
+        }
+    }
+
+    return latest;
+}
+
+static const MetaRecord_t *FlashCV_JournalLatest(void)
+{
+    return FlashCV_JournalFind(NULL);
+}
+
+/********* 内部辅助：取当前状态（日志为空时从旧版元数据页迁移） *********/
+static void FlashCV_LoadRecord(MetaRecord_t *rec)
+{
+    const MetaRecord_t *latest = FlashCV_JournalLatest();
+
+    if (latest != NULL)
+    {
+        memcpy(rec, latest, sizeof(MetaRecord_t));
+        return;
+    }
+
+    memset(rec, 0xFF, sizeof(MetaRecord_t));
+    rec->seq = 0U;
+    rec->session.magic = 0U;
+    rec->slot[BOOT_SLOT_A].magic = 0U;
+    rec->slot[BOOT_SLOT_B].magic = 0U;
+    memcpy(&rec->meta, (const void *)FLASH_META_ADDR, sizeof(BootMeta_t));
+}
+
+/********* 内部辅助：追加一条记录，当前日志扇区写满时换到另一个扇区 *********/
+static HAL_StatusTypeDef FlashCV_AppendRecord(MetaRecord_t *rec)
+{
+    HAL_StatusTypeDef status = HAL_OK;
+    uint32_t bank = 0U;
+    uint32_t head = FLASHCV_JOURNAL_SLOTS;
+
+    if (FlashCV_JournalFind(&bank) != NULL)
+    {
+        head = FlashCV_JournalHead(bank);
+        if (head >= FLASHCV_JOURNAL_SLOTS) bank ^= 1U;
+    }
+
+    rec->seq++;
+    rec->crc = FlashCV_RecordCrc(rec);
+
+    HAL_FLASH_Unlock();
+
+    if (head >= FLASHCV_JOURNAL_SLOTS)
+    {
+        // 压缩：擦除另一个扇区，最新状态作为它的第一条写入。旧扇区要到下一次轮换才擦，
+        // 擦除或写入途中掉电时最新记录仍留在旧扇区里（日志为空时直接用第一个扇区）
+        status = FlashCV_EraseSectors(FLASH_JOURNAL_SECTOR + bank, 1);
+        head = 0U;
+    }
+
+    if (status == HAL_OK)
+    {
+        status = FlashCV_ProgramBuffer((uint32_t)&FlashCV_JournalBase(bank)[head],
+                                       (const uint8_t *)rec, sizeof(MetaRecord_t));
+    }
+
+    HAL_FLASH_Lock();
+    return status;
+}
+
+/********* 读取元数据 *********/
+void FlashCV_ReadMeta(BootMeta_t *meta)
+{
+    MetaRecord_t rec;
+
+    if (meta == NULL) return;
+
+    FlashCV_LoadRecord(&rec);
+    memcpy(meta, &rec.meta, sizeof(BootMeta_t));
+}
+
+/********* 写入元数据：追加一条日志记录，同时结束升级会话 *********/
+HAL_StatusTypeDef FlashCV_WriteMeta(const BootMeta_t *meta)
+{
+    MetaRecord_t rec;
+
+    if (meta == NULL) return HAL_ERROR;
+
+    FlashCV_LoadRecord(&rec);
+    rec.meta = *meta;
+    rec.session.magic = 0U;
+    memset(rec.progress, 0xFF, sizeof(rec.progress));
+
+    return FlashCV_AppendRecord(&rec);
+}
+
+/********* 将 flag 从 VALID 改为 DONE：镜像已搬到槽A，槽A成为活动槽 *********/
+HAL_StatusTypeDef FlashCV_ClearMetaFlag(void)
+{
+    MetaRecord_t rec;
+    FlashCV_LoadRecord(&rec);
+
+    if (rec.meta.flag != UPGRADE_FLAG_VALID)
+        return HAL_OK; // 本来就不是有效升级，直接返回
+
+    rec.meta.flag        = UPGRADE_FLAG_DONE;
+    rec.meta.active_slot = BOOT_SLOT_A;
+    rec.meta.boot_state  = BOOT_STATE_CONFIRMED;   // 旧镜像已被覆盖，没有可回滚的目标
+    rec.slot[BOOT_SLOT_A].magic      = SLOT_HEADER_MAGIC;
+    rec.slot[BOOT_SLOT_A].image_size = rec.meta.image_size;
+    rec.slot[BOOT_SLOT_A].image_crc  = rec.meta.image_crc;
+    rec.slot[BOOT_SLOT_A].version    = rec.meta.version;
+    rec.session.magic = 0U;
+    memset(rec.progress, 0xFF, sizeof(rec.progress));
+
+    return FlashCV_AppendRecord(&rec);
+}
+
+/********* 下载区标记为已擦除 *********/
+HAL_StatusTypeDef FlashCV_MarkDownloadClean(void)
+{
+    BootMeta_t meta;
+    FlashCV_ReadMeta(&meta);
+
+    if (meta.slot_state == DOWNLOAD_SLOT_CLEAN)
+        return HAL_OK;
+
+    meta.slot_state = DOWNLOAD_SLOT_CLEAN;
+    return FlashCV_WriteMeta(&meta);
+}
+
+/********* 下载区标记为已写脏：会话和进度原样带到新记录 *********/
+HAL_StatusTypeDef FlashCV_MarkDownloadDirty(void)
+{
+    MetaRecord_t rec;
+    FlashCV_LoadRecord(&rec);
+
+    if (rec.meta.slot_state == DOWNLOAD_SLOT_DIRTY)
+        return HAL_OK;
+
+    rec.meta.slot_state = DOWNLOAD_SLOT_DIRTY;
+    return FlashCV_AppendRecord(&rec);
+}
+
+/********* 读取会话记录与进度位图 *********/
+void FlashCV_ReadSession(BootSession_t *session, uint32_t *progress)
+{
+    MetaRecord_t rec;
+    FlashCV_LoadRecord(&rec);
+
+    if (session != NULL)
+        memcpy(session, &rec.session, sizeof(BootSession_t));
+
+    if (progress != NULL)
+        memcpy(progress, rec.progress, sizeof(rec.progress));
+}
+
+/********* 开始新会话：下载区标记为 DIRTY + 会话记录，一条日志记录完成 *********/
+HAL_StatusTypeDef FlashCV_BeginSession(const BootSession_t *session)
+{
+    MetaRecord_t rec;
+
+    if (session == NULL) return HAL_ERROR;
+
+    FlashCV_LoadRecord(&rec);
+    rec.meta.slot_state = DOWNLOAD_SLOT_DIRTY;
+    rec.session = *session;
+    rec.session.magic = SESSION_MAGIC;
+    memset(rec.progress, 0xFF, sizeof(rec.progress));
+    if (session->slot < BOOT_SLOT_COUNT)
+        rec.slot[session->slot].magic = 0U;   // 目标槽开始被改写，里面的旧镜像不再可用
+
+    return FlashCV_AppendRecord(&rec);
+}
+
+/********* 作废会话 *********/
+HAL_StatusTypeDef FlashCV_DropSession(void)
+{
+    MetaRecord_t rec;
+    FlashCV_LoadRecord(&rec);
+
+    if (rec.session.magic != SESSION_MAGIC)
+        return HAL_OK;
+
+    rec.session.magic = 0U;
+    memset(rec.progress, 0xFF, sizeof(rec.progress));
+    return FlashCV_AppendRecord(&rec);
+}
+
+/********* 最新记录的进度位图中对应位原地编程为0 *********/
+HAL_StatusTypeDef FlashCV_MarkProgress(uint32_t index)
+{
+    HAL_StatusTypeDef status;
+    const MetaRecord_t *latest = FlashCV_JournalLatest();
+    uint32_t addr, value;
+
+    if (latest == NULL || index >= FLASHCV_PROGRESS_WORDS * 32U) return HAL_ERROR;
+
+    addr  = (uint32_t)&latest->progress[index / 32U];
+    value = *(volatile const uint32_t *)addr & ~(1UL << (index % 32U));
+
+    if (*(volatile const uint32_t *)addr == value)
+        return HAL_OK;
+
+    HAL_FLASH_Unlock();
+    status = FlashCV_ProgramBuffer(addr, (const uint8_t *)&value, sizeof(value));
+    HAL_FLASH_Lock();
+
+    return status;
+}
+
+/********* 槽的起始地址与大小 *********/
+uint32_t FlashCV_SlotAddr(uint32_t slot)
+{
+    return (slot == BOOT_SLOT_B) ? FLASH_SLOT_B_ADDR : FLASH_SLOT_A_ADDR;
+}
+
+uint32_t FlashCV_SlotSize(uint32_t slot)
+{
+    return (slot == BOOT_SLOT_B) ? FLASH_SLOT_B_SIZE : FLASH_SLOT_A_SIZE;
+}
+
+/********* 读取槽头 *********/
+void FlashCV_ReadSlot(uint32_t slot, SlotHeader_t *hdr)
+{
+    MetaRecord_t rec;
+
+    if (hdr == NULL) return;
+
+    FlashCV_LoadRecord(&rec);
+    if (slot >= BOOT_SLOT_COUNT)
+    {
+        memset(hdr, 0, sizeof(SlotHeader_t));
+        return;
+    }
+    memcpy(hdr, &rec.slot[slot], sizeof(SlotHeader_t));
+}
+
+/********* 向量表检查：栈顶在SRAM、复位向量在镜像范围内 *********/
+uint8_t FlashCV_CheckVectors(uint32_t slot, uint32_t image_size)
+{
+    uint32_t base  = FlashCV_SlotAddr(slot);
+    uint32_t sp    = *(volatile const uint32_t *)base;
+    uint32_t reset = *(volatile const uint32_t *)(base + 4U);
+
+    if (image_size < 8U || image_size > FlashCV_SlotSize(slot)) return 0U;
+    if (sp < SRAM1_BASE || sp > (SRAM1_BASE + 0x20000UL)) return 0U;
+    if ((reset & 1U) == 0U) return 0U;                       // Thumb 位
+    reset &= ~1UL;
+    return (reset >= base && reset < (base + image_size)) ? 1U : 0U;
+}
+
+/********* 槽头 + 向量表 + 整片CRC *********/
+uint8_t FlashCV_SlotValid(uint32_t slot, const SlotHeader_t *hdr)
+{
+    if (slot >= BOOT_SLOT_COUNT || hdr == NULL) return 0U;
+    if (hdr->magic != SLOT_HEADER_MAGIC) return 0U;
+    if (!FlashCV_CheckVectors(slot, hdr->image_size)) return 0U;
+
+    return (FlashCV_CalcCRC(FlashCV_SlotAddr(slot), hdr->image_size) == hdr->image_crc) ? 1U : 0U;
+}
+
+/********* 作废槽头 *********/
+HAL_StatusTypeDef FlashCV_InvalidateSlot(uint32_t slot)
+{
+    MetaRecord_t rec;
+
+    if (slot >= BOOT_SLOT_COUNT) return HAL_ERROR;
+
+    FlashCV_LoadRecord(&rec);
+    if (rec.slot[slot].magic != SLOT_HEADER_MAGIC)
+        return HAL_OK;
+
+    rec.slot[slot].magic = 0U;
+    if (rec.meta.active_slot == slot)
+    {
+        rec.meta.active_slot = (slot == BOOT_SLOT_A) ? BOOT_SLOT_B : BOOT_SLOT_A;
+        rec.meta.boot_state  = BOOT_STATE_CONFIRMED;
+        rec.attempts = 0xFFFFFFFFUL;
+    }
+    return FlashCV_AppendRecord(&rec);
+}
+
+/********* 提交升级：一条记录完成槽头写入和活动槽切换 *********/
+HAL_StatusTypeDef FlashCV_CommitSlot(uint32_t slot, const SlotHeader_t *hdr)
+{
+    MetaRecord_t rec;
+
+    if (slot >= BOOT_SLOT_COUNT || hdr == NULL) return HAL_ERROR;
+
+    FlashCV_LoadRecord(&rec);
+    rec.slot[slot] = *hdr;
+    rec.slot[slot].magic = SLOT_HEADER_MAGIC;
+
+    rec.meta.flag        = UPGRADE_FLAG_DONE;
+    rec.meta.image_size  = hdr->image_size;
+    rec.meta.image_crc   = hdr->image_crc;
+    rec.meta.version     = hdr->version;
+    rec.meta.slot_state  = DOWNLOAD_SLOT_DIRTY;    // 原活动槽成为下一次的下载目标，里面是旧镜像
+    rec.meta.active_slot = slot;
+    rec.meta.boot_state  = BOOT_STATE_TRIAL;       // 应用确认之前，Bootloader 按启动次数决定是否回滚
+    rec.attempts = 0xFFFFFFFFUL;
+
+    rec.session.magic = 0U;
+    memset(rec.progress, 0xFF, sizeof(rec.progress));
+
+    return FlashCV_AppendRecord(&rec);
+}
+
+/********* 试运行启动次数：attempts 位图中为0的位数 *********/
+uint32_t FlashCV_BootAttempts(void)
+{
+    const MetaRecord_t *latest = FlashCV_JournalLatest();
+    uint32_t bits, n = 0U;
+
+    if (latest == NULL) return 0U;
+
+    for (bits = ~latest->attempts; bits != 0U; bits &= bits - 1U)
+        n++;
+    return n;
+}
+
+/********* 最新记录的 attempts 位图原地再清一位 *********/
+HAL_StatusTypeDef FlashCV_MarkBootAttempt(void)
+{
+    HAL_StatusTypeDef status;
+    const MetaRecord_t *latest = FlashCV_JournalLatest();
+    uint32_t addr, value;
+
+    if (latest == NULL) return HAL_ERROR;
+
+    addr  = (uint32_t)&latest->attempts;
+    value = *(volatile const uint32_t *)addr;
+    if (value == 0U)
+        return HAL_OK;               // 32次用完，不再记录
+    value &= value - 1U;             // 清掉最低的一个1
+
+    HAL_FLASH_Unlock();
+    status = FlashCV_ProgramBuffer(addr, (const uint8_t *)&value, sizeof(value));
+    HAL_FLASH_Lock();
+
+    return status;
+}
+
+/********* 确认活动槽：结束试运行 *********/
+HAL_StatusTypeDef FlashCV_ConfirmSlot(uint32_t slot)
+{
+    MetaRecord_t rec;
+    FlashCV_LoadRecord(&rec);
+
+    if (rec.meta.boot_state != BOOT_STATE_TRIAL || rec.meta.active_slot != slot)
+        return HAL_OK;
+
+    rec.meta.boot_state = BOOT_STATE_CONFIRMED;
+    rec.attempts = 0xFFFFFFFFUL;
+    return FlashCV_AppendRecord(&rec);
+}
+
+/********* 切换活动槽：一条记录完成回滚，两个槽的镜像都保留 *********/
+HAL_StatusTypeDef FlashCV_SwitchSlot(uint32_t slot)
+{
+    MetaRecord_t rec;
+
+    if (slot >= BOOT_SLOT_COUNT) return HAL_ERROR;
+
+    FlashCV_LoadRecord(&rec);
+    if (rec.slot[slot].magic != SLOT_HEADER_MAGIC)
+        return HAL_ERROR;
+
+    rec.meta.flag        = UPGRADE_FLAG_DONE;
+    rec.meta.image_size  = rec.slot[slot].image_size;
+    rec.meta.image_crc   = rec.slot[slot].image_crc;
+    rec.meta.version     = rec.slot[slot].version;
+    rec.meta.slot_state  = DOWNLOAD_SLOT_DIRTY;
+    rec.meta.active_slot = slot;
+    rec.meta.boot_state  = BOOT_STATE_CONFIRMED;
+    rec.attempts = 0xFFFFFFFFUL;
+
+    rec.session.magic = 0U;
+    memset(rec.progress, 0xFF, sizeof(rec.progress));
+
+    return FlashCV_AppendRecord(&rec);
+}
+
+/********* 地址所在扇区的结束地址 *********/
+uint32_t FlashCV_SectorEnd(uint32_t addr)
+{
+    for (uint32_t sector = 0; sector < FLASHCV_SECTOR_COUNT; sector++)
+    {
+        if (addr >= flashcv_sector_start[sector] && addr < flashcv_sector_start[sector + 1U])
+            return flashcv_sector_start[sector + 1U];
+    }
+
+    return addr;
+}
+
+/********* 空白检查：逐字比较 0xFFFFFFFF，遇到第一个非空白字即返回 *********/
+uint8_t FlashCV_IsBlank(uint32_t start_addr, uint32_t length)
+{
+    const uint8_t *p = (const uint8_t *)start_addr;
+
+    // 头部不对齐的字节
+    while (length > 0U && ((uint32_t)p & 3U) != 0U)
+    {
+        if (*p++ != 0xFFU) return 0;
+        length--;
+    }
+
+    const uint32_t *w = (const uint32_t *)p;
+    while (length >= 4U)
+    {
+        if (*w++ != 0xFFFFFFFFUL) return 0;
+        length -= 4U;
+    }
+
+    p = (const uint8_t *)w;
+    while (length > 0U)
+    {
+        if (*p++ != 0xFFU) return 0;
+        length--;
+    }
+
+    return 1;
+}
+
+/********* 按地址范围擦除：只擦覆盖到且不空白的扇区 *********/
+HAL_StatusTypeDef FlashCV_EraseRange(uint32_t start_addr, uint32_t length)
+{
+    HAL_StatusTypeDef status = HAL_OK;
+    uint32_t end_addr = start_addr + length;
+
+    if (length == 0U) return HAL_OK;
+    if (start_addr < flashcv_sector_start[0] ||
+        end_addr > flashcv_sector_start[FLASHCV_SECTOR_COUNT] || end_addr < start_addr)
+        return HAL_ERROR;
+
+    HAL_FLASH_Unlock();
+
+    for (uint32_t sector = 0; sector < FLASHCV_SECTOR_COUNT; sector++)
+    {
+        uint32_t lo = flashcv_sector_start[sector];
+        uint32_t hi = flashcv_sector_start[sector + 1U];
+
+        if (lo < start_addr) lo = start_addr;
+        if (hi > end_addr)   hi = end_addr;
+        if (lo >= hi) continue;
+
+        // 只需保证本次要写的范围是空白的；读一遍 128KB 不到1ms，擦除要1~2s
+        if (FlashCV_IsBlank(lo, hi - lo)) continue;
+
+        status = FlashCV_EraseSectors(sector, 1);
+        if (status != HAL_OK) break;
+    }
+
+    HAL_FLASH_Lock();
+
+    return status;
+}
+
+/********* 擦除 App 区：Sector 2~4 *********/
+HAL_StatusTypeDef FlashCV_EraseAppArea(void)
+{
+    return FlashCV_EraseRange(FLASH_APP_START_ADDR, FLASH_APP_END_ADDR - FLASH_APP_START_ADDR + 1U);
+}
+
+/********* 搬运缓冲区：每个源数据块只从下载区读一次 *********/
+static uint32_t flashcv_copy_buf[FLASHCV_COPY_BLOCK / 4U];
+
+/********* 边搬运边校验：读源块 -> 累加源CRC -> 编程 -> 回读累加目标CRC *********/
+HAL_StatusTypeDef FlashCV_CopyImageToApp(uint32_t img_size, uint32_t *src_crc, uint32_t *dst_crc)
+{
+    HAL_StatusTypeDef status;
+    uint32_t crc_src = FlashCV_CrcInit();
+    uint32_t crc_dst = FlashCV_CrcInit();
+    uint32_t offset, n;
+
+    // 基本保护
+    if (img_size == 0) return HAL_ERROR;
+    if ((FLASH_DOWNLOAD_START_ADDR + img_size) > (FLASH_DOWNLOAD_END_ADDR + 1))
+        return HAL_ERROR;
+    if ((FLASH_APP_START_ADDR + img_size) > (FLASH_APP_END_ADDR + 1))
+        return HAL_ERROR;
+
+    // 先擦除App区：只擦固件覆盖到的扇区
+    status = FlashCV_EraseRange(FLASH_APP_START_ADDR, img_size);
+    if (status != HAL_OK) return status;
+
+    HAL_FLASH_Unlock();
+
+    for (offset = 0; offset < img_size && status == HAL_OK; offset += n)
+    {
+        n = img_size - offset;
+        if (n > FLASHCV_COPY_BLOCK) n = FLASHCV_COPY_BLOCK;
+
+        // 源数据只读这一次：CRC 和编程都用RAM里的副本
+        memcpy(flashcv_copy_buf, (const void *)(FLASH_DOWNLOAD_START_ADDR + offset), n);
+        crc_src = FlashCV_CrcUpdate(crc_src, (const uint8_t *)flashcv_copy_buf, n);
+
+        status = FlashCV_ProgramBuffer(FLASH_APP_START_ADDR + offset, (const uint8_t *)flashcv_copy_buf, n);
+
+        // 回读刚写入的块累加目标CRC（编程后已复位ART缓存，读到的是Flash中的实际内容）
+        crc_dst = FlashCV_CrcUpdate(crc_dst, (const uint8_t *)(FLASH_APP_START_ADDR + offset), n);
+    }
+
+    HAL_FLASH_Lock();
+
+    if (src_crc != NULL) *src_crc = FlashCV_CrcFinal(crc_src);
+    if (dst_crc != NULL) *dst_crc = FlashCV_CrcFinal(crc_dst);
+
+    return status;
+}
+
+
+/********* 标准CRC-32查表（反射多项式 0xEDB88320） *********/
+static const uint32_t crc_table[256] = {
+    0x00000000, 0x77073096, 0xee0e612c, 0x990951ba, 0x076dc419, 0x706af48f,
+    0xe963a535, 0x9e6495a3, 0x0edb8832, 0x79dcb8a4, 0xe0d5e91e, 0x97d2d988,
+    0x09b64c2b, 0x7eb17cbd, 0xe7b82d07, 0x90bf1d91, 0x1db71064, 0x6ab020f2,
+    0xf3b97148, 0x84be41de, 0x1adad47d, 0x6ddde4eb, 0xf4d4b551, 0x83d385c7,
+    0x136c9856, 0x646ba8c0, 0xfd62f97a, 0x8a65c9ec, 0x14015c4f, 0x63066cd9,
+    0xfa0f3d63, 0x8d080df5, 0x3b6e20c8, 0x4c69105e, 0xd56041e4, 0xa2677172,
+    0x3c03e4d1, 0x4b04d447, 0xd20d85fd, 0xa50ab56b, 0x35b5a8fa, 0x42b2986c,
+    0xdbbbc9d6, 0xacbcf940, 0x32d86ce3, 0x45df5c75, 0xdcd60dcf, 0xabd13d59,
+    0x26d930ac, 0x51de003a, 0xc8d75180, 0xbfd06116, 0x21b4f4b5, 0x56b3c423,
+    0xcfba9599, 0xb8bda50f, 0x2802b89e, 0x5f058808, 0xc60cd9b2, 0xb10be924,
+    0x2f6f7c87, 0x58684c11, 0xc1611dab, 0xb6662d3d, 0x76dc4190, 0x01db7106,
+    0x98d220bc, 0xefd5102a, 0x71b18589, 0x06b6b51f, 0x9fbfe4a5, 0xe8b8d433,
+    0x7807c9a2, 0x0f00f934, 0x9609a88e, 0xe10e9818, 0x7f6a0dbb, 0x086d3d2d,
+    0x91646c97, 0xe6635c01, 0x6b6b51f4, 0x1c6c6162, 0x856530d8, 0xf262004e,
+    0x6c0695ed, 0x1b01a57b, 0x8208f4c1, 0xf50fc457, 0x65b0d9c6, 0x12b7e950,
+    0x8bbeb8ea, 0xfcb9887c, 0x62dd1ddf, 0x15da2d49, 0x8cd37cf3, 0xfbd44c65,
+    0x4db26158, 0x3ab551ce, 0xa3bc0074, 0xd4bb30e2, 0x4adfa541, 0x3dd895d7,
+    0xa4d1c46d, 0xd3d6f4fb, 0x4369e96a, 0x346ed9fc, 0xad678846, 0xda60b8d0,
+    0x44042d73, 0x33031de5, 0xaa0a4c5f, 0xdd0d7cc9, 0x5005713c, 0x270241aa,
+    0xbe0b1010, 0xc90c2086, 0x5768b525, 0x206f85b3, 0xb966d409, 0xce61e49f,
+    0x5edef90e, 0x29d9c998, 0xb0d09822, 0xc7d7a8b4, 0x59b33d17, 0x2eb40d81,
+    0xb7bd5c3b, 0xc0ba6cad, 0xedb88320, 0x9abfb3b6, 0x03b6e20c, 0x74b1d29a,
+    0xead54739, 0x9dd277af, 0x04db2615, 0x73dc1683, 0xe3630b12, 0x94643b84,
+    0x0d6d6a3e, 0x7a6a5aa8, 0xe40ecf0b, 0x9309ff9d, 0x0a00ae27, 0x7d079eb1,
+    0xf00f9344, 0x8708a3d2, 0x1e01f268, 0x6906c2fe, 0xf762575d, 0x806567cb,
+    0x196c3671, 0x6e6b06e7, 0xfed41b76, 0x89d32be0, 0x10da7a5a, 0x67dd4acc,
+    0xf9b9df6f, 0x8ebeeff9, 0x17b7be43, 0x60b08ed5, 0xd6d6a3e8, 0xa1d1937e,
+    0x38d8c2c4, 0x4fdff252, 0xd1bb67f1, 0xa6bc5767, 0x3fb506dd, 0x48b2364b,
+    0xd80d2bda, 0xaf0a1b4c, 0x36034af6, 0x41047a60, 0xdf60efc3, 0xa867df55,
+    0x316e8eef, 0x4669be79, 0xcb61b38c, 0xbc66831a, 0x256fd2a0, 0x5268e236,
+    0xcc0c7795, 0xbb0b4703, 0x220216b9, 0x5505262f, 0xc5ba3bbe, 0xb2bd0b28,
+    0x2bb45a92, 0x5cb36a04, 0xc2d7ffa7, 0xb5d0cf31, 0x2cd99e8b, 0x5bdeae1d,
+    0x9b64c2b0, 0xec63f226, 0x756aa39c, 0x026d930a, 0x9c0906a9, 0xeb0e363f,
+    0x72076785, 0x05005713, 0x95bf4a82, 0xe2b87a14, 0x7bb12bae, 0x0cb61b38,
+    0x92d28e9b, 0xe5d5be0d, 0x7cdcefb7, 0x0bdbdf21, 0x86d3d2d4, 0xf1d4e242,
+    0x68ddb3f8, 0x1fda836e, 0x81be16cd, 0xf6b9265b, 0x6fb077e1, 0x18b74777,
+    0x88085ae6, 0xff0f6a70, 0x66063bca, 0x11010b5c, 0x8f659eff, 0xf862ae69,
+    0x616bffd3, 0x166ccf45, 0xa00ae278, 0xd70dd2ee, 0x4e048354, 0x3903b3c2,
+    0xa7672661, 0xd06016f7, 0x4969474d, 0x3e6e77db, 0xaed16a4a, 0xd9d65adc,
+    0x40df0b66, 0x37d83bf0, 0xa9bcae53, 0xdebb9ec5, 0x47b2cf7f, 0x30b5ffe9,
+    0xbdbdf21c, 0xcabac28a, 0x53b39330, 0x24b4a3a6, 0xbad03605, 0xcdd70693,
+    0x54de5729, 0x23d967bf, 0xb3667a2e, 0xc4614ab8, 0x5d681b02, 0x2a6f2b94,
+    0xb40bbe37, 0xc30c8ea1, 0x5a05df1b, 0x2d02ef8d
+};
+
+#if (FLASHCV_CRC_SLICES > 1)
+/**
+ * @brief 切片查表：crc_slice[k-1][i] 表示字节 i 后面再跟 k 个 0 字节的 CRC 余数
+ * @note  放在 SRAM 中，由 FlashCV_RamInit 在开中断、启动调度器之前一次生成；
+ *        查表是随机访问，放 SRAM 比放 Flash 少掉等待周期
+ */
+static uint32_t crc_slice[FLASHCV_CRC_SLICES - 1][256];
+static volatile uint8_t crc_slice_ready = 0;   // 置位前的CRC计算走逐字节查表
+
+/********* 内部辅助：生成切片查表（只在 FlashCV_RamInit 中调用一次） *********/
+static void FlashCV_CrcBuildSlices(void)
+{
+    if (crc_slice_ready) return;
+
+    for (uint32_t i = 0; i < 256U; i++)
+    {
+        uint32_t c = crc_table[i];
+        for (uint32_t k = 0; k < (FLASHCV_CRC_SLICES - 1U); k++)
+        {
+            c = (c >> 8) ^ crc_table[c & 0xFFU];
+            crc_slice[k][i] = c;
+        }
+    }
+
+    __DMB();   // 查表写完之后才能让其他上下文看到就绪标志
+    crc_slice_ready = 1;
+}
+#endif
+
+/********* 内部辅助：软件CRC-32核心（不含初值与结果异或） *********/
+static uint32_t FlashCV_CrcSoft(uint32_t crc, const uint8_t *data, uint32_t length)
+{
+#if (FLASHCV_CRC_SLICES > 1)
+    // 查表由 FlashCV_RamInit 生成；生成之前全部走尾部的逐字节查表
+    if (crc_slice_ready)
+    {
+        // 头部：逐字节处理到4字节对齐
+        while (length > 0U && ((uint32_t)data & 3U) != 0U)
+        {
+            crc = (crc >> 8) ^ crc_table[(crc ^ *data++) & 0xFFU];
+            length--;
+        }
+
+#if (FLASHCV_CRC_SLICES == 8)
+        // 主体：每次 8 字节（两个对齐字），小端序
+        while (length >= 8U)
+        {
+            uint32_t lo = *(const uint32_t *)data ^ crc;
+            uint32_t hi = *(const uint32_t *)(data + 4);
+            crc = crc_slice[6][lo & 0xFFU]         ^ crc_slice[5][(lo >> 8) & 0xFFU]
+                ^ crc_slice[4][(lo >> 16) & 0xFFU] ^ crc_slice[3][lo >> 24]
+                ^ crc_slice[2][hi & 0xFFU]         ^ crc_slice[1][(hi >> 8) & 0xFFU]
+                ^ crc_slice[0][(hi >> 16) & 0xFFU] ^ crc_table[hi >> 24];
+            data   += 8;
+            length -= 8U;
+        }
+#endif
+
+        // 主体：每次 4 字节
+        while (length >= 4U)
+        {
+            uint32_t w = *(const uint32_t *)data ^ crc;
+            crc = crc_slice[2][w & 0xFFU]         ^ crc_slice[1][(w >> 8) & 0xFFU]
+                ^ crc_slice[0][(w >> 16) & 0xFFU] ^ crc_table[w >> 24];
+            data   += 4;
+            length -= 4U;
+        }
+    }
+#endif
+
+    // 尾部（或未走切片时的全部数据）：逐字节
+    while (length > 0U)
+    {
+        crc = (crc >> 8) ^ crc_table[(crc ^ *data++) & 0xFFU];
+        length--;
+    }
+
+    return crc;
+}
+
+#if FLASHCV_CRC_USE_HW
+/**
+ * @brief 硬件CRC单元占用标志
+ * @note  中断里的帧校验可能打断任务里的整片校验，抢不到硬件单元的一方走软件查表
+ */
+static volatile uint8_t crc_hw_busy = 0;
+
+/********* 内部辅助：尝试占用硬件CRC单元 *********/
+static uint8_t FlashCV_CrcHwAcquire(void)
+{
+    uint8_t ok = 0;
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    if (!crc_hw_busy)
+    {
+        crc_hw_busy = 1;
+        ok = 1;
+    }
+    __set_PRIMASK(primask);
+
+    return ok;
+}
+
+/********* 内部辅助：硬件CRC单元按字计算 *********/
+static uint32_t FlashCV_CrcHardWords(uint32_t crc, const uint32_t *words, uint32_t nwords)
+{
+    /*
+     * 硬件单元是 MSB-first 的 0x04C11DB7，复位值固定为 0xFFFFFFFF，且 F4 没有输入输出反转：
+     *  - 反射CRC的状态 = __RBIT(硬件状态)，小端字输入同样先 __RBIT 再写 DR；
+     *  - F4 不能直接写入初值，先把目标状态逆推 32 步得到 v，再写入 0xFFFFFFFF ^ v，
+     *    硬件算完这一字后 DR 即为目标状态，从而可以从任意中间状态接着算
+     */
+    uint32_t v = __RBIT(crc);
+    for (uint32_t i = 0; i < 32U; i++)
+    {
+        v = (v & 1U) ? (((v ^ 0x04C11DB7UL) >> 1) | 0x80000000UL) : (v >> 1);
+    }
+
+    // 寄存器经 WRITE_REG/READ_REG 访问，主机测试的 HAL 替身借此模拟CRC单元
+    __HAL_RCC_CRC_CLK_ENABLE();
+    WRITE_REG(CRC->CR, CRC_CR_RESET);
+    WRITE_REG(CRC->DR, 0xFFFFFFFFUL ^ v);
+
+    while (nwords--)
+    {
+        WRITE_REG(CRC->DR, __RBIT(*words++));
+    }
+
+    return __RBIT(READ_REG(CRC->DR));
+}
+#endif
+
+/********* 内部辅助：CRC-32核心（不含初值与结果异或） *********/
+static uint32_t FlashCV_CrcKernel(uint32_t crc, const uint8_t *data, uint32_t length)
+{
+#if FLASHCV_CRC_USE_HW
+    if (length >= FLASHCV_CRC_HW_MIN_LEN && FlashCV_CrcHwAcquire())
+    {
+        // 头部不对齐的字节先用软件算，中间整字交给硬件，尾部再回到软件
+        uint32_t head = (4U - ((uint32_t)data & 3U)) & 3U;
+        crc = FlashCV_CrcSoft(crc, data, head);
+        data   += head;
+        length -= head;
+
+        crc = FlashCV_CrcHardWords(crc, (const uint32_t *)data, length / 4U);
+        crc_hw_busy = 0;
+
+        data   += length & ~3UL;
+        length &= 3U;
+    }
+#endif
+
+    return FlashCV_CrcSoft(crc, data, length);
+}
+
+/********* 增量CRC-32：初值 *********/
+uint32_t FlashCV_CrcInit(void)
+{
+    return 0xFFFFFFFFUL;
+}
+
+/********* 增量CRC-32：累加一段数据 *********/
+uint32_t FlashCV_CrcUpdate(uint32_t crc, const uint8_t *data, uint32_t length)
+{
+    if (data == NULL || length == 0U) return crc;
+    return FlashCV_CrcKernel(crc, data, length);
+}
+
+/********* 增量CRC-32：结果异或 *********/
+uint32_t FlashCV_CrcFinal(uint32_t crc)
+{
+    return crc ^ 0xFFFFFFFFUL;
+}
+
+/**
+ * @brief x^(2^k) mod P 预计算表（k = 0..31，反射表示）
+ * @note  等价于 zlib 中 crc32_combine 使用的 GF(2) 移位矩阵逐次平方的结果，编译期常量，
+ *        合并时只需按长度的二进制位挑选若干项做多项式乘法
+ */
+static const uint32_t crc_x2n_table[32] = {
+    0x40000000UL, 0x20000000UL, 0x08000000UL, 0x00800000UL,
+    0x00008000UL, 0xedb88320UL, 0xb1e6b092UL, 0xa06a2517UL,
+    0xed627daeUL, 0x88d14467UL, 0xd7bbfe6aUL, 0xec447f11UL,
+    0x8e7ea170UL, 0x6427800eUL, 0x4d47bae0UL, 0x09fe548fUL,
+    0x83852d0fUL, 0x30362f1aUL, 0x7b5a9cc3UL, 0x31fec169UL,
+    0x9fec022aUL, 0x6c8dedc4UL, 0x15d6874dUL, 0x5fde7a4eUL,
+    0xbad90e37UL, 0x2e4e5eefUL, 0x4eaba214UL, 0xa8a472c0UL,
+    0x429a969eUL, 0x148d302aUL, 0xc40ba6d0UL, 0xc4e22c3cUL
+};
+
+/********* 内部辅助：GF(2) 多项式乘法 a*b mod P（反射表示） *********/
+static uint32_t FlashCV_CrcMultModP(uint32_t a, uint32_t b)
+{
+    uint32_t m = 0x80000000UL;
+    uint32_t p = 0;
+
+    while (m != 0U)
+    {
+        if (a & m)
+        {
+            p ^= b;
+            if ((a & (m - 1U)) == 0U) break;
+        }
+        m >>= 1;
+        b = (b & 1U) ? ((b >> 1) ^ 0xEDB88320UL) : (b >> 1);
+    }
+
+    return p;
+}
+
+/********* CRC-32合并：由 CRC(A)、CRC(B)、len(B) 得到 CRC(A||B) *********/
+uint32_t FlashCV_CrcCombine(uint32_t crc1, uint32_t crc2, uint32_t len2)
+{
+    // 计算 x^(8*len2) mod P，len2 的第 n 位对应表项 k = n + 3
+    uint32_t xn = 0x80000000UL;   // x^0
+    uint32_t k = 3;
+
+    while (len2 != 0U)
+    {
+        if (len2 & 1U) xn = FlashCV_CrcMultModP(crc_x2n_table[k & 31U], xn);
+        len2 >>= 1;
+        k++;
+    }
+
+    return FlashCV_CrcMultModP(xn, crc1) ^ crc2;
+}
+
+/********* 标准CRC-32校验 *********/
+uint32_t FlashCV_CalcCRC(uint32_t start_addr, uint32_t length)
+{
+    uint32_t crc = FlashCV_CrcUpdate(FlashCV_CrcInit(), (const uint8_t *)start_addr, length);
+    return FlashCV_CrcFinal(crc);
+}
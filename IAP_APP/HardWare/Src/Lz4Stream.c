@@ -0,0 +1,157 @@
+#include "Lz4Stream.h"
+#include <string.h>
+
+#define LZ4S_MASK          (LZ4S_WINDOW_SIZE - 1U)
+#define LZ4S_MIN_MATCH     4U
+
+/**
+ * @brief 解析状态：一个序列依次是 token、字面量长度扩展、字面量、匹配距离（2字节）、匹配长度扩展
+ */
+enum {
+    LZ4S_TOKEN = 0,
+    LZ4S_LIT_EXT,
+    LZ4S_LITERAL,
+    LZ4S_OFF_LO,
+    LZ4S_OFF_HI,
+    LZ4S_MATCH_EXT
+};
+
+/********* 内部辅助：把窗口中尚未输出的数据交给输出回调（跨窗口末尾时分两段） *********/
+static HAL_StatusTypeDef Lz4Stream_Flush(Lz4Stream_t *s)
+{
+    while (s->flushed < s->out)
+    {
+        uint32_t pos = s->flushed & LZ4S_MASK;
+        uint32_t n   = s->out - s->flushed;
+
+        if (n > (LZ4S_WINDOW_SIZE - pos)) n = LZ4S_WINDOW_SIZE - pos;
+        if (s->sink(s->flushed, &s->window[pos], n) != HAL_OK) return HAL_ERROR;
+        s->flushed += n;
+    }
+    return HAL_OK;
+}
+
+/********* 内部辅助：输出一个字节；窗口里全是未输出的数据时先写出，再覆盖最旧的字节 *********/
+static HAL_StatusTypeDef Lz4Stream_Put(Lz4Stream_t *s, uint8_t b)
+{
+    if (s->out >= s->out_limit) return HAL_ERROR;
+    if ((s->out - s->flushed) == LZ4S_WINDOW_SIZE && Lz4Stream_Flush(s) != HAL_OK) return HAL_ERROR;
+
+    s->window[s->out & LZ4S_MASK] = b;
+    s->out++;
+    return HAL_OK;
+}
+
+/********* 内部辅助：按匹配距离从窗口复制（距离小于长度时就是重复模式，逐字节复制即可） *********/
+static HAL_StatusTypeDef Lz4Stream_Copy(Lz4Stream_t *s)
+{
+    if (s->match_off == 0U || s->match_off > LZ4S_WINDOW_SIZE || s->match_off > s->out) return HAL_ERROR;
+
+    for (uint32_t i = 0; i < s->match_len; i++)
+    {
+        if (Lz4Stream_Put(s, s->window[(s->out - s->match_off) & LZ4S_MASK]) != HAL_OK) return HAL_ERROR;
+    }
+    return HAL_OK;
+}
+
+/********* 初始化 *********/
+void Lz4Stream_Init(Lz4Stream_t *s, uint32_t out_limit, Lz4Stream_Sink_t sink)
+{
+    memset(s, 0, sizeof(Lz4Stream_t));
+    s->out_limit = out_limit;
+    s->sink      = sink;
+    s->state     = LZ4S_TOKEN;
+}
+
+/********* 喂入一段压缩数据：逐字节推进状态机，字面量整段复制 *********/
+HAL_StatusTypeDef Lz4Stream_Feed(Lz4Stream_t *s, const uint8_t *data, uint32_t len)
+{
+    uint32_t i = 0;
+
+    if (s->error) return HAL_ERROR;
+
+    while (i < len)
+    {
+        uint8_t b = data[i];
+        HAL_StatusTypeDef st = HAL_OK;
+
+        switch (s->state)
+        {
+        case LZ4S_TOKEN:
+            s->lit_len   = b >> 4;
+            s->match_len = (b & 0x0FU) + LZ4S_MIN_MATCH;
+            s->state = (s->lit_len == 15U) ? LZ4S_LIT_EXT : (s->lit_len ? LZ4S_LITERAL : LZ4S_OFF_LO);
+            i++;
+            break;
+
+        case LZ4S_LIT_EXT:
+            s->lit_len += b;
+            if (b != 255U) s->state = LZ4S_LITERAL;
+            i++;
+            break;
+
+        case LZ4S_LITERAL:
+            while (i < len && s->lit_len > 0U && st == HAL_OK)
+            {
+                st = Lz4Stream_Put(s, data[i]);
+                i++;
+                s->lit_len--;
+            }
+            if (s->lit_len == 0U) s->state = LZ4S_OFF_LO;
+            break;
+
+        case LZ4S_OFF_LO:
+            s->match_off = b;
+            s->state = LZ4S_OFF_HI;
+            i++;
+            break;
+
+        case LZ4S_OFF_HI:
+            s->match_off |= (uint32_t)b << 8;
+            i++;
+            if (s->match_len == (15U + LZ4S_MIN_MATCH))
+            {
+                s->state = LZ4S_MATCH_EXT;
+            }
+            else
+            {
+                st = Lz4Stream_Copy(s);
+                s->state = LZ4S_TOKEN;
+            }
+            break;
+
+        case LZ4S_MATCH_EXT:
+            s->match_len += b;
+            i++;
+            if (b != 255U)
+            {
+                st = Lz4Stream_Copy(s);
+                s->state = LZ4S_TOKEN;
+            }
+            break;
+
+        default:
+            st = HAL_ERROR;
+            break;
+        }
+
+        if (st != HAL_OK)
+        {
+            s->error = 1U;
+            return HAL_ERROR;
+        }
+    }
+
+    if (Lz4Stream_Flush(s) != HAL_OK)
+    {
+        s->error = 1U;
+        return HAL_ERROR;
+    }
+    return HAL_OK;
+}
+
+/********* 最后一个序列只有字面量，解完后停在读匹配距离之前 *********/
+uint8_t Lz4Stream_Done(const Lz4Stream_t *s)
+{
+    return (!s->error && s->state == LZ4S_OFF_LO && s->flushed == s->out) ? 1U : 0U;
+}
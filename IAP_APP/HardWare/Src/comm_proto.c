@@ -1,306 +1,1018 @@
-
-/* comm_proto.c */
-#include "../Inc/comm_proto.h"
-#include "update_manager.h"
-#include "FlashCV.h"
-#include <string.h>
-
-/* 使用 USART1 */
-extern UART_HandleTypeDef huart1;
-
-/**
- * @brief 接收状态机状态枚举
- */
-typedef enum {
-    RX_STATE_HEAD1 = 0,    /*!< 等待帧头第一个字节 */
-    RX_STATE_HEAD2,        /*!< 等待帧头第二个字节 */
-    RX_STATE_CMD,          /*!< 接收命令字 */
-    RX_STATE_SEQ,          /*!< 接收序列号 */
-    RX_STATE_LEN_L,        /*!< 接收长度低字节 */
-    RX_STATE_LEN_H,        /*!< 接收长度高字节 */
-    RX_STATE_DATA,         /*!< 接收数据 */
-    RX_STATE_CRC0,         /*!< 接收CRC第0字节 */
-    RX_STATE_CRC1,         /*!< 接收CRC第1字节 */
-    RX_STATE_CRC2,         /*!< 接收CRC第2字节 */
-    RX_STATE_CRC3          /*!< 接收CRC第3字节 */
-} RxState_t;
-
-static RxState_t  rx_state = RX_STATE_HEAD1;  /*!< 接收状态机当前状态 */
-static uint8_t    rx_cmd;                     /*!< 接收到的命令字 */
-static uint8_t    rx_seq;                     /*!< 接收到的序列号 */
-static uint16_t   rx_len;                     /*!< 接收到的数据长度 */
-static uint8_t    rx_buf[COMM_MAX_PAYLOAD_LEN]; /*!< 数据接收缓冲区 */
-static uint16_t   rx_index;                   /*!< 数据接收索引 */
-static uint8_t    crc_bytes[4];               /*!< CRC字节缓冲区 */
-static uint8_t    crc_index;                  /*!< CRC接收索引 */
-static uint8_t    s_rx_byte;                  /*!< UART接收字节缓冲 */
-
-/**
- * @brief 计算数据的CRC32校验值
- * 
- * 使用FlashCV模块的CRC计算函数
- * @param data 数据指针
- * @param len 数据长度
- * @return uint32_t CRC32校验值
- */
-static uint32_t Comm_CalcCRC32(const uint8_t *data, uint32_t len)
-{
-    if (data == NULL || len == 0) {
-        return 0;
-    }
-
-    return FlashCV_CalcCRC((uint32_t)data, len);
-}
-
-/**
- * @brief 处理完整接收的数据包
- * 
- * 在CRC校验通过后调用，根据命令字执行相应操作
- * @param cmd 命令字
- * @param seq 序列号
- * @param data 数据指针
- * @param len 数据长度
- */
-static void Comm_HandlePacket(uint8_t cmd, uint8_t seq,
-                              const uint8_t *data, uint16_t len);
-
-/**
- * @brief 重置接收状态机
- * 
- * 将接收状态机恢复到初始状态
- */
-static void Comm_ResetRxState(void)
-{
-    rx_state = RX_STATE_HEAD1;
-}
-
-void Comm_Init(void)
-{
-    rx_state = RX_STATE_HEAD1;
-    HAL_UART_Receive_IT(&huart1, &s_rx_byte, 1);
-}
-
-/**
- * @brief UART接收完成回调函数
- * 
- * 在HAL库UART接收中断中调用
- * @param huart UART句柄指针
- */
-void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
-{
-    if (huart->Instance == USART1) {
-        Comm_OnByteReceived(s_rx_byte);
-        HAL_UART_Receive_IT(&huart1, &s_rx_byte, 1);
-    }
-}
-
-void Comm_OnByteReceived(uint8_t ch)
-{
-    switch (rx_state) {
-    case RX_STATE_HEAD1:
-        if (ch == COMM_HEAD1) rx_state = RX_STATE_HEAD2;
-        break;
-
-    case RX_STATE_HEAD2:
-        if (ch == COMM_HEAD2) rx_state = RX_STATE_CMD;
-        else rx_state = RX_STATE_HEAD1;
-        break;
-
-    case RX_STATE_CMD:
-        rx_cmd = ch;
-        rx_state = RX_STATE_SEQ;
-        break;
-
-    case RX_STATE_SEQ:
-        rx_seq = ch;
-        rx_state = RX_STATE_LEN_L;
-        break;
-
-    case RX_STATE_LEN_L:
-        rx_len = ch;
-        rx_state = RX_STATE_LEN_H;
-        break;
-
-    case RX_STATE_LEN_H:
-        rx_len |= ((uint16_t)ch << 8);
-        if (rx_len > COMM_MAX_PAYLOAD_LEN) {
-            Comm_ResetRxState();
-        } else {
-            rx_index = 0;
-            rx_state = (rx_len == 0U) ? RX_STATE_CRC0 : RX_STATE_DATA;
-        }
-        break;
-
-    case RX_STATE_DATA:
-        rx_buf[rx_index++] = ch;
-        if (rx_index >= rx_len) {
-            crc_index = 0;
-            rx_state  = RX_STATE_CRC0;
-        }
-        break;
-
-    case RX_STATE_CRC0:
-    case RX_STATE_CRC1:
-    case RX_STATE_CRC2:
-    case RX_STATE_CRC3:
-        crc_bytes[crc_index++] = ch;
-        if (crc_index >= 4U) {
-            uint32_t crc_recv =  (uint32_t)crc_bytes[0]
-                               | ((uint32_t)crc_bytes[1] << 8)
-                               | ((uint32_t)crc_bytes[2] << 16)
-                               | ((uint32_t)crc_bytes[3] << 24);
-
-            /* 计算从 CMD 到 DATA 的 CRC32 */
-            uint8_t tmp[4 + COMM_MAX_PAYLOAD_LEN];
-            uint16_t pos = 0;
-            tmp[pos++] = rx_cmd;
-            tmp[pos++] = rx_seq;
-            tmp[pos++] = (uint8_t)(rx_len & 0xFFU);
-            tmp[pos++] = (uint8_t)(rx_len >> 8);
-            if (rx_len > 0U) {
-                memcpy(&tmp[pos], rx_buf, rx_len);
-                pos += rx_len;
-            }
-            uint32_t crc_calc = Comm_CalcCRC32(tmp, pos);
-
-            if (crc_calc == crc_recv) {
-                Comm_HandlePacket(rx_cmd, rx_seq, rx_buf, rx_len);
-            } else {
-                Comm_SendAck(rx_cmd, rx_seq, COMM_STATUS_FRAME_CRC);
-            }
-
-            Comm_ResetRxState();
-        }
-        break;
-
-    default:
-        Comm_ResetRxState();
-        break;
-    }
-}
-
-void Comm_SendFrame(uint8_t cmd, uint8_t seq, const uint8_t *data, uint16_t len)
-{
-    uint8_t header[6];
-    header[0] = COMM_HEAD1;
-    header[1] = COMM_HEAD2;
-    header[2] = cmd;
-    header[3] = seq;
-    header[4] = (uint8_t)(len & 0xFFU);
-    header[5] = (uint8_t)(len >> 8);
-
-    uint8_t tmp[4 + COMM_MAX_PAYLOAD_LEN];
-    uint16_t pos = 0;
-    tmp[pos++] = cmd;
-    tmp[pos++] = seq;
-    tmp[pos++] = header[4];
-    tmp[pos++] = header[5];
-    if (len > 0U && data != NULL) {
-        memcpy(&tmp[pos], data, len);
-        pos += len;
-    }
-
-    uint32_t crc = Comm_CalcCRC32(tmp, pos);
-    uint8_t crc_out[4];
-    crc_out[0] = (uint8_t)(crc & 0xFFU);
-    crc_out[1] = (uint8_t)((crc >> 8) & 0xFFU);
-    crc_out[2] = (uint8_t)((crc >> 16) & 0xFFU);
-    crc_out[3] = (uint8_t)((crc >> 24) & 0xFFU);
-
-    HAL_UART_Transmit(&huart1, header, 6, HAL_MAX_DELAY);
-    if (len > 0U && data != NULL) {
-        HAL_UART_Transmit(&huart1, (uint8_t *)data, len, HAL_MAX_DELAY);
-    }
-    HAL_UART_Transmit(&huart1, crc_out, 4, HAL_MAX_DELAY);
-}
-
-void Comm_SendAck(uint8_t cmd, uint8_t seq, CommStatus_t status)
-{
-    uint8_t payload[3];
-    payload[0] = (uint8_t)status;
-    payload[1] = cmd;
-    payload[2] = seq;
-    Comm_SendFrame(CMD_ACK, 0, payload, sizeof(payload));
-}
-
-/**
- * @brief 处理完整接收的数据包
- * 
- * 在CRC校验通过后调用，根据命令字执行相应操作
- * @param cmd 命令字
- * @param seq 序列号
- * @param data 数据指针
- * @param len 数据长度
- */
-static void Comm_HandlePacket(uint8_t cmd, uint8_t seq,
-                              const uint8_t *data, uint16_t len)
-{
-    HAL_StatusTypeDef st;
-
-    switch (cmd)
-    {
-    case CMD_HANDSHAKE:
-    {
-        const char reply[] = "STM32F4-APP-BOOT";
-        Comm_SendFrame(CMD_HANDSHAKE, seq, (const uint8_t *)reply, sizeof(reply));
-    }
-        break;
-
-    case CMD_START_UPDATE:
-        if (len < 12U) {
-            Comm_SendAck(cmd, seq, COMM_STATUS_PARAM_ERR);
-        } else {
-            uint32_t total_size = *(uint32_t *)&data[0];
-            uint32_t crc        = *(uint32_t *)&data[4];
-            uint32_t version    = *(uint32_t *)&data[8];
-
-            if (total_size == 0) {
-                Comm_SendAck(cmd, seq, COMM_STATUS_PARAM_ERR);
-                break;
-            }
-
-            st = Update_Start(total_size, crc, version);
-            Comm_SendAck(cmd, seq, (st == HAL_OK) ? COMM_STATUS_OK : COMM_STATUS_FLASH_ERR);
-        }
-        break;
-
-    case CMD_DATA:
-        if (len < 4U) {
-            Comm_SendAck(cmd, seq, COMM_STATUS_PARAM_ERR);
-        } else if (Update_GetState() != UPDATE_RECEIVING) {
-            Comm_SendAck(cmd, seq, COMM_STATUS_STATE_ERR);
-        } else {
-            uint32_t offset = *(uint32_t *)&data[0];
-            const uint8_t *payload = &data[4];
-            uint16_t plen = (uint16_t)(len - 4U);
-
-            // 验证偏移量和长度的有效性
-            if (plen == 0) {
-                Comm_SendAck(cmd, seq, COMM_STATUS_PARAM_ERR);
-                break;
-            }
-
-            st = Update_ReceiveChunk(offset, payload, plen);
-            Comm_SendAck(cmd, seq, (st == HAL_OK) ? COMM_STATUS_OK : COMM_STATUS_FLASH_ERR);
-        }
-        break;
-
-    case CMD_END_UPDATE:
-        st = Update_RequestFinish();
-        Comm_SendAck(cmd, seq, (st == HAL_OK) ? COMM_STATUS_OK : COMM_STATUS_STATE_ERR);
-        /* 真正的 CRC+写Meta+复位由 Idle Hook 中的 Update_ProcessInIdle 完成 */
-        break;
-
-    case CMD_QUERY_VERSION:
-    {
-        BootMeta_t meta;
-        FlashCV_ReadMeta(&meta);
-        uint32_t now_ver = meta.version;
-        Comm_SendFrame(CMD_QUERY_VERSION, seq, (uint8_t *)&now_ver, sizeof(now_ver));
-    }
-        break;
-
-    default:
-        break;
-    }
+
+/* comm_proto.c */
+#include "../Inc/comm_proto.h"
+#include "update_manager.h"
+#include "FlashCV.h"
+#include "BootMailbox.h"
+#include "cmsis_os.h"
+#include <string.h>
+
+/* 使用 USART1 */
+extern UART_HandleTypeDef huart1;
+
+/**
+ * @brief 接收状态机状态枚举
+ */
+typedef enum {
+    RX_STATE_HEAD1 = 0,    /*!< 等待帧头第一个字节 */
+    RX_STATE_HEAD2,        /*!< 等待帧头第二个字节 */
+    RX_STATE_CMD,          /*!< 接收命令字 */
+    RX_STATE_SEQ,          /*!< 接收序列号 */
+    RX_STATE_LEN_L,        /*!< 接收长度低字节 */
+    RX_STATE_LEN_H,        /*!< 接收长度高字节 */
+    RX_STATE_DATA,         /*!< 接收数据 */
+    RX_STATE_CRC0,         /*!< 接收CRC第0字节 */
+    RX_STATE_CRC1,         /*!< 接收CRC第1字节 */
+    RX_STATE_CRC2,         /*!< 接收CRC第2字节 */
+    RX_STATE_CRC3          /*!< 接收CRC第3字节 */
+} RxState_t;
+
+/**
+ * @brief 接收帧队列槽位
+ * @note  中断直接在队头槽位里组帧，整帧收完后才发布给通信任务，数据不再二次拷贝
+ */
+typedef struct {
+    uint8_t  cmd;                           /*!< 命令字 */
+    uint8_t  seq;                           /*!< 序列号 */
+    uint16_t len;                           /*!< 数据长度 */
+    uint32_t status;                        /*!< 帧校验结果：COMM_STATUS_OK / COMM_STATUS_FRAME_CRC */
+    uint8_t  data[COMM_MAX_PAYLOAD_LEN];    /*!< 数据（4字节对齐） */
+} CommFrame_t;
+
+/**
+ * @brief 单生产者（USART中断）/单消费者（通信任务）无锁环形帧队列
+ * @note  队头只由中断推进，队尾只由任务推进；留一个空槽区分满和空，
+ *        因此队头槽位始终不会被任务读取，中断可以直接在里面组帧
+ */
+static CommFrame_t       rx_queue[COMM_RX_QUEUE_LEN];
+static volatile uint8_t  rx_q_head = 0;       /*!< 队头：中断正在组帧的槽位 */
+static volatile uint8_t  rx_q_tail = 0;       /*!< 队尾：任务下一个要处理的槽位 */
+static osSemaphoreId_t   rx_sem    = NULL;    /*!< 有新帧入队时通知通信任务 */
+static volatile CommStats_t comm_stats;       /*!< 收发统计 */
+static volatile uint8_t rx_consumer_busy = 0; /*!< 通信任务正在处理队列（可能在擦写Flash），此时中断不调用RTOS接口 */
+
+/**
+ * @brief 滑动窗口传输状态（仅通信任务访问）
+ */
+typedef struct {
+    uint8_t  window;        /*!< 协商的窗口大小（帧），0 表示停等模式 */
+    uint16_t chunk;         /*!< 协商的DATA帧数据长度 */
+    uint32_t total;         /*!< 本次升级传输的数据总长度（压缩传输时为压缩流长度） */
+    uint32_t ack_offset;    /*!< 累计确认偏移 */
+    uint32_t sack;          /*!< bit i：ack_offset + i*chunk 处的数据块已写入 */
+} CommWindow_t;
+
+static CommWindow_t comm_win;
+
+/**
+ * @brief 发送环形缓冲区
+ * @note  通信任务写入、DMA发送完成中断推进读指针，双方都在关中断的临界区内操作；
+ *        每次DMA发送读指针到写指针（或缓冲区末尾）之间的全部连续数据
+ */
+static uint8_t           tx_buf[COMM_TX_BUF_LEN];
+static volatile uint16_t tx_head    = 0;      /*!< 写入位置 */
+static volatile uint16_t tx_tail    = 0;      /*!< 未发送数据起点 */
+static volatile uint16_t tx_dma_len = 0;      /*!< DMA正在发送的字节数，0表示空闲 */
+static CommWinAck_t      tx_ack;              /*!< 等待发送、可继续合并的窗口应答 */
+static volatile uint8_t  tx_ack_pending = 0;  /*!< tx_ack 有效 */
+
+static uint8_t  comm_baud_pending = 0;        /*!< 已切到新波特率，等待探测帧确认 */
+static uint32_t comm_baud_tick    = 0;        /*!< 切换时刻（RTOS tick） */
+
+static RxState_t  rx_state = RX_STATE_HEAD1;  /*!< 接收状态机当前状态 */
+static uint8_t    rx_cmd;                     /*!< 接收到的命令字 */
+static uint8_t    rx_seq;                     /*!< 接收到的序列号 */
+static uint16_t   rx_len;                     /*!< 接收到的数据长度 */
+static uint8_t   *rx_buf;                     /*!< 数据接收缓冲区（指向队头槽位） */
+static uint16_t   rx_index;                   /*!< 数据接收索引 */
+static uint8_t    rx_hdr[4];                  /*!< CMD/SEQ/LEN，参与帧CRC计算 */
+static uint32_t   rx_crc;                     /*!< 帧CRC累积值（未取反），随数据到达增量计算 */
+static uint16_t   rx_crc_done;                /*!< 已计入 rx_crc 的数据字节数 */
+static uint8_t    crc_bytes[4];               /*!< CRC字节缓冲区 */
+static uint8_t    crc_index;                  /*!< CRC接收索引 */
+#if COMM_RX_USE_DMA
+static uint8_t    rx_dma_buf[COMM_RX_DMA_BUF_LEN]; /*!< DMA循环接收缓冲区 */
+static uint16_t   rx_dma_pos;                 /*!< 解析器在DMA缓冲区中已消费到的位置 */
+#else
+static uint8_t    s_rx_byte;                  /*!< UART接收字节缓冲 */
+#endif
+
+/**
+ * @brief 处理完整接收的数据包
+ * 
+ * 在CRC校验通过后调用，根据命令字执行相应操作
+ * @param cmd 命令字
+ * @param seq 序列号
+ * @param data 数据指针
+ * @param len 数据长度
+ */
+static void Comm_HandlePacket(uint8_t cmd, uint8_t seq,
+                              const uint8_t *data, uint16_t len);
+
+/**
+ * @brief 重置接收状态机
+ * 
+ * 将接收状态机恢复到初始状态
+ */
+static void Comm_ResetRxState(void)
+{
+    rx_state = RX_STATE_HEAD1;
+}
+
+/**
+ * @brief 数据段接收完毕
+ *
+ * 把尚未计入的数据字节并入帧CRC，转入接收CRC状态
+ */
+static void Comm_RxDataDone(void)
+{
+    rx_crc      = FlashCV_CrcUpdate(rx_crc, &rx_buf[rx_crc_done], (uint32_t)(rx_len - rx_crc_done));
+    rx_crc_done = rx_len;
+    crc_index   = 0;
+    rx_state    = RX_STATE_CRC0;
+}
+
+/**
+ * @brief 发布队头槽位中已组好的帧
+ *
+ * 在UART接收中断中调用；队列满时丢弃该帧并计数
+ * @param status 帧校验结果
+ */
+static void Comm_PublishFrame(CommStatus_t status)
+{
+    CommFrame_t *f = &rx_queue[rx_q_head];
+    uint8_t next = (uint8_t)((rx_q_head + 1U) % COMM_RX_QUEUE_LEN);
+
+    if (next == rx_q_tail) {
+        comm_stats.rx_dropped++;
+        return;
+    }
+
+    f->cmd    = rx_cmd;
+    f->seq    = rx_seq;
+    f->len    = rx_len;
+    f->status = (uint32_t)status;
+
+    __DMB();    /* 槽位内容先于队头指针对任务可见 */
+    rx_q_head = next;
+
+    uint8_t depth = (uint8_t)((next + COMM_RX_QUEUE_LEN - rx_q_tail) % COMM_RX_QUEUE_LEN);
+    if (depth > comm_stats.queue_peak) {
+        comm_stats.queue_peak = depth;
+    }
+
+    /* RTOS内核代码在Flash中，擦写期间调用会卡到擦写结束，DMA环形缓冲区在此期间被覆盖。
+     * 任务正在处理队列，或正在后台预擦除/写日志时不唤醒，任务回到 Comm_Process 后会自己检查队列 */
+    if (!rx_consumer_busy && !FlashCV_IsBusy()) {
+        osSemaphoreRelease(rx_sem);
+    }
+}
+
+/**
+ * @brief 启动UART接收
+ *
+ * DMA方式下从缓冲区起点重新开始循环接收，并复位消费位置
+ */
+static void Comm_StartRx(void)
+{
+#if COMM_RX_USE_DMA
+    rx_dma_pos = 0;
+    HAL_UARTEx_ReceiveToIdle_DMA(&huart1, rx_dma_buf, COMM_RX_DMA_BUF_LEN);
+#else
+    HAL_UART_Receive_IT(&huart1, &s_rx_byte, 1);
+#endif
+}
+
+/**
+ * @brief 计算帧CRC（覆盖 CMD、SEQ、LEN 和数据）
+ */
+static uint32_t Comm_FrameCRC(uint8_t cmd, uint8_t seq, const uint8_t *data, uint16_t len)
+{
+    uint8_t hdr[4];
+    hdr[0] = cmd;
+    hdr[1] = seq;
+    hdr[2] = (uint8_t)(len & 0xFFU);
+    hdr[3] = (uint8_t)(len >> 8);
+
+    uint32_t crc = FlashCV_CrcUpdate(FlashCV_CrcInit(), hdr, sizeof(hdr));
+    crc = FlashCV_CrcUpdate(crc, data, len);
+    return FlashCV_CrcFinal(crc);
+}
+
+/**
+ * @brief 发送缓冲区已占用字节数
+ */
+static uint16_t Comm_TxUsed(void)
+{
+    return (uint16_t)((tx_head + COMM_TX_BUF_LEN - tx_tail) % COMM_TX_BUF_LEN);
+}
+
+/**
+ * @brief 向发送缓冲区写入数据（处理回绕），调用前已确认空间足够
+ */
+static void Comm_TxWrite(const uint8_t *data, uint16_t len)
+{
+    uint16_t head  = tx_head;
+    uint16_t first = (uint16_t)(COMM_TX_BUF_LEN - head);
+
+    if (first > len) first = len;
+    memcpy(&tx_buf[head], data, first);
+    memcpy(tx_buf, &data[first], (uint16_t)(len - first));
+    tx_head = (uint16_t)((head + len) % COMM_TX_BUF_LEN);
+}
+
+/**
+ * @brief 把一整帧放入发送缓冲区（需在临界区内调用）
+ * @return uint8_t 1：成功；0：空间不足，已丢弃
+ */
+static uint8_t Comm_TxPut(uint8_t cmd, uint8_t seq, const uint8_t *data, uint16_t len, uint32_t crc)
+{
+    uint8_t header[6];
+    uint8_t crc_out[4];
+
+    if ((uint32_t)Comm_TxUsed() + 6U + len + 4U >= COMM_TX_BUF_LEN) {
+        comm_stats.tx_dropped++;
+        return 0U;
+    }
+
+    header[0] = COMM_HEAD1;
+    header[1] = COMM_HEAD2;
+    header[2] = cmd;
+    header[3] = seq;
+    header[4] = (uint8_t)(len & 0xFFU);
+    header[5] = (uint8_t)(len >> 8);
+    crc_out[0] = (uint8_t)(crc & 0xFFU);
+    crc_out[1] = (uint8_t)((crc >> 8) & 0xFFU);
+    crc_out[2] = (uint8_t)((crc >> 16) & 0xFFU);
+    crc_out[3] = (uint8_t)((crc >> 24) & 0xFFU);
+
+    Comm_TxWrite(header, sizeof(header));
+    if (len > 0U) {
+        Comm_TxWrite(data, len);
+    }
+    Comm_TxWrite(crc_out, sizeof(crc_out));
+
+    uint16_t used = Comm_TxUsed();
+    if (used > comm_stats.tx_queue_peak) {
+        comm_stats.tx_queue_peak = used;
+    }
+    return 1U;
+}
+
+/**
+ * @brief 把合并中的窗口应答写入发送缓冲区（需在临界区内调用）
+ */
+static void Comm_TxFlushAck(void)
+{
+    if (!tx_ack_pending) return;
+
+    tx_ack_pending = 0U;
+    Comm_TxPut(CMD_ACK, 0,
+               (const uint8_t *)&tx_ack, sizeof(tx_ack),
+               Comm_FrameCRC(CMD_ACK, 0, (const uint8_t *)&tx_ack, sizeof(tx_ack)));
+}
+
+/**
+ * @brief DMA空闲时启动下一段发送（需在临界区内调用）
+ */
+static void Comm_TxKick(void)
+{
+    if (tx_dma_len != 0U) return;
+
+    uint16_t head = tx_head;
+    uint16_t tail = tx_tail;
+    if (head == tail) return;
+
+    uint16_t n = (head > tail) ? (uint16_t)(head - tail) : (uint16_t)(COMM_TX_BUF_LEN - tail);
+    tx_dma_len = n;
+    if (HAL_UART_Transmit_DMA(&huart1, &tx_buf[tail], n) != HAL_OK) {
+        tx_dma_len = 0U;
+    }
+}
+
+/**
+ * @brief 一段DMA发送结束：释放该段空间，先放入合并好的应答再启动下一段
+ *
+ * 在USART1中断中调用
+ */
+static void Comm_TxDone(void)
+{
+    tx_tail    = (uint16_t)((tx_tail + tx_dma_len) % COMM_TX_BUF_LEN);
+    tx_dma_len = 0U;
+    Comm_TxFlushAck();
+    Comm_TxKick();
+}
+
+/**
+ * @brief 等待发送缓冲区全部发完
+ * @param timeout_ms 最长等待时间
+ */
+static void Comm_TxDrain(uint32_t timeout_ms)
+{
+    uint32_t start = osKernelGetTickCount();
+
+    while ((tx_dma_len != 0U || tx_head != tx_tail || tx_ack_pending) &&
+           (osKernelGetTickCount() - start) < (timeout_ms * osKernelGetTickFreq() / 1000U)) {
+        osDelay(1);
+    }
+}
+
+/**
+ * @brief UART发送完成回调函数
+ * @param huart UART句柄指针
+ */
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
+{
+    if (huart->Instance == USART1) {
+        Comm_TxDone();
+    }
+}
+
+/**
+ * @brief 检查USART1能否以足够精度产生指定波特率
+ *
+ * 16倍过采样下 BRR = PCLK2 / baud，要求 BRR >= 16 且实际波特率误差不超过 COMM_BAUD_MAX_ERR_PPM
+ * @param baud 目标波特率
+ * @return uint8_t 1：可用；0：不可用
+ */
+static uint8_t Comm_BaudSupported(uint32_t baud)
+{
+    uint32_t pclk = HAL_RCC_GetPCLK2Freq();
+
+    if (baud < COMM_DEFAULT_BAUD || baud > (pclk / 16U)) return 0U;
+
+    uint32_t brr    = (pclk + baud / 2U) / baud;
+    uint32_t actual = pclk / brr;
+    uint32_t diff   = (actual > baud) ? (actual - baud) : (baud - actual);
+
+    return ((uint64_t)diff * 1000000U <= (uint64_t)baud * COMM_BAUD_MAX_ERR_PPM) ? 1U : 0U;
+}
+
+/**
+ * @brief 切换USART1波特率
+ *
+ * 先等发送缓冲区（包括刚放入的应答）全部发完，再停止接收、重新配置USART1，
+ * 丢弃半帧并重新启动接收
+ * @param baud 新波特率
+ */
+static void Comm_SetBaudRate(uint32_t baud)
+{
+    Comm_TxDrain(100U);
+    HAL_UART_AbortReceive(&huart1);
+    huart1.Init.BaudRate = baud;
+    if (HAL_UART_Init(&huart1) != HAL_OK) {
+        huart1.Init.BaudRate = COMM_DEFAULT_BAUD;
+        HAL_UART_Init(&huart1);
+    }
+    Comm_ResetRxState();
+    Comm_StartRx();
+}
+
+void Comm_Init(void)
+{
+    memset((void *)&comm_stats, 0, sizeof(comm_stats));
+    /* 打开 DWT 周期计数器（Bootloader 已打开时不受影响），统计接收解析耗时 */
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    memset(&comm_win, 0, sizeof(comm_win));
+    comm_baud_pending = 0U;
+    tx_head = 0;
+    tx_tail = 0;
+    tx_dma_len = 0;
+    tx_ack_pending = 0;
+    rx_q_head = 0;
+    rx_q_tail = 0;
+    if (rx_sem == NULL) {
+        rx_sem = osSemaphoreNew(1U, 0U, NULL);
+    }
+
+    rx_state = RX_STATE_HEAD1;
+    Comm_StartRx();
+}
+
+void Comm_Process(uint32_t timeout)
+{
+    if (rx_q_tail == rx_q_head) {
+        osSemaphoreAcquire(rx_sem, timeout);
+    }
+
+    rx_consumer_busy = 1U;
+    while (rx_q_tail != rx_q_head) {
+        const CommFrame_t *f = &rx_queue[rx_q_tail];
+
+        if (f->status == (uint32_t)COMM_STATUS_OK) {
+            Comm_HandlePacket(f->cmd, f->seq, f->data, f->len);
+        } else {
+            Comm_SendAck(f->cmd, f->seq, (CommStatus_t)f->status);
+        }
+
+        __DMB();    /* 槽位处理完毕后才归还给中断 */
+        rx_q_tail = (uint8_t)((rx_q_tail + 1U) % COMM_RX_QUEUE_LEN);
+    }
+    rx_consumer_busy = 0U;
+
+    /* 新波特率下迟迟收不到探测帧，说明链路不通，退回默认波特率 */
+    if (comm_baud_pending &&
+        (osKernelGetTickCount() - comm_baud_tick) >= (COMM_BAUD_PROBE_MS * osKernelGetTickFreq() / 1000U)) {
+        comm_baud_pending = 0U;
+        Comm_SetBaudRate(COMM_DEFAULT_BAUD);
+    }
+}
+
+void Comm_GetStats(CommStats_t *stats)
+{
+    if (stats == NULL) return;
+
+    uint8_t head = rx_q_head;
+    uint8_t tail = rx_q_tail;
+
+    stats->rx_frames     = comm_stats.rx_frames;
+    stats->rx_crc_errors = comm_stats.rx_crc_errors;
+    stats->rx_dropped    = comm_stats.rx_dropped;
+    stats->rx_uart_errors = comm_stats.rx_uart_errors;
+    stats->queue_depth   = (uint8_t)((head + COMM_RX_QUEUE_LEN - tail) % COMM_RX_QUEUE_LEN);
+    stats->queue_peak    = comm_stats.queue_peak;
+    stats->queue_size    = COMM_RX_QUEUE_LEN - 1U;
+    stats->reserved      = 0U;
+    stats->tx_dropped     = comm_stats.tx_dropped;
+    stats->tx_acks_merged = comm_stats.tx_acks_merged;
+    stats->tx_queue_used  = Comm_TxUsed();
+    stats->tx_queue_peak  = comm_stats.tx_queue_peak;
+    stats->tx_queue_size  = COMM_TX_BUF_LEN - 1U;
+    stats->tx_reserved    = 0U;
+    stats->rx_overruns    = comm_stats.rx_overruns;
+    stats->rx_isr_cycles     = comm_stats.rx_isr_cycles;
+    stats->rx_isr_cycles_max = comm_stats.rx_isr_cycles_max;
+    stats->task_stack_free   = osThreadGetStackSpace(osThreadGetId());
+}
+
+#if COMM_RX_USE_DMA
+/**
+ * @brief UART接收事件回调函数（DMA半满/全满/空闲线）
+ *
+ * 在DMA中断或USART空闲中断中调用；Size 为DMA在循环缓冲区中的当前写位置，
+ * 把上次消费位置到该位置之间的新数据（可能跨越缓冲区末尾）交给解析器
+ * @param huart UART句柄指针
+ * @param Size 当前写位置
+ */
+void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef *huart, uint16_t Size)
+{
+    if (huart->Instance != USART1) return;
+
+    if (Size > COMM_RX_DMA_BUF_LEN) {
+        Size = COMM_RX_DMA_BUF_LEN;
+    }
+
+    if (Size != rx_dma_pos) {
+        if (Size > rx_dma_pos) {
+            Comm_OnBytesReceived(&rx_dma_buf[rx_dma_pos], (uint16_t)(Size - rx_dma_pos));
+        } else {
+            Comm_OnBytesReceived(&rx_dma_buf[rx_dma_pos], (uint16_t)(COMM_RX_DMA_BUF_LEN - rx_dma_pos));
+            Comm_OnBytesReceived(rx_dma_buf, Size);
+        }
+        rx_dma_pos = (Size == COMM_RX_DMA_BUF_LEN) ? 0U : Size;
+    }
+}
+#else
+/**
+ * @brief UART接收完成回调函数
+ * 
+ * 在HAL库UART接收中断中调用
+ * @param huart UART句柄指针
+ */
+void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
+{
+    if (huart->Instance == USART1) {
+        Comm_OnByteReceived(s_rx_byte);
+        HAL_UART_Receive_IT(&huart1, &s_rx_byte, 1);
+    }
+}
+#endif
+
+/**
+ * @brief UART错误回调函数
+ *
+ * 溢出/帧错误/噪声会使HAL中止接收，这里计数后丢弃半帧并重新启动接收
+ * @param huart UART句柄指针
+ */
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart)
+{
+    if (huart->Instance != USART1) return;
+
+    /* 发送DMA出错：HAL已结束发送，丢弃在途这一段 */
+    if (tx_dma_len != 0U && huart->gState == HAL_UART_STATE_READY) {
+        Comm_TxDone();
+    }
+
+    /* 接收被HAL中止（溢出/帧错误/噪声/接收DMA错误） */
+    if (huart->RxState == HAL_UART_STATE_READY) {
+        if (huart->ErrorCode & HAL_UART_ERROR_ORE) {
+            comm_stats.rx_overruns++;
+        }
+        comm_stats.rx_uart_errors++;
+        Comm_ResetRxState();
+        Comm_StartRx();
+    }
+}
+
+void Comm_OnBytesReceived(const uint8_t *data, uint16_t len)
+{
+    uint32_t t0 = DWT->CYCCNT;
+    uint32_t cycles;
+
+    while (len > 0U) {
+        if (rx_state == RX_STATE_DATA) {
+            /* 数据段整段拷贝，不逐字节走状态机 */
+            uint16_t n = (uint16_t)(rx_len - rx_index);
+            if (n > len) n = len;
+            memcpy(&rx_buf[rx_index], data, n);
+            rx_crc      = FlashCV_CrcUpdate(rx_crc, &rx_buf[rx_index], n);
+            rx_index   += n;
+            rx_crc_done = rx_index;
+            data       += n;
+            len        -= n;
+            if (rx_index >= rx_len) {
+                Comm_RxDataDone();
+            }
+        } else {
+            Comm_OnByteReceived(*data++);
+            len--;
+        }
+    }
+
+    cycles = DWT->CYCCNT - t0;
+    comm_stats.rx_isr_cycles += cycles;
+    if (cycles > comm_stats.rx_isr_cycles_max) {
+        comm_stats.rx_isr_cycles_max = cycles;
+    }
+}
+
+void Comm_OnByteReceived(uint8_t ch)
+{
+    switch (rx_state) {
+    case RX_STATE_HEAD1:
+        if (ch == COMM_HEAD1) rx_state = RX_STATE_HEAD2;
+        break;
+
+    case RX_STATE_HEAD2:
+        if (ch == COMM_HEAD2) rx_state = RX_STATE_CMD;
+        else rx_state = RX_STATE_HEAD1;
+        break;
+
+    case RX_STATE_CMD:
+        rx_cmd = ch;
+        rx_hdr[0] = ch;
+        rx_state = RX_STATE_SEQ;
+        break;
+
+    case RX_STATE_SEQ:
+        rx_seq = ch;
+        rx_hdr[1] = ch;
+        rx_state = RX_STATE_LEN_L;
+        break;
+
+    case RX_STATE_LEN_L:
+        rx_len = ch;
+        rx_hdr[2] = ch;
+        rx_state = RX_STATE_LEN_H;
+        break;
+
+    case RX_STATE_LEN_H:
+        rx_len |= ((uint16_t)ch << 8);
+        rx_hdr[3] = ch;
+        if (rx_len > COMM_MAX_PAYLOAD_LEN) {
+            Comm_ResetRxState();
+        } else {
+            /* 帧CRC覆盖 CMD 到 DATA：先并入头部4字节，数据随到随算 */
+            rx_crc      = FlashCV_CrcUpdate(FlashCV_CrcInit(), rx_hdr, sizeof(rx_hdr));
+            rx_crc_done = 0;
+            rx_index    = 0;
+            crc_index   = 0;
+            rx_buf      = rx_queue[rx_q_head].data;
+            rx_state    = (rx_len == 0U) ? RX_STATE_CRC0 : RX_STATE_DATA;
+        }
+        break;
+
+    case RX_STATE_DATA:
+        /* 逐字节路径不逐字节算CRC，数据段收齐后一次并入 */
+        rx_buf[rx_index++] = ch;
+        if (rx_index >= rx_len) {
+            Comm_RxDataDone();
+        }
+        break;
+
+    case RX_STATE_CRC0:
+    case RX_STATE_CRC1:
+    case RX_STATE_CRC2:
+    case RX_STATE_CRC3:
+        crc_bytes[crc_index++] = ch;
+        if (crc_index >= 4U) {
+            uint32_t crc_recv =  (uint32_t)crc_bytes[0]
+                               | ((uint32_t)crc_bytes[1] << 8)
+                               | ((uint32_t)crc_bytes[2] << 16)
+                               | ((uint32_t)crc_bytes[3] << 24);
+            uint32_t crc_calc = FlashCV_CrcFinal(rx_crc);
+
+            /* 处理（含Flash擦写和应答发送）交给通信任务，中断里只入队 */
+            if (crc_calc == crc_recv) {
+                comm_stats.rx_frames++;
+                Comm_PublishFrame(COMM_STATUS_OK);
+            } else {
+                comm_stats.rx_crc_errors++;
+                Comm_PublishFrame(COMM_STATUS_FRAME_CRC);
+            }
+
+            Comm_ResetRxState();
+        }
+        break;
+
+    default:
+        Comm_ResetRxState();
+        break;
+    }
+}
+
+void Comm_SendFrame(uint8_t cmd, uint8_t seq, const uint8_t *data, uint16_t len)
+{
+    if (data == NULL) {
+        len = 0U;
+    }
+
+    /* CRC 在临界区外直接对调用者的数据计算 */
+    uint32_t crc = Comm_FrameCRC(cmd, seq, data, len);
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    Comm_TxFlushAck();      /* 合并中的应答先于本帧发出，保持先后顺序 */
+    Comm_TxPut(cmd, seq, data, len, crc);
+    Comm_TxKick();
+    __set_PRIMASK(primask);
+}
+
+void Comm_SendAck(uint8_t cmd, uint8_t seq, CommStatus_t status)
+{
+    uint8_t payload[3];
+    payload[0] = (uint8_t)status;
+    payload[1] = cmd;
+    payload[2] = seq;
+    Comm_SendFrame(CMD_ACK, 0, payload, sizeof(payload));
+}
+
+/**
+ * @brief 发送窗口模式的扩展应答（累计确认偏移 + 选择性应答位图）
+ * @param seq 原始序列号
+ * @param status 应答状态码
+ */
+static void Comm_SendWindowAck(uint8_t seq, CommStatus_t status)
+{
+    if (status != COMM_STATUS_OK) {
+        /* 错误应答不参与合并 */
+        CommWinAck_t ack;
+        ack.status     = (uint8_t)status;
+        ack.cmd        = CMD_DATA;
+        ack.seq        = seq;
+        ack.count      = 1U;
+        ack.ack_offset = comm_win.ack_offset;
+        ack.sack       = comm_win.sack;
+        Comm_SendFrame(CMD_ACK, 0, (const uint8_t *)&ack, sizeof(ack));
+        return;
+    }
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    /* 发送忙时后到的应答直接覆盖：累计偏移和位图本身就包含了之前的确认 */
+    if (tx_ack_pending && tx_ack.count < 0xFFU) {
+        tx_ack.count++;
+        comm_stats.tx_acks_merged++;
+    } else {
+        Comm_TxFlushAck();
+        tx_ack.count   = 1U;
+        tx_ack_pending = 1U;
+    }
+    tx_ack.status     = (uint8_t)COMM_STATUS_OK;
+    tx_ack.cmd        = CMD_DATA;
+    tx_ack.seq        = seq;
+    tx_ack.ack_offset = comm_win.ack_offset;
+    tx_ack.sack       = comm_win.sack;
+
+    /* 发送空闲就立即发出，忙则留到本段发送完成中断里再放入缓冲区 */
+    if (tx_dma_len == 0U) {
+        Comm_TxFlushAck();
+        Comm_TxKick();
+    }
+    __set_PRIMASK(primask);
+}
+
+/**
+ * @brief 处理握手帧中的能力协商
+ *
+ * 数据末尾带能力块时按设备上限裁剪后启用窗口模式，否则回到停等模式
+ * @param data 握手帧数据
+ * @param len 数据长度
+ * @param caps 输出：同意的能力
+ */
+static void Comm_NegotiateCaps(const uint8_t *data, uint16_t len, CommCaps_t *caps)
+{
+    CommCaps_t req;
+
+    memset(caps, 0, sizeof(*caps));
+    caps->magic = COMM_CAPS_MAGIC;
+    comm_win.window = 0U;
+
+    if (len < sizeof(req)) return;
+    memcpy(&req, &data[len - sizeof(req)], sizeof(req));
+    if (req.magic != COMM_CAPS_MAGIC) return;
+
+    caps->flags |= (req.flags & (COMM_CAP_BAUD | COMM_CAP_LZ4 | COMM_CAP_DELTA | COMM_CAP_BLOCKS | COMM_CAP_RELOC));
+
+    if ((req.flags & COMM_CAP_WINDOW) && req.window > 1U && req.chunk > 0U) {
+        /* 块大小取接收块（UPDATE_BLOCK_SIZE）的整数倍：乱序到达的块各自写满整块，
+         * 不会在升级管理器里留下大量半满块；最后一块的不对齐尾字节由写合并槽拼字 */
+        uint16_t chunk = req.chunk;
+        if (chunk > (COMM_MAX_PAYLOAD_LEN - 4U)) chunk = COMM_MAX_PAYLOAD_LEN - 4U;
+        chunk = (uint16_t)((chunk / UPDATE_BLOCK_SIZE) * UPDATE_BLOCK_SIZE);
+        if (chunk == 0U) chunk = UPDATE_BLOCK_SIZE;
+
+        caps->window  = (req.window > COMM_WIN_MAX) ? (uint8_t)COMM_WIN_MAX : req.window;
+        caps->chunk   = chunk;
+        caps->flags  |= COMM_CAP_WINDOW;
+
+        comm_win.window = caps->window;
+        comm_win.chunk  = chunk;
+    }
+}
+
+/**
+ * @brief 窗口模式下处理DATA帧
+ *
+ * 按偏移定位数据块：已确认或已写入的重传直接应答，不重复写Flash；
+ * 新块写入后置位位图，并把累计确认偏移推进到第一个缺口；
+ * 压缩流中超前到达、暂时不能消费的块不回应答
+ * @param seq 序列号
+ * @param offset 数据偏移
+ * @param payload 数据
+ * @param plen 数据长度
+ */
+static void Comm_HandleWindowData(uint8_t seq, uint32_t offset,
+                                  const uint8_t *payload, uint16_t plen)
+{
+    CommStatus_t status = COMM_STATUS_OK;
+    uint32_t chunk = comm_win.chunk;
+
+    if ((offset % chunk) != 0U ||
+        (plen != chunk && (offset + plen) != comm_win.total)) {
+        status = COMM_STATUS_PARAM_ERR;
+    } else if (offset >= comm_win.ack_offset) {
+        uint32_t idx = (offset - comm_win.ack_offset) / chunk;
+
+        if (idx >= 32U) {
+            status = COMM_STATUS_PARAM_ERR;       /* 超出窗口 */
+        } else if ((comm_win.sack & (1UL << idx)) == 0U) {
+            HAL_StatusTypeDef st = Update_ReceiveChunk(offset, payload, plen);
+
+            if (st == HAL_BUSY) {
+                /* 压缩流前面还有缺口：这一帧不应答（累计偏移和位图都没变，应答也没有新信息），
+                   上位机超时后按顺序重传 */
+                return;
+            } else if (st != HAL_OK) {
+                status = COMM_STATUS_FLASH_ERR;
+            } else {
+                comm_win.sack |= (1UL << idx);
+                while (comm_win.sack & 1UL) {
+                    comm_win.sack >>= 1;
+                    comm_win.ack_offset += chunk;
+                }
+                if (comm_win.ack_offset > comm_win.total) {
+                    comm_win.ack_offset = comm_win.total;
+                }
+            }
+        }
+    }
+
+    Comm_SendWindowAck(seq, status);
+}
+
+/**
+ * @brief 处理完整接收的数据包
+ * 
+ * 在CRC校验通过后调用，根据命令字执行相应操作
+ * @param cmd 命令字
+ * @param seq 序列号
+ * @param data 数据指针
+ * @param len 数据长度
+ */
+static void Comm_HandlePacket(uint8_t cmd, uint8_t seq,
+                              const uint8_t *data, uint16_t len)
+{
+    HAL_StatusTypeDef st;
+
+    switch (cmd)
+    {
+    case CMD_HANDSHAKE:
+    {
+        static const char text[] = "STM32F4-APP-BOOT";
+        uint8_t reply[sizeof(text) + sizeof(CommCaps_t)];
+        CommCaps_t caps;
+
+        Comm_NegotiateCaps(data, len, &caps);
+        memcpy(reply, text, sizeof(text));
+        memcpy(&reply[sizeof(text)], &caps, sizeof(caps));
+        Comm_SendFrame(CMD_HANDSHAKE, seq, reply, sizeof(reply));
+    }
+        break;
+
+    case CMD_START_UPDATE:
+        if (len < 12U) {
+            Comm_SendAck(cmd, seq, COMM_STATUS_PARAM_ERR);
+        } else {
+            uint32_t total_size = *(uint32_t *)&data[0];
+            uint32_t crc        = *(uint32_t *)&data[4];
+            uint32_t version    = *(uint32_t *)&data[8];
+            /* 可选的编码字段：encoding(4B) + 压缩流长度(4B)，旧上位机不带时按原样传输 */
+            uint32_t encoding   = (len >= 20U) ? *(uint32_t *)&data[12] : UPDATE_ENC_RAW;
+            uint32_t stream     = (len >= 20U) ? *(uint32_t *)&data[16] : total_size;
+
+            if (total_size == 0) {
+                Comm_SendAck(cmd, seq, COMM_STATUS_PARAM_ERR);
+                break;
+            }
+
+            st = Update_Start(total_size, crc, version, encoding, stream);
+            comm_win.total      = Update_GetTransferSize();
+            comm_win.ack_offset = 0U;
+            comm_win.sack       = 0U;
+            /* 续传：窗口从续传起点所在的块开始，上位机用 CMD_QUERY_MISSING 得到同样的起点 */
+            if (st == HAL_OK && comm_win.window != 0U) {
+                comm_win.ack_offset = (Update_GetResumeOffset() / comm_win.chunk) * comm_win.chunk;
+            }
+            Comm_SendAck(cmd, seq, (st == HAL_OK) ? COMM_STATUS_OK : COMM_STATUS_FLASH_ERR);
+        }
+        break;
+
+    case CMD_DATA:
+        if (len < 4U) {
+            Comm_SendAck(cmd, seq, COMM_STATUS_PARAM_ERR);
+        } else if (Update_GetState() != UPDATE_RECEIVING) {
+            Comm_SendAck(cmd, seq, COMM_STATUS_STATE_ERR);
+        } else {
+            uint32_t offset = *(uint32_t *)&data[0];
+            const uint8_t *payload = &data[4];
+            uint16_t plen = (uint16_t)(len - 4U);
+
+            // 验证偏移量和长度的有效性
+            if (plen == 0) {
+                Comm_SendAck(cmd, seq, COMM_STATUS_PARAM_ERR);
+                break;
+            }
+
+            if (comm_win.window != 0U) {
+                Comm_HandleWindowData(seq, offset, payload, plen);
+                break;
+            }
+
+            st = Update_ReceiveChunk(offset, payload, plen);
+            Comm_SendAck(cmd, seq, (st == HAL_OK)   ? COMM_STATUS_OK :
+                                   (st == HAL_BUSY) ? COMM_STATUS_STATE_ERR : COMM_STATUS_FLASH_ERR);
+        }
+        break;
+
+    case CMD_END_UPDATE:
+        /* 窗口模式下还有缺口时不能结束 */
+        if (comm_win.window != 0U && comm_win.ack_offset != comm_win.total) {
+            Comm_SendAck(cmd, seq, COMM_STATUS_STATE_ERR);
+            break;
+        }
+        st = Update_RequestFinish();
+        Comm_SendAck(cmd, seq, (st == HAL_OK) ? COMM_STATUS_OK : COMM_STATUS_STATE_ERR);
+        /* 真正的 CRC+写Meta+复位由 Idle Hook 中的 Update_ProcessInIdle 完成 */
+        break;
+
+    case CMD_QUERY_VERSION:
+    {
+        BootMeta_t meta;
+        FlashCV_ReadMeta(&meta);
+        uint32_t now_ver = meta.version;
+        Comm_SendFrame(CMD_QUERY_VERSION, seq, (uint8_t *)&now_ver, sizeof(now_ver));
+    }
+        break;
+
+    case CMD_SET_BAUD:
+        if (len < 4U) {
+            Comm_SendAck(cmd, seq, COMM_STATUS_PARAM_ERR);
+        } else {
+            uint32_t baud = *(uint32_t *)&data[0];
+
+            if (!Comm_BaudSupported(baud)) {
+                Comm_SendAck(cmd, seq, COMM_STATUS_PARAM_ERR);
+                break;
+            }
+
+            /* 先用旧波特率应答，发完再切换；之后等待上位机在新波特率下发来探测帧 */
+            Comm_SendAck(cmd, seq, COMM_STATUS_OK);
+            Comm_SetBaudRate(baud);
+            comm_baud_pending = 1U;
+            comm_baud_tick    = osKernelGetTickCount();
+        }
+        break;
+
+    case CMD_BAUD_PROBE:
+        /* 新波特率下收发都正常，确认切换 */
+        comm_baud_pending = 0U;
+        Comm_SendFrame(CMD_BAUD_PROBE, seq, data, len);
+        break;
+
+    case CMD_QUERY_STATS:
+    {
+        CommStats_t stats;
+        Comm_GetStats(&stats);
+        Comm_SendFrame(CMD_QUERY_STATS, seq, (const uint8_t *)&stats, sizeof(stats));
+    }
+        break;
+
+    case CMD_QUERY_MISSING:
+        if (Update_GetState() != UPDATE_RECEIVING) {
+            Comm_SendAck(cmd, seq, COMM_STATUS_STATE_ERR);
+        } else {
+            static uint32_t reply[1U + 2U * COMM_MISSING_MAX_RANGES];
+            uint32_t from = (len >= 4U) ? *(uint32_t *)&data[0] : 0U;
+            uint32_t n = Update_GetMissing(from, (UpdateRange_t *)&reply[1],
+                                           COMM_MISSING_MAX_RANGES, &reply[0]);
+            Comm_SendFrame(CMD_QUERY_MISSING, seq, (const uint8_t *)reply,
+                           (uint16_t)(sizeof(uint32_t) + n * sizeof(UpdateRange_t)));
+        }
+        break;
+
+    case CMD_QUERY_BLOCK_CRCS:
+    {
+        static uint32_t reply[3U + COMM_BLOCK_CRC_MAX];
+        uint32_t first = (len >= 4U) ? *(uint32_t *)&data[0] : 0U;
+        uint32_t n = Update_GetBlockCrcs(first, &reply[3], COMM_BLOCK_CRC_MAX, &reply[1]);
+        reply[0] = UPDATE_DEDUP_BLOCK_SIZE;
+        reply[2] = first;
+        Comm_SendFrame(CMD_QUERY_BLOCK_CRCS, seq, (const uint8_t *)reply,
+                       (uint16_t)((3U + n) * sizeof(uint32_t)));
+    }
+        break;
+
+    case CMD_COPY_BLOCKS:
+    {
+        /* 偏移(4B) + 长度(4B) [+ 重定位位图：每个字一位，共 (长度+31)/32 字节] */
+        uint32_t offset = (len >= 8U) ? *(uint32_t *)&data[0] : 0U;
+        uint32_t count  = (len >= 8U) ? *(uint32_t *)&data[4] : 0U;
+        const uint8_t *reloc = (len > 8U) ? &data[8] : NULL;
+
+        if (len < 8U || (reloc != NULL && (len - 8U) < ((count + 31U) / 32U))) {
+            Comm_SendAck(cmd, seq, COMM_STATUS_PARAM_ERR);
+        } else if (Update_GetState() != UPDATE_RECEIVING) {
+            Comm_SendAck(cmd, seq, COMM_STATUS_STATE_ERR);
+        } else {
+            st = Update_CopyFromRunning(offset, count, reloc);
+            Comm_SendAck(cmd, seq, (st == HAL_OK) ? COMM_STATUS_OK : COMM_STATUS_FLASH_ERR);
+        }
+    }
+        break;
+
+    case CMD_QUERY_BOOT:
+    {
+        BootMailbox_t mb;
+        BootMailbox_Read(&mb);      /* 邮箱无效时全为0 */
+        Comm_SendFrame(CMD_QUERY_BOOT, seq, (const uint8_t *)&mb, sizeof(mb));
+    }
+        break;
+
+    case CMD_QUERY_SLOT:
+    {
+        CommSlotInfo_t info;
+        SlotHeader_t hdr;
+        memset(&info, 0, sizeof(info));
+        info.running     = (uint8_t)Update_GetRunningSlot();
+        info.target      = (uint8_t)Update_GetTargetSlot();
+        info.confirmed   = Update_IsConfirmed();
+        info.rollback    = Update_CanRollback();
+        info.target_addr = FlashCV_SlotAddr(info.target);
+        info.target_size = FlashCV_SlotSize(info.target);
+        FlashCV_ReadSlot(info.running, &hdr);
+        if (FlashCV_SlotValid(info.running, &hdr)) {
+            info.running_size    = hdr.image_size;
+            info.running_crc     = hdr.image_crc;
+            info.running_version = hdr.version;
+        }
+        Comm_SendFrame(CMD_QUERY_SLOT, seq, (const uint8_t *)&info, sizeof(info));
+    }
+        break;
+
+    case CMD_ROLLBACK:
+        /* 回滚只写一条元数据记录；应答发完再复位，Bootloader 从另一个槽启动 */
+        st = Update_Rollback();
+        Comm_SendAck(cmd, seq, (st == HAL_OK) ? COMM_STATUS_OK : COMM_STATUS_STATE_ERR);
+        if (st == HAL_OK) {
+            Comm_TxDrain(100U);
+            NVIC_SystemReset();
+        }
+        break;
+
+    default:
+        break;
+    }
 }
\ No newline at end of file
@@ -1,200 +1,1112 @@
-
-/* update_manager.c */
-#include "update_manager.h"
-#include <string.h>
-
-/**
- * @brief 升级上下文全局实例
- */
-static UpdateContext_t g_ctx;
-
-/**
- * @brief 升级处理状态机枚举
- */
-typedef enum {
-    UPROC_IDLE = 0,        /*!< 空闲状态 */
-    UPROC_VERIFYING,       /*!< 正在校验CRC */
-    UPROC_WRITE_META,      /*!< 正在写入元数据 */
-    UPROC_DONE             /*!< 处理完成 */
-} UpdateProcState_t;
-
-static volatile uint8_t        g_finish_request = 0;  /*!< 完成请求标志 */
-static volatile UpdateProcState_t g_proc_state  = UPROC_IDLE;  /*!< 处理状态 */
-static uint32_t                g_crc_calc       = 0;  /*!< 计算得到的CRC值 */
-
-/**
- * @brief 内部函数：擦除下载区 (Sector5/6)
- * @return HAL_StatusTypeDef 操作状态
- */
-static HAL_StatusTypeDef Update_EraseDownloadArea(void)
-{
-    FLASH_EraseInitTypeDef erase;
-    uint32_t sector_error = 0;
-
-    erase.TypeErase    = FLASH_TYPEERASE_SECTORS;
-    erase.VoltageRange = FLASH_VOLTAGE_RANGE_3;
-    erase.Sector       = FLASH_SECTOR_5;     // 从 Sector5 开始
-    erase.NbSectors    = 2;                  // Sector5、6
-
-    HAL_FLASH_Unlock();
-    HAL_StatusTypeDef status = HAL_FLASHEx_Erase(&erase, &sector_error);
-    HAL_FLASH_Lock();
-
-    if (status != HAL_OK) return status;
-    if (sector_error != 0xFFFFFFFFU) return HAL_ERROR;
-    return HAL_OK;
-}
-
-void Update_Init(void)
-{
-    memset(&g_ctx, 0, sizeof(g_ctx));
-    g_ctx.state = UPDATE_IDLE;
-    g_finish_request = 0;
-    g_proc_state     = UPROC_IDLE;
-}
-
-UpdateState_t Update_GetState(void)
-{
-    return g_ctx.state;
-}
-
-HAL_StatusTypeDef Update_Start(uint32_t total_size, uint32_t crc, uint32_t version)
-{
-    // 参数检查
-    if (total_size == 0U) {
-        return HAL_ERROR;
-    }
-
-    /* 不能越界下载区 */
-    if ((FLASH_DOWNLOAD_START_ADDR + total_size) > (FLASH_DOWNLOAD_END_ADDR + 1U)) {
-        return HAL_ERROR;
-    }
-
-    g_ctx.total_size    = total_size;
-    g_ctx.image_crc     = crc;
-    g_ctx.version       = version;
-    g_ctx.received_size = 0U;
-    g_ctx.state         = UPDATE_RECEIVING;
-
-    /* 擦除下载区 */
-    HAL_StatusTypeDef st = Update_EraseDownloadArea();
-    if (st != HAL_OK) {
-        g_ctx.state = UPDATE_IDLE;
-        return st;
-    }
-
-    return HAL_OK;
-}
-
-HAL_StatusTypeDef Update_ReceiveChunk(uint32_t offset, const uint8_t *data, uint16_t len)
-{
-    if (g_ctx.state != UPDATE_RECEIVING) return HAL_ERROR;
-    if (data == NULL || len == 0U)       return HAL_ERROR;
-
-    // 越界检查
-    if ((offset + len) > g_ctx.total_size) return HAL_ERROR;
-
-    uint32_t addr = FLASH_DOWNLOAD_START_ADDR + offset;
-    uint32_t i    = 0U;
-
-    HAL_StatusTypeDef status;
-
-    HAL_FLASH_Unlock();
-
-    while (i < len) {
-        uint8_t buf[4] = {0xFF,0xFF,0xFF,0xFF};
-        uint32_t remain = len - i;
-        uint32_t copy   = (remain >= 4U) ? 4U : remain;
-
-        memcpy(buf, &data[i], copy);
-        uint32_t word = *(uint32_t *)buf;
-
-        status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, addr, word);
-        if (status != HAL_OK) {
-            HAL_FLASH_Lock();
-            return status;
-        }
-
-        addr += 4U;
-        i    += copy;
-    }
-
-    HAL_FLASH_Lock();
-
-    uint32_t new_end = offset + len;
-    if (g_ctx.received_size < new_end) {
-        g_ctx.received_size = new_end;
-    }
-
-    return HAL_OK;
-}
-
-HAL_StatusTypeDef Update_RequestFinish(void)
-{
-    if (g_ctx.state != UPDATE_RECEIVING) {
-        return HAL_ERROR;
-    }
-    if (g_ctx.received_size != g_ctx.total_size) {
-        return HAL_ERROR;
-    }
-
-    g_finish_request = 1U;
-    g_proc_state     = UPROC_VERIFYING;
-    g_ctx.state      = UPDATE_FINISH_REQUESTED;
-    return HAL_OK;
-}
-
-void Update_ProcessInIdle(void)
-{
-    if (!g_finish_request) return;
-
-    switch (g_proc_state)
-    {
-    case UPROC_VERIFYING:
-        /* 整体 CRC 校验：对下载区做一次 CRC32 */
-        g_crc_calc = FlashCV_CalcCRC(FLASH_DOWNLOAD_START_ADDR, g_ctx.total_size);
-        if (g_crc_calc == g_ctx.image_crc) {
-            g_proc_state = UPROC_WRITE_META;
-        } else {
-            /* CRC 错误，升级失败 */
-            g_finish_request = 0U;
-            g_proc_state     = UPROC_IDLE;
-            g_ctx.state      = UPDATE_IDLE;
-            /* 这里你可以增加一个错误标志，后续任务里通知上位机 */
-        }
-        break;
-
-    case UPROC_WRITE_META:
-    {
-        BootMeta_t meta;
-        memset(&meta, 0, sizeof(meta));
-        meta.flag       = UPGRADE_FLAG_VALID;
-        meta.image_size = g_ctx.total_size;
-        meta.image_crc  = g_ctx.image_crc;
-        meta.version    = g_ctx.version;
-
-        if (FlashCV_WriteMeta(&meta) == HAL_OK) {
-            g_proc_state = UPROC_DONE;
-        } else {
-            g_finish_request = 0U;
-            g_proc_state     = UPROC_IDLE;
-            g_ctx.state      = UPDATE_IDLE;
-        }
-    }
-        break;
-
-    case UPROC_DONE:
-        g_ctx.state      = UPDATE_FINISHED;
-        g_finish_request = 0U;
-        /* 写完 Meta，交给 Bootloader 去搬运，直接软复位 */
-        NVIC_SystemReset();
-        while (1) { }
-        break;
-
-    default:
-        g_finish_request = 0U;
-        g_proc_state     = UPROC_IDLE;
-        g_ctx.state      = UPDATE_IDLE;
-        break;
-    }
+
+/* update_manager.c */
+#include "update_manager.h"
+#include "BootMailbox.h"
+#include "Lz4Stream.h"
+#include "DeltaPatch.h"
+#include <string.h>
+
+/**
+ * @brief 升级上下文全局实例
+ */
+static UpdateContext_t g_ctx;
+
+/**
+ * @brief 升级处理状态机枚举
+ */
+typedef enum {
+    UPROC_IDLE = 0,        /*!< 空闲状态 */
+    UPROC_VERIFYING,       /*!< 正在校验CRC */
+    UPROC_WRITE_META,      /*!< 正在写入元数据 */
+    UPROC_DONE             /*!< 处理完成 */
+} UpdateProcState_t;
+
+static volatile uint8_t        g_finish_request = 0;  /*!< 完成请求标志 */
+static volatile UpdateProcState_t g_proc_state  = UPROC_IDLE;  /*!< 处理状态 */
+static uint32_t                g_crc_calc       = 0;  /*!< 计算得到的CRC值 */
+static uint8_t                 g_preerase_pending = 0;  /*!< 下载区等待后台预擦除 */
+static uint32_t                g_preerase_addr  = 0;  /*!< 下一个待预擦除扇区的起始地址 */
+static uint32_t                g_last_activity  = 0;  /*!< 最近一次收到升级帧的时刻（HAL tick） */
+static uint32_t                g_target_slot    = BOOT_SLOT_B;         /*!< 下载目标槽（当前运行槽之外的那个） */
+static uint32_t                g_target_addr    = FLASH_SLOT_B_ADDR;   /*!< 目标槽起始地址 */
+static uint32_t                g_target_end     = FLASH_SLOT_B_ADDR + FLASH_SLOT_B_SIZE;  /*!< 目标槽结束地址（不含） */
+static uint8_t                 g_confirm_pending = 0;  /*!< 运行中的镜像处于试运行，等待确认 */
+static uint32_t                g_encoding       = UPDATE_ENC_RAW;  /*!< 本次传输的编码 UPDATE_ENC_xxx */
+static uint32_t                g_stream_size    = 0;  /*!< 传输数据总长度（压缩时为压缩流长度） */
+static uint32_t                g_stream_pos     = 0;  /*!< 压缩流已按序解压到的偏移 */
+static Lz4Stream_t             g_lz;                  /*!< 压缩传输的流式解压器 */
+static DeltaPatch_t            g_delta;               /*!< 差分传输的补丁应用器（基线为当前运行槽） */
+
+/**
+ * @brief 运行镜像信息缓存：运行槽在应用运行期间不会被写，槽头校验（整片CRC）和分块CRC只算一次
+ */
+#define UPDATE_RUN_UNKNOWN     0xFFFFFFFFUL
+static uint32_t                g_run_size       = UPDATE_RUN_UNKNOWN;  /*!< 运行镜像大小，没有有效槽头时为0 */
+static uint32_t                g_run_crcs[UPDATE_DEDUP_BLOCK_COUNT];   /*!< 运行镜像各块CRC */
+static uint32_t                g_run_crc_blocks = 0;  /*!< g_run_crcs 中已算好的块数 */
+
+/**
+ * @brief 启动文件中的中断向量表，其链接地址就是本镜像所在槽的起始地址
+ */
+extern uint32_t g_pfnVectors[];
+
+/**
+ * @brief 提前到达（尚未能拼接）的数据块CRC记录
+ */
+typedef struct {
+    uint32_t offset;      /*!< 数据块偏移 */
+    uint32_t len;         /*!< 数据块长度 */
+    uint32_t crc;         /*!< 数据块CRC32 */
+} UpdateChunkCrc_t;
+
+static UpdateChunkCrc_t g_pending_crc[UPDATE_CRC_PENDING_MAX];  /*!< 暂存的乱序数据块CRC */
+static uint32_t         g_pending_cnt = 0;                       /*!< 暂存条数 */
+
+/**
+ * @brief 写合并槽：一个还没凑齐4字节的Flash字
+ */
+typedef struct {
+    uint32_t addr;        /*!< 字地址（4字节对齐） */
+    uint32_t value;       /*!< 已收到的字节，未收到的保持 0xFF */
+    uint8_t  mask;        /*!< 已收到字节位图，bit i 对应字内第 i 字节；0 表示空闲槽 */
+} UpdateWcSlot_t;
+
+/**
+ * @brief 半满块槽：一个只收到了部分Flash字的接收块
+ */
+typedef struct {
+    uint32_t block;                               /*!< 块号；UPDATE_PARTIAL_FREE 表示空闲槽 */
+    uint32_t words[UPDATE_BLOCK_WORDS / 32U];     /*!< 块内已编程字位图，bit i 对应块内第 i 个字 */
+} UpdatePartial_t;
+
+#define UPDATE_PARTIAL_FREE         0xFFFFFFFFUL
+
+static UpdateWcSlot_t   g_wc[UPDATE_WC_SLOTS];                   /*!< 写合并槽 */
+static UpdatePartial_t  g_partial[UPDATE_PARTIAL_SLOTS];         /*!< 半满块槽 */
+static uint32_t         g_partial_victim;                        /*!< 槽用尽时下一个被挤掉的槽 */
+static uint32_t         g_rx_bitmap[UPDATE_BLOCK_COUNT / 32U];   /*!< 接收位图：bit=1 表示该块已写入Flash */
+static uint32_t         g_progress[FLASHCV_PROGRESS_WORDS];      /*!< Flash中进度位图的副本：bit=0 表示已持久化 */
+
+#define UPDATE_BLOCKS_PER_PROGRESS  (FLASHCV_PROGRESS_BLOCK / UPDATE_BLOCK_SIZE)
+
+/**
+ * @brief 内部函数：把 [first, first+count) 这些块标记为已收到
+ */
+static void Update_MarkBlocks(uint32_t first, uint32_t count)
+{
+    while (count > 0U) {
+        uint32_t bit = first & 31U;
+        uint32_t n = 32U - bit;
+        if (n > count) n = count;
+
+        uint32_t mask = (n == 32U) ? 0xFFFFFFFFUL : (((1UL << n) - 1U) << bit);
+        g_rx_bitmap[first >> 5] |= mask;
+
+        first += n;
+        count -= n;
+    }
+}
+
+/**
+ * @brief 内部函数：[first, first+count) 这些块是否都已收到
+ */
+static uint8_t Update_BlocksComplete(uint32_t first, uint32_t count)
+{
+    while (count > 0U) {
+        uint32_t bit = first & 31U;
+        uint32_t n = 32U - bit;
+        if (n > count) n = count;
+
+        uint32_t mask = (n == 32U) ? 0xFFFFFFFFUL : (((1UL << n) - 1U) << bit);
+        if ((g_rx_bitmap[first >> 5] & mask) != mask) return 0U;
+
+        first += n;
+        count -= n;
+    }
+    return 1U;
+}
+
+/**
+ * @brief 内部函数：查找块 block 的半满块槽
+ * @return UpdatePartial_t* 没有时返回 NULL
+ */
+static UpdatePartial_t *Update_FindPartial(uint32_t block)
+{
+    for (uint32_t i = 0; i < UPDATE_PARTIAL_SLOTS; i++) {
+        if (g_partial[i].block == block) return &g_partial[i];
+    }
+    return NULL;
+}
+
+/**
+ * @brief 内部函数：块 block 在固件范围内的字数（最后一块截止到固件末尾）
+ */
+static uint32_t Update_BlockWords(uint32_t block)
+{
+    uint32_t nwords = (g_ctx.total_size + 3U) / 4U;
+    uint32_t first = block * UPDATE_BLOCK_WORDS;
+
+    return ((nwords - first) < UPDATE_BLOCK_WORDS) ? (nwords - first) : UPDATE_BLOCK_WORDS;
+}
+
+/**
+ * @brief 内部函数：把固件中第 [first, first+count) 个Flash字标记为已编程
+ * @note  整块覆盖的直接置位接收位图；部分覆盖的记在半满块槽里，块内的字收齐后再置位并释放槽。
+ *        槽用尽时轮流挤掉一个旧槽：被挤掉的块数据已经正确写入Flash，只是仍报告为缺失，
+ *        补发时内容相同的字不会再编程。按顺序补发时每次只有当前块占槽，一定能收齐
+ */
+static void Update_MarkWords(uint32_t first, uint32_t count)
+{
+    uint32_t end = first + count;
+
+    while (first < end) {
+        uint32_t block  = first / UPDATE_BLOCK_WORDS;
+        uint32_t bstart = block * UPDATE_BLOCK_WORDS;
+        uint32_t bwords = Update_BlockWords(block);
+        uint32_t n_end  = ((bstart + bwords) < end) ? (bstart + bwords) : end;
+        UpdatePartial_t *p = Update_FindPartial(block);
+
+        if (Update_BlocksComplete(block, 1U)) {
+            /* 重传 */
+        } else if (first == bstart && n_end == (bstart + bwords)) {
+            Update_MarkBlocks(block, 1U);
+            if (p != NULL) p->block = UPDATE_PARTIAL_FREE;
+        } else {
+            if (p == NULL) {
+                p = Update_FindPartial(UPDATE_PARTIAL_FREE);
+                if (p == NULL) {
+                    p = &g_partial[g_partial_victim];
+                    g_partial_victim = (g_partial_victim + 1U) % UPDATE_PARTIAL_SLOTS;
+                }
+                p->block = block;
+                memset(p->words, 0, sizeof(p->words));
+            }
+            for (uint32_t w = first - bstart; w < (n_end - bstart); w++) {
+                p->words[w >> 5] |= (1UL << (w & 31U));
+            }
+
+            uint32_t full = 1U;
+            for (uint32_t w = 0; w < bwords && full; w += 32U) {
+                uint32_t n = ((bwords - w) < 32U) ? (bwords - w) : 32U;
+                uint32_t mask = (n == 32U) ? 0xFFFFFFFFUL : ((1UL << n) - 1U);
+                full = ((p->words[w >> 5] & mask) == mask) ? 1U : 0U;
+            }
+            if (full) {
+                Update_MarkBlocks(block, 1U);
+                p->block = UPDATE_PARTIAL_FREE;
+            }
+        }
+
+        first = n_end;
+    }
+}
+
+/**
+ * @brief 内部函数：[offset, offset+len) 涉及的Flash字是否都已编程
+ * @note  整块看接收位图，半满的块看半满块槽；用于跳过重传，不再碰Flash
+ */
+static uint8_t Update_RangeReceived(uint32_t offset, uint32_t len)
+{
+    uint32_t w   = offset / 4U;
+    uint32_t end = (offset + len + 3U) / 4U;
+
+    while (w < end) {
+        uint32_t block  = w / UPDATE_BLOCK_WORDS;
+        uint32_t bstart = block * UPDATE_BLOCK_WORDS;
+        uint32_t b_end  = ((bstart + UPDATE_BLOCK_WORDS) < end) ? (bstart + UPDATE_BLOCK_WORDS) : end;
+
+        if (!Update_BlocksComplete(block, 1U)) {
+            const UpdatePartial_t *p = Update_FindPartial(block);
+            if (p == NULL) return 0U;
+            for (; w < b_end; w++) {
+                if ((p->words[(w - bstart) >> 5] & (1UL << ((w - bstart) & 31U))) == 0U) return 0U;
+            }
+        }
+        w = b_end;
+    }
+    return 1U;
+}
+
+/**
+ * @brief 内部函数：开头连续已收到的字节数
+ * @return uint32_t 第一个尚未收到的块的偏移；没有缺口时等于固件大小
+ */
+static uint32_t Update_ContiguousBytes(void)
+{
+    uint32_t nblocks = (g_ctx.total_size + UPDATE_BLOCK_SIZE - 1U) / UPDATE_BLOCK_SIZE;
+    uint32_t b = 0;
+
+    while (b < nblocks) {
+        uint32_t word = g_rx_bitmap[b >> 5];
+
+        if ((b & 31U) == 0U && word == 0xFFFFFFFFUL) { b += 32U; continue; }
+        if ((word & (1UL << (b & 31U))) == 0U) break;
+        b++;
+    }
+
+    return (b >= nblocks) ? g_ctx.total_size : (b * UPDATE_BLOCK_SIZE);
+}
+
+/**
+ * @brief 内部函数：进度块 index 覆盖的接收位图块数（最后一个进度块截止到固件末尾）
+ */
+static uint32_t Update_ProgressBlocks(uint32_t index)
+{
+    uint32_t nblocks = (g_ctx.total_size + UPDATE_BLOCK_SIZE - 1U) / UPDATE_BLOCK_SIZE;
+    uint32_t first = index * UPDATE_BLOCKS_PER_PROGRESS;
+
+    if (first >= nblocks) return 0U;
+    return ((nblocks - first) < UPDATE_BLOCKS_PER_PROGRESS) ? (nblocks - first) : UPDATE_BLOCKS_PER_PROGRESS;
+}
+
+/**
+ * @brief 内部函数：把 [offset, offset+len) 涉及的、已经收齐的进度块写入Flash进度位图
+ * @note  每个进度块只编程一次；失败不影响本次接收，只是复位后这一块需要重传
+ */
+static void Update_SaveProgress(uint32_t offset, uint32_t len)
+{
+    uint32_t last = (offset + len - 1U) / FLASHCV_PROGRESS_BLOCK;
+
+    for (uint32_t idx = offset / FLASHCV_PROGRESS_BLOCK; idx <= last; idx++) {
+        if ((g_progress[idx >> 5] & (1UL << (idx & 31U))) == 0U) continue;
+        if (!Update_BlocksComplete(idx * UPDATE_BLOCKS_PER_PROGRESS, Update_ProgressBlocks(idx))) continue;
+
+        if (FlashCV_MarkProgress(idx) == HAL_OK) {
+            g_progress[idx >> 5] &= ~(1UL << (idx & 31U));
+        }
+    }
+}
+
+/**
+ * @brief 内部函数：按Flash中的进度位图恢复上一次会话
+ * @note  已持久化的进度块直接记为已收到；开头连续已收到的部分从Flash算一次CRC，
+ *        后面到达的数据块照常拼接
+ */
+static void Update_ResumeSession(void)
+{
+    for (uint32_t idx = 0; idx < FLASHCV_PROGRESS_WORDS * 32U; idx++) {
+        if ((g_progress[idx >> 5] & (1UL << (idx & 31U))) == 0U) {
+            Update_MarkBlocks(idx * UPDATE_BLOCKS_PER_PROGRESS, Update_ProgressBlocks(idx));
+        }
+    }
+
+    g_ctx.crc_offset  = Update_ContiguousBytes();
+    g_ctx.running_crc = FlashCV_CalcCRC(g_target_addr, g_ctx.crc_offset);
+    g_ctx.received_size = g_ctx.crc_offset;
+}
+
+/**
+ * @brief 内部函数：把落在同一个Flash字内的若干字节并入写合并槽，凑齐后编程
+ * @note  需先 HAL_FLASH_Unlock
+ * @param addr 起始Flash地址
+ * @param data 数据
+ * @param n 字节数（不超过到字边界的距离）
+ * @return HAL_StatusTypeDef 操作状态；槽位用尽时返回 HAL_ERROR，上位机重传即可；
+ *         这个字已经编程过而重传的字节与之不同时也返回 HAL_ERROR
+ */
+static HAL_StatusTypeDef Update_WcMerge(uint32_t addr, const uint8_t *data, uint32_t n)
+{
+    uint32_t word_addr = addr & ~3UL;
+    uint32_t shift = addr & 3UL;
+    uint32_t image_end = g_target_addr + g_ctx.total_size;
+    UpdateWcSlot_t *slot = NULL;
+    UpdateWcSlot_t *free_slot = NULL;
+
+    for (uint32_t i = 0; i < UPDATE_WC_SLOTS; i++) {
+        if (g_wc[i].mask == 0U) {
+            if (free_slot == NULL) free_slot = &g_wc[i];
+        } else if (g_wc[i].addr == word_addr) {
+            slot = &g_wc[i];
+            break;
+        }
+    }
+
+    if (slot == NULL) {
+        /* 这个字已经编程过，说明是重传的数据：内容必须和已写入的一致，不同说明上位机发来的数据变了 */
+        if (*(volatile const uint32_t *)word_addr != 0xFFFFFFFFUL) {
+            if (memcmp((const void *)addr, data, n) != 0) return HAL_ERROR;
+            Update_MarkWords((word_addr - g_target_addr) / 4U, 1U);
+            return HAL_OK;
+        }
+        if (free_slot == NULL) return HAL_ERROR;
+
+        slot = free_slot;
+        slot->addr  = word_addr;
+        slot->value = 0xFFFFFFFFUL;
+        slot->mask  = 0U;
+        /* 固件末尾之后的字节不会再收到，视为已到（保持 0xFF） */
+        for (uint32_t b = 0; b < 4U; b++) {
+            if ((word_addr + b) >= image_end) slot->mask |= (uint8_t)(1U << b);
+        }
+    }
+
+    for (uint32_t i = 0; i < n; i++) {
+        ((uint8_t *)&slot->value)[shift + i] = data[i];
+        slot->mask |= (uint8_t)(1U << (shift + i));
+    }
+
+    if (slot->mask != 0x0FU) return HAL_OK;
+
+    slot->mask = 0U;
+    if (FlashCV_ProgramBuffer(word_addr, (const uint8_t *)&slot->value, 4U) != HAL_OK) return HAL_ERROR;
+
+    Update_MarkWords((word_addr - g_target_addr) / 4U, 1U);
+    return HAL_OK;
+}
+
+/**
+ * @brief 内部函数：整字编程，跳过与Flash中内容相同的字
+ * @note  重传或续传时一部分字早已写过，只把内容不同的连续字段交给 FlashCV_ProgramBuffer，
+ *        每个Flash字只编程一次；需先 HAL_FLASH_Unlock
+ * @param addr 目标Flash地址（4字节对齐）
+ * @param data 数据（不要求对齐）
+ * @param len 长度（4的整数倍）
+ * @return HAL_StatusTypeDef 操作状态；内容不同的字已经编程过（重传的数据变了）时返回 HAL_ERROR，
+ *         不在它上面再编程一次
+ */
+static HAL_StatusTypeDef Update_ProgramChanged(uint32_t addr, const uint8_t *data, uint32_t len)
+{
+    uint32_t i = 0;
+
+    while (i < len) {
+        uint32_t start;
+
+        while (i < len && memcmp((const void *)(addr + i), &data[i], 4U) == 0) i += 4U;
+        start = i;
+        while (i < len && memcmp((const void *)(addr + i), &data[i], 4U) != 0) {
+            if (*(volatile const uint32_t *)(addr + i) != 0xFFFFFFFFUL) return HAL_ERROR;
+            i += 4U;
+        }
+
+        if (i > start && FlashCV_ProgramBuffer(addr + start, &data[start], i - start) != HAL_OK) {
+            return HAL_ERROR;
+        }
+    }
+
+    return HAL_OK;
+}
+
+/**
+ * @brief 内部函数：释放落在 [start, end) 内的写合并槽
+ * @note  补发的数据块把某个半截字整字写入后，槽里那半截不能再编程第二次
+ */
+static void Update_WcDrop(uint32_t start, uint32_t end)
+{
+    for (uint32_t i = 0; i < UPDATE_WC_SLOTS; i++) {
+        if (g_wc[i].mask != 0U && g_wc[i].addr >= start && g_wc[i].addr < end) {
+            g_wc[i].mask = 0U;
+        }
+    }
+}
+
+/**
+ * @brief 内部函数：把写合并槽里剩下的字全部编程（缺的字节按 0xFF）
+ * @return HAL_StatusTypeDef 操作状态
+ */
+static HAL_StatusTypeDef Update_WcFlush(void)
+{
+    HAL_StatusTypeDef status = HAL_OK;
+
+    HAL_FLASH_Unlock();
+    for (uint32_t i = 0; i < UPDATE_WC_SLOTS; i++) {
+        if (g_wc[i].mask == 0U) continue;
+        g_wc[i].mask = 0U;
+        if (FlashCV_ProgramBuffer(g_wc[i].addr, (const uint8_t *)&g_wc[i].value, 4U) != HAL_OK) {
+            status = HAL_ERROR;
+        }
+    }
+    HAL_FLASH_Lock();
+
+    return status;
+}
+
+/**
+ * @brief 内部函数：登记一个已写入数据块的CRC，并尽量拼接到 running_crc 上
+ * @param offset 数据块偏移
+ * @param data 数据块内容
+ * @param len 数据块长度
+ */
+static void Update_TrackChunkCrc(uint32_t offset, const uint8_t *data, uint32_t len)
+{
+    if (!g_ctx.crc_valid) return;
+
+    /* 重传：完全落在已拼接部分内，数据早已计入 */
+    if ((offset + len) <= g_ctx.crc_offset) return;
+
+    /* 与已拼接部分部分重叠，无法拼接 */
+    if (offset < g_ctx.crc_offset) {
+        g_ctx.crc_valid = 0U;
+        return;
+    }
+
+    /* 与暂存块比较：完全相同视为重传，部分重叠则放弃拼接 */
+    for (uint32_t i = 0; i < g_pending_cnt; i++) {
+        const UpdateChunkCrc_t *p = &g_pending_crc[i];
+        if (offset < (p->offset + p->len) && p->offset < (offset + len)) {
+            if (p->offset != offset || p->len != len) {
+                g_ctx.crc_valid = 0U;
+            }
+            return;
+        }
+    }
+
+    uint32_t crc = FlashCV_CrcFinal(FlashCV_CrcUpdate(FlashCV_CrcInit(), data, len));
+
+    if (offset != g_ctx.crc_offset) {
+        /* 提前到达，先暂存 */
+        if (g_pending_cnt >= UPDATE_CRC_PENDING_MAX) {
+            g_ctx.crc_valid = 0U;
+            return;
+        }
+        g_pending_crc[g_pending_cnt].offset = offset;
+        g_pending_crc[g_pending_cnt].len    = len;
+        g_pending_crc[g_pending_cnt].crc    = crc;
+        g_pending_cnt++;
+        return;
+    }
+
+    g_ctx.running_crc = FlashCV_CrcCombine(g_ctx.running_crc, crc, len);
+    g_ctx.crc_offset += len;
+
+    /* 把已经能接上的暂存块依次合并进来 */
+    uint32_t i = 0;
+    while (i < g_pending_cnt) {
+        UpdateChunkCrc_t *p = &g_pending_crc[i];
+        if (p->offset == g_ctx.crc_offset) {
+            g_ctx.running_crc = FlashCV_CrcCombine(g_ctx.running_crc, p->crc, p->len);
+            g_ctx.crc_offset += p->len;
+            *p = g_pending_crc[--g_pending_cnt];
+            i = 0;
+        } else {
+            i++;
+        }
+    }
+}
+
+/**
+ * @brief 内部函数：擦除目标槽中本次固件要用到的部分
+ * @note  只擦固件覆盖到的扇区，已经空白的扇区跳过
+ * @param size 固件大小（字节）
+ * @return HAL_StatusTypeDef 操作状态
+ */
+static HAL_StatusTypeDef Update_EraseDownloadArea(uint32_t size)
+{
+    return FlashCV_EraseRange(g_target_addr, size);
+}
+
+/**
+ * @brief 内部函数：确认当前运行的镜像，结束试运行
+ * @note  确认之后 Bootloader 不再计启动次数，也不会自动回滚
+ */
+static void Update_ConfirmRunning(void)
+{
+    if (!g_confirm_pending) return;
+
+    if (FlashCV_ConfirmSlot(Update_GetRunningSlot()) == HAL_OK) {
+        g_confirm_pending = 0U;
+    }
+}
+
+/**
+ * @brief 内部函数：安排后台预擦除整个目标槽
+ * @note  先作废会话记录和目标槽的槽头，擦到一半复位也不会被当成可续传的数据或可启动的镜像
+ */
+static void Update_SchedulePreErase(void)
+{
+    FlashCV_DropSession();
+    FlashCV_InvalidateSlot(g_target_slot);
+    g_preerase_pending = 1U;
+    g_preerase_addr    = g_target_addr;
+}
+
+/**
+ * @brief 内部函数：目标槽可以擦除时安排后台预擦除
+ * @note  待搬运的固件还在下载区里（flag 仍为 VALID）、有可续传的会话、下载区已经是 CLEAN，
+ *        或者目标槽里是留作回滚的上一版镜像时不擦，等下一次 START_UPDATE 再擦。
+ *        UPDATE_PREERASE_AFTER_CONFIRM=1 时运行镜像一经确认就不再保留回滚镜像
+ */
+static void Update_CheckPreErase(void)
+{
+    BootMeta_t meta;
+    BootSession_t session;
+    SlotHeader_t hdr;
+
+    FlashCV_ReadMeta(&meta);
+    FlashCV_ReadSession(&session, NULL);
+    FlashCV_ReadSlot(g_target_slot, &hdr);
+#if UPDATE_PREERASE_AFTER_CONFIRM
+    if (!g_confirm_pending) {
+        hdr.magic = 0U;
+    }
+#endif
+    if (meta.flag != UPGRADE_FLAG_VALID && meta.slot_state != DOWNLOAD_SLOT_CLEAN &&
+        session.magic != SESSION_MAGIC && hdr.magic != SLOT_HEADER_MAGIC) {
+        Update_SchedulePreErase();
+    }
+}
+
+/**
+ * @brief 内部函数：后台预擦除一步（最多一个扇区）
+ * @note  在通信任务里分片执行，两个扇区之间照常处理串口帧；出错时放弃，
+ *        留给下一次 START_UPDATE 同步擦除
+ */
+static void Update_PreEraseStep(void)
+{
+    uint32_t end = FlashCV_SectorEnd(g_preerase_addr);
+    if (end > g_target_end) {
+        end = g_target_end;
+    }
+
+    if (end <= g_preerase_addr ||
+        FlashCV_EraseRange(g_preerase_addr, end - g_preerase_addr) != HAL_OK) {
+        g_preerase_pending = 0U;
+        return;
+    }
+
+    g_preerase_addr = end;
+    if (g_preerase_addr >= g_target_end) {
+        g_preerase_pending = 0U;
+        FlashCV_MarkDownloadClean();
+    }
+}
+
+/**
+ * @brief 内部函数：把固件中 [offset, offset+len) 这段数据写入目标槽
+ * @note  原样传输时就是 DATA 帧的内容；压缩传输时由解压器按顺序交来解出的数据
+ * @param offset 数据在固件中的偏移位置（字节）
+ * @param data 数据
+ * @param len 数据长度（字节）
+ * @return HAL_StatusTypeDef 操作状态
+ */
+static HAL_StatusTypeDef Update_WriteImage(uint32_t offset, const uint8_t *data, uint32_t len)
+{
+    // 越界检查
+    if ((offset + len) > g_ctx.total_size) return HAL_ERROR;
+
+    /* 涉及的字都已写入：重传，不再碰Flash；内容和已写入的不同时拒绝，上位机立即知道数据不一致，
+       不用等到最后整体CRC失败才发现 */
+    if (Update_RangeReceived(offset, len)) {
+        return (memcmp((const void *)(g_target_addr + offset), data, len) == 0) ? HAL_OK : HAL_ERROR;
+    }
+
+    HAL_StatusTypeDef status = HAL_OK;
+    uint32_t addr = g_target_addr + offset;
+    uint32_t head = (4U - (addr & 3U)) & 3U;     /* 开头到字边界的字节 */
+    if (head > len) head = len;
+    uint32_t body = (len - head) & ~3UL;         /* 中间的整字 */
+    uint32_t tail = len - head - body;           /* 结尾不足一个字的字节 */
+
+    HAL_FLASH_Unlock();
+    if (head > 0U) {
+        status = Update_WcMerge(addr, data, head);
+    }
+    if (status == HAL_OK && body > 0U) {
+        status = Update_ProgramChanged(addr + head, &data[head], body);
+    }
+    if (status == HAL_OK && body > 0U) {
+        Update_WcDrop(addr + head, addr + head + body);
+        Update_MarkWords((offset + head) / 4U, body / 4U);
+    }
+    if (status == HAL_OK && tail > 0U) {
+        status = Update_WcMerge(addr + head + body, &data[head + body], tail);
+    }
+    HAL_FLASH_Lock();
+
+    if (status != HAL_OK) {
+        return status;
+    }
+
+    /* 收齐的进度块写入Flash，断线或复位后从这里续传 */
+    Update_SaveProgress(offset, len);
+
+    /* 边收边算CRC：每块单独算CRC，按偏移拼接，乱序和重传都不需要回读Flash */
+    Update_TrackChunkCrc(offset, data, len);
+
+    uint32_t new_end = offset + len;
+    if (g_ctx.received_size < new_end) {
+        g_ctx.received_size = new_end;
+    }
+
+    return HAL_OK;
+}
+
+/**
+ * @brief 内部函数：差分传输时，解压出来的补丁交给补丁应用器
+ * @note  解压器按顺序输出，offset 就是补丁应用器已经消耗的长度，不需要再用
+ * @param offset 数据在补丁中的偏移
+ * @param data 补丁数据
+ * @param len 长度（字节）
+ * @return HAL_StatusTypeDef 操作状态
+ */
+static HAL_StatusTypeDef Update_ApplyPatch(uint32_t offset, const uint8_t *data, uint32_t len)
+{
+    (void)offset;
+    return DeltaPatch_Feed(&g_delta, data, len);
+}
+
+/**
+ * @brief 内部函数：压缩或差分传输时接收一段压缩流
+ * @note  压缩流只能按顺序解压：已解压过的部分视为重传，只解后面新的字节；
+ *        前面还有缺口时返回 HAL_BUSY，不消耗这段数据，等上位机按顺序重传
+ * @param offset 数据在压缩流中的偏移
+ * @param data 数据
+ * @param len 数据长度（字节）
+ * @return HAL_StatusTypeDef 操作状态
+ */
+static HAL_StatusTypeDef Update_ReceiveCompressed(uint32_t offset, const uint8_t *data, uint16_t len)
+{
+    if ((offset + len) > g_stream_size) return HAL_ERROR;
+    if ((offset + len) <= g_stream_pos) return HAL_OK;
+    if (offset > g_stream_pos)          return HAL_BUSY;
+
+    uint32_t skip = g_stream_pos - offset;
+    if (Lz4Stream_Feed(&g_lz, &data[skip], len - skip) != HAL_OK) {
+        return HAL_ERROR;
+    }
+
+    g_stream_pos += len - skip;
+    return HAL_OK;
+}
+
+void Update_Init(void)
+{
+    BootMeta_t meta;
+
+    memset(&g_ctx, 0, sizeof(g_ctx));
+    g_ctx.state = UPDATE_IDLE;
+    BootMailbox_Init();
+    g_finish_request = 0;
+    g_proc_state     = UPROC_IDLE;
+    g_preerase_pending = 0U;
+
+    /* 下载目标是当前运行槽之外的那个槽：即使 Bootloader 因活动槽损坏退到了另一个槽，
+       也不会擦写正在运行的镜像 */
+    g_target_slot = (Update_GetRunningSlot() == BOOT_SLOT_A) ? BOOT_SLOT_B : BOOT_SLOT_A;
+    g_target_addr = FlashCV_SlotAddr(g_target_slot);
+    g_target_end  = g_target_addr + FlashCV_SlotSize(g_target_slot);
+
+    /* 刚提交的新镜像在试运行：运行 UPDATE_CONFIRM_DELAY_MS 之后确认 */
+    FlashCV_ReadMeta(&meta);
+    g_confirm_pending = (meta.boot_state == BOOT_STATE_TRIAL &&
+                         meta.active_slot == Update_GetRunningSlot()) ? 1U : 0U;
+
+    Update_CheckPreErase();
+}
+
+UpdateState_t Update_GetState(void)
+{
+    return g_ctx.state;
+}
+
+uint32_t Update_GetRunningSlot(void)
+{
+    return ((uint32_t)g_pfnVectors >= FLASH_SLOT_B_ADDR) ? BOOT_SLOT_B : BOOT_SLOT_A;
+}
+
+/**
+ * @brief 内部函数：运行镜像大小，运行槽没有有效槽头时为0
+ * @note  第一次调用时读槽头并校验整片CRC，结果缓存到复位
+ */
+static uint32_t Update_RunningSize(void)
+{
+    if (g_run_size == UPDATE_RUN_UNKNOWN) {
+        SlotHeader_t hdr;
+        uint32_t running = Update_GetRunningSlot();
+
+        FlashCV_ReadSlot(running, &hdr);
+        g_run_size = FlashCV_SlotValid(running, &hdr) ? hdr.image_size : 0U;
+    }
+    return g_run_size;
+}
+
+uint32_t Update_GetTargetSlot(void)
+{
+    return g_target_slot;
+}
+
+uint8_t Update_IsConfirmed(void)
+{
+    return g_confirm_pending ? 0U : 1U;
+}
+
+uint8_t Update_CanRollback(void)
+{
+    SlotHeader_t hdr;
+
+    if (g_ctx.state != UPDATE_IDLE || g_preerase_pending) return 0U;
+
+    FlashCV_ReadSlot(g_target_slot, &hdr);
+    return FlashCV_SlotValid(g_target_slot, &hdr);
+}
+
+HAL_StatusTypeDef Update_Rollback(void)
+{
+    if (!Update_CanRollback()) {
+        return HAL_ERROR;
+    }
+
+    /* 只追加一条元数据记录：另一个槽成为活动槽，当前镜像原样保留，之后还能切回来 */
+    if (FlashCV_SwitchSlot(g_target_slot) != HAL_OK) {
+        return HAL_ERROR;
+    }
+
+    g_confirm_pending = 0U;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef Update_Start(uint32_t total_size, uint32_t crc, uint32_t version,
+                               uint32_t encoding, uint32_t stream_size)
+{
+    // 参数检查
+    if (total_size == 0U) {
+        return HAL_ERROR;
+    }
+    if (encoding == UPDATE_ENC_RAW) {
+        stream_size = total_size;
+    } else if ((encoding != UPDATE_ENC_LZ4 && encoding != UPDATE_ENC_DELTA) || stream_size == 0U) {
+        return HAL_ERROR;
+    }
+
+    /* 差分传输以当前运行的镜像为基线，运行槽没有有效槽头（例如调试器直接烧录）时不能打补丁 */
+    SlotHeader_t base;
+    uint32_t running = Update_GetRunningSlot();
+    FlashCV_ReadSlot(running, &base);
+    if (encoding == UPDATE_ENC_DELTA && Update_RunningSize() == 0U) {
+        return HAL_ERROR;
+    }
+
+    /* 不能越界目标槽 */
+    if ((g_target_addr + total_size) > g_target_end) {
+        return HAL_ERROR;
+    }
+
+    /* 能收到新的升级请求说明当前镜像工作正常，先确认它，免得升级到一半复位时被回滚 */
+    Update_ConfirmRunning();
+
+    g_ctx.total_size    = total_size;
+    g_ctx.image_crc     = crc;
+    g_ctx.version       = version;
+    g_ctx.received_size = 0U;
+    g_ctx.running_crc   = 0U;      /* 空数据的CRC32 */
+    g_ctx.crc_offset    = 0U;
+    g_ctx.crc_valid     = 1U;
+    g_pending_cnt       = 0U;
+    memset(g_wc, 0, sizeof(g_wc));
+    memset(g_partial, 0xFF, sizeof(g_partial));
+    g_partial_victim = 0U;
+    memset(g_rx_bitmap, 0, sizeof(g_rx_bitmap));
+    g_ctx.state         = UPDATE_RECEIVING;
+    g_last_activity     = HAL_GetTick();
+
+    /* 压缩流总是从头解压；续传时已写入的块在 Update_WriteImage 里直接跳过，不再碰Flash。
+       差分传输时解出的是补丁，补丁长度事先未知，由补丁应用器检查输出大小 */
+    g_encoding    = encoding;
+    g_stream_size = stream_size;
+    g_stream_pos  = 0U;
+    if (encoding == UPDATE_ENC_DELTA) {
+        DeltaPatch_Init(&g_delta, (const uint8_t *)FlashCV_SlotAddr(running), base.image_size,
+                        base.image_crc, total_size, Update_WriteImage);
+        Lz4Stream_Init(&g_lz, 0xFFFFFFFFUL, Update_ApplyPatch);
+    } else {
+        Lz4Stream_Init(&g_lz, total_size, Update_WriteImage);
+    }
+
+    BootMeta_t meta;
+    BootSession_t session;
+    HAL_StatusTypeDef st = HAL_OK;
+
+    FlashCV_ReadMeta(&meta);
+    FlashCV_ReadSession(&session, g_progress);
+    g_preerase_pending = 0U;
+
+    /* 同一固件的会话还在：不擦除，按进度位图续传 */
+    if (meta.flag != UPGRADE_FLAG_VALID && meta.slot_state != DOWNLOAD_SLOT_CLEAN &&
+        session.magic == SESSION_MAGIC && session.slot == g_target_slot &&
+        session.image_size == total_size && session.image_crc == crc && session.version == version) {
+        Update_ResumeSession();
+        return HAL_OK;
+    }
+
+    /* 下载区已被后台预擦除时直接开始；否则同步擦除（预擦除做了一半的扇区会因空白被跳过）。
+       目标槽里留作回滚的上一版镜像在擦除前先作废槽头 */
+    memset(g_progress, 0xFF, sizeof(g_progress));
+    if (meta.slot_state != DOWNLOAD_SLOT_CLEAN) {
+        st = FlashCV_InvalidateSlot(g_target_slot);
+        if (st == HAL_OK) {
+            st = Update_EraseDownloadArea(total_size);
+        }
+    }
+
+    /* 写入第一个数据块之前，先让 Bootloader 和下次启动知道下载区已经不干净了，
+       同时记下会话身份，断线或复位后同一固件可以续传 */
+    if (st == HAL_OK) {
+        session.image_size = total_size;
+        session.image_crc  = crc;
+        session.version    = version;
+        session.slot       = g_target_slot;
+        st = FlashCV_BeginSession(&session);
+    }
+
+    if (st != HAL_OK) {
+        g_ctx.state = UPDATE_IDLE;
+        Update_SchedulePreErase();
+        return st;
+    }
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef Update_ReceiveChunk(uint32_t offset, const uint8_t *data, uint16_t len)
+{
+    if (g_ctx.state != UPDATE_RECEIVING) return HAL_ERROR;
+    if (data == NULL || len == 0U)       return HAL_ERROR;
+
+    g_last_activity = HAL_GetTick();
+
+    if (g_encoding != UPDATE_ENC_RAW) {
+        return Update_ReceiveCompressed(offset, data, len);
+    }
+    return Update_WriteImage(offset, data, len);
+}
+
+HAL_StatusTypeDef Update_RequestFinish(void)
+{
+    if (g_ctx.state != UPDATE_RECEIVING) {
+        return HAL_ERROR;
+    }
+    /* 压缩流必须完整解压，停在最后一个序列之后；差分时补丁也必须完整应用 */
+    if (g_encoding != UPDATE_ENC_RAW &&
+        (g_stream_pos != g_stream_size || !Lz4Stream_Done(&g_lz))) {
+        return HAL_ERROR;
+    }
+    if (g_encoding == UPDATE_ENC_LZ4 && g_lz.out != g_ctx.total_size) {
+        return HAL_ERROR;
+    }
+    if (g_encoding == UPDATE_ENC_DELTA && !DeltaPatch_Done(&g_delta)) {
+        return HAL_ERROR;
+    }
+    /* 乱序接收时最大结束偏移到头不代表中间没有缺口，以接收位图为准 */
+    if (!Update_BlocksComplete(0U, (g_ctx.total_size + UPDATE_BLOCK_SIZE - 1U) / UPDATE_BLOCK_SIZE)) {
+        return HAL_ERROR;
+    }
+    if (Update_WcFlush() != HAL_OK) {
+        return HAL_ERROR;
+    }
+
+    g_finish_request = 1U;
+    g_proc_state     = UPROC_VERIFYING;
+    g_ctx.state      = UPDATE_FINISH_REQUESTED;
+    return HAL_OK;
+}
+
+uint32_t Update_GetMissing(uint32_t from, UpdateRange_t *ranges, uint32_t max, uint32_t *next)
+{
+    uint32_t nblocks = (g_ctx.total_size + UPDATE_BLOCK_SIZE - 1U) / UPDATE_BLOCK_SIZE;
+    uint32_t b = from / UPDATE_BLOCK_SIZE;
+    uint32_t n = 0;
+
+    if (ranges == NULL || next == NULL) return 0U;
+
+    /* 压缩/差分传输：缺的只可能是压缩流中尚未解压的尾部 */
+    if (g_encoding != UPDATE_ENC_RAW) {
+        uint32_t start = (from > g_stream_pos) ? from : g_stream_pos;
+
+        *next = g_stream_size;
+        if (start >= g_stream_size || max == 0U) return 0U;
+        ranges[0].offset = start;
+        ranges[0].len    = g_stream_size - start;
+        return 1U;
+    }
+
+    while (b < nblocks && n < max) {
+        uint32_t word = g_rx_bitmap[b >> 5];
+
+        /* 跳过已收到的块，整字全满时一次跳32块 */
+        if ((b & 31U) == 0U && word == 0xFFFFFFFFUL) { b += 32U; continue; }
+        if (word & (1UL << (b & 31U)))               { b++;      continue; }
+
+        uint32_t start = b;
+        while (b < nblocks) {
+            word = g_rx_bitmap[b >> 5];
+            if ((b & 31U) == 0U && word == 0U) { b += 32U; continue; }
+            if (word & (1UL << (b & 31U))) break;
+            b++;
+        }
+        if (b > nblocks) b = nblocks;
+
+        ranges[n].offset = start * UPDATE_BLOCK_SIZE;
+        ranges[n].len    = b * UPDATE_BLOCK_SIZE - ranges[n].offset;
+        if ((ranges[n].offset + ranges[n].len) > g_ctx.total_size) {
+            ranges[n].len = g_ctx.total_size - ranges[n].offset;
+        }
+        n++;
+    }
+
+    *next = (b >= nblocks) ? g_ctx.total_size : (b * UPDATE_BLOCK_SIZE);
+    return n;
+}
+
+uint32_t Update_GetBlockCrcs(uint32_t first, uint32_t *crcs, uint32_t max, uint32_t *image_size)
+{
+    uint32_t base = FlashCV_SlotAddr(Update_GetRunningSlot());
+    uint32_t nblocks;
+    uint32_t n = 0;
+
+    if (crcs == NULL || image_size == NULL) return 0U;
+
+    *image_size = Update_RunningSize();
+    nblocks = (*image_size + UPDATE_DEDUP_BLOCK_SIZE - 1U) / UPDATE_DEDUP_BLOCK_SIZE;
+
+    /* 上位机分页顺序查询，缓存按需往后补齐，整个镜像只算一遍 */
+    while (g_run_crc_blocks < nblocks && g_run_crc_blocks < (first + max)) {
+        uint32_t offset = g_run_crc_blocks * UPDATE_DEDUP_BLOCK_SIZE;
+        uint32_t len = *image_size - offset;
+
+        if (len > UPDATE_DEDUP_BLOCK_SIZE) len = UPDATE_DEDUP_BLOCK_SIZE;
+        g_run_crcs[g_run_crc_blocks++] = FlashCV_CalcCRC(base + offset, len);
+    }
+
+    while (n < max && (first + n) < nblocks) {
+        crcs[n] = g_run_crcs[first + n];
+        n++;
+    }
+    return n;
+}
+
+HAL_StatusTypeDef Update_CopyFromRunning(uint32_t offset, uint32_t len, const uint8_t *reloc)
+{
+    uint32_t running = Update_GetRunningSlot();
+    uint32_t run_size = Update_RunningSize();
+    uint32_t delta = FlashCV_SlotAddr(Update_GetTargetSlot()) - FlashCV_SlotAddr(running);
+    uint32_t word = 0;      /* 本段内的字序号，对应 reloc 的位 */
+
+    if (g_ctx.state != UPDATE_RECEIVING || g_encoding != UPDATE_ENC_RAW) return HAL_ERROR;
+    if (len == 0U) return HAL_ERROR;
+    if (reloc != NULL && (offset & 3U) != 0U) return HAL_ERROR;
+
+    if (run_size == 0U || offset >= run_size || len > (run_size - offset)) {
+        return HAL_ERROR;
+    }
+
+    g_last_activity = HAL_GetTick();
+
+    /* 先分段读进SRAM再写：编程期间不从Flash取数据，串口中断照常在SRAM里执行 */
+    static uint32_t buf[64];
+    const uint8_t *src = (const uint8_t *)FlashCV_SlotAddr(running);
+
+    while (len > 0U) {
+        uint32_t n = (len > sizeof(buf)) ? sizeof(buf) : len;
+
+        memcpy(buf, &src[offset], n);
+        if (reloc != NULL) {
+            /* 只修正完整的字；末尾不足一个字的字节不含地址 */
+            for (uint32_t i = 0; i < n / 4U; i++, word++) {
+                if (reloc[word >> 3] & (1U << (word & 7U))) {
+                    buf[i] += delta;
+                }
+            }
+        }
+        if (Update_WriteImage(offset, (const uint8_t *)buf, n) != HAL_OK) {
+            return HAL_ERROR;
+        }
+        offset += n;
+        len    -= n;
+    }
+    return HAL_OK;
+}
+
+uint32_t Update_GetResumeOffset(void)
+{
+    if (g_encoding != UPDATE_ENC_RAW) {
+        return g_stream_pos;
+    }
+    return Update_ContiguousBytes();
+}
+
+uint32_t Update_GetTransferSize(void)
+{
+    return g_stream_size;
+}
+
+void Update_ProcessInIdle(void)
+{
+    /* 试运行的镜像跑满 UPDATE_CONFIRM_DELAY_MS（调度器和通信任务都在工作）就确认 */
+    if (g_confirm_pending && HAL_GetTick() >= UPDATE_CONFIRM_DELAY_MS) {
+        Update_ConfirmRunning();
+#if UPDATE_PREERASE_AFTER_CONFIRM
+        if (!g_confirm_pending && g_ctx.state == UPDATE_IDLE && !g_finish_request) {
+            Update_CheckPreErase();
+        }
+#endif
+    }
+
+    if (!g_finish_request) {
+        /* 上位机中途放弃：会话超时后回到空闲，下载区里的半截数据和会话记录保留，
+           同一固件重新 START 时续传，换了固件时再擦除 */
+        if (g_ctx.state == UPDATE_RECEIVING &&
+            (HAL_GetTick() - g_last_activity) >= UPDATE_SESSION_TIMEOUT_MS) {
+            g_ctx.state = UPDATE_IDLE;
+        }
+
+        if (g_ctx.state == UPDATE_IDLE && g_preerase_pending) {
+            Update_PreEraseStep();
+        }
+        return;
+    }
+
+    switch (g_proc_state)
+    {
+    case UPROC_VERIFYING:
+        /* 整体 CRC 校验：能拼出整片时直接用拼接结果，否则对目标槽做一次 CRC32 */
+        if (g_ctx.crc_valid && g_ctx.crc_offset == g_ctx.total_size) {
+            g_crc_calc = g_ctx.running_crc;
+        } else {
+            g_crc_calc = FlashCV_CalcCRC(g_target_addr, g_ctx.total_size);
+        }
+        /* CRC 只说明数据与上位机发送的一致；发来另一个槽的链接版本时靠向量表挡住 */
+        if (g_crc_calc == g_ctx.image_crc && FlashCV_CheckVectors(g_target_slot, g_ctx.total_size)) {
+            g_proc_state = UPROC_WRITE_META;
+        } else {
+            /* CRC 错误或镜像不是为目标槽链接的，升级失败 */
+            g_finish_request = 0U;
+            g_proc_state     = UPROC_IDLE;
+            g_ctx.state      = UPDATE_IDLE;
+            Update_SchedulePreErase();
+            /* 这里你可以增加一个错误标志，后续任务里通知上位机 */
+        }
+        break;
+
+    case UPROC_WRITE_META:
+    {
+        SlotHeader_t hdr;
+        hdr.magic      = SLOT_HEADER_MAGIC;
+        hdr.image_size = g_ctx.total_size;
+        hdr.image_crc  = g_ctx.image_crc;
+        hdr.version    = g_ctx.version;
+
+        /* 提交只是一条元数据记录：写入目标槽的槽头并切换活动槽，不再需要 Bootloader 搬运 */
+        if (FlashCV_CommitSlot(g_target_slot, &hdr) == HAL_OK) {
+            g_proc_state = UPROC_DONE;
+        } else {
+            g_finish_request = 0U;
+            g_proc_state     = UPROC_IDLE;
+            g_ctx.state      = UPDATE_IDLE;
+        }
+    }
+        break;
+
+    case UPROC_DONE:
+        g_ctx.state      = UPDATE_FINISHED;
+        g_finish_request = 0U;
+        /* 提交完成，软复位后 Bootloader 直接从新槽启动 */
+        NVIC_SystemReset();
+        while (1) { }
+        break;
+
+    default:
+        g_finish_request = 0U;
+        g_proc_state     = UPROC_IDLE;
+        g_ctx.state      = UPDATE_IDLE;
+        break;
+    }
 }
\ No newline at end of file
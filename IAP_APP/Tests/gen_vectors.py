@@ -0,0 +1,152 @@
+"""
+生成主机测试用的向量：用上位机 iap_send.py 里的 lz4_compress / delta_diff 编码，
+设备端的 Lz4Stream / DeltaPatch 在主机测试中解码后必须得到原始数据。
+
+用法：python gen_vectors.py <输出目录> [固件构建目录]
+给出固件构建目录且其中有 app.bin / app_b.bin 时，真实镜像也作为 LZ4 用例（lz4_bin_app / lz4_bin_app_b），
+并打印压缩率；没有时只用合成数据。
+输出：
+  vectors.txt          每行一个用例："lz4 <名字>" 或 "delta <名字>"
+  <名字>.raw/.lz4      LZ4 用例的原始数据和压缩流
+  <名字>.old/.new      差分用例的基线和新镜像
+  <名字>.patch         delta_diff 生成的补丁（未压缩）
+  <名字>.patch.lz4     压缩后的补丁，和设备实际收到的传输流一致
+"""
+import os
+import random
+import struct
+import sys
+import types
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "..", "IAP_Tool_Python"))
+
+# 只用到编码函数，没装 pyserial 的机器上用一个空模块顶替
+try:
+    import serial  # noqa: F401
+except ImportError:
+    _serial = types.ModuleType("serial")
+    _serial.Serial = object
+    sys.modules["serial"] = _serial
+
+from iap_send import lz4_compress, delta_diff, delta_apply, lz4_decompress  # noqa: E402
+
+
+def fake_image(rng: random.Random, size: int, base_addr: int) -> bytes:
+    """拼一块像固件的数据：向量表（绝对地址）+ 重复的指令片段 + 常量表 + 随机字节"""
+    out = bytearray()
+    for i in range(98):
+        out += struct.pack("<I", base_addr + 0x200 + i * 8 + 1)
+    snippets = [bytes(rng.randrange(256) for _ in range(rng.randrange(6, 40))) for _ in range(24)]
+    while len(out) < size * 3 // 4:
+        if rng.random() < 0.15:
+            out += struct.pack("<I", base_addr + rng.randrange(0, size, 4))   # 文字池里的绝对地址
+        else:
+            out += rng.choice(snippets)
+    out += bytes(rng.randrange(256) for _ in range(size - len(out)))
+    return bytes(out[:size])
+
+
+def relink(img: bytes, old_base: int, new_base: int, size: int) -> bytes:
+    """把落在 [old_base, old_base+size) 里的字改到 new_base，模拟换槽重新链接"""
+    out = bytearray(img)
+    for p in range(0, len(out) - 3, 4):
+        v = struct.unpack_from("<I", out, p)[0]
+        if old_base <= (v & ~1) < old_base + size:
+            struct.pack_into("<I", out, p, v - old_base + new_base)
+    return bytes(out)
+
+
+def has_negative_seek(patch: bytes) -> bool:
+    i = 16
+    while i < len(patch):
+        add_len, extra_len, seek = struct.unpack_from("<IIi", patch, i)
+        if seek < 0:
+            return True
+        i += 12 + add_len + extra_len
+    return False
+
+
+def main() -> int:
+    out_dir = sys.argv[1] if len(sys.argv) > 1 else "."
+    os.makedirs(out_dir, exist_ok=True)
+    rng = random.Random(20251120)
+    manifest = []
+
+    def put(name: str, ext: str, data: bytes):
+        with open(os.path.join(out_dir, name + ext), "wb") as f:
+            f.write(data)
+
+    # ---------- LZ4 ----------
+    image = fake_image(rng, 24 * 1024, 0x08008000)
+    lz4_cases = {
+        "lz4_empty":      b"",
+        "lz4_tiny":       b"A",
+        "lz4_short":      b"0123456789AB",                      # 短于最小匹配的尾部限制，只有字面量
+        "lz4_zeros":      bytes(20000),                          # 长匹配、长度字段多次 255 续写
+        "lz4_random":     bytes(rng.randrange(256) for _ in range(9000)),   # 几乎全是字面量
+        "lz4_text":       b"IAP bootloader stream test. " * 700,
+        "lz4_image":      image,
+        "lz4_far_match":  (bytes(rng.randrange(256) for _ in range(4090)) * 3)[:12000],  # 距离接近窗口上限
+    }
+    bin_dir = sys.argv[2] if len(sys.argv) > 2 else ""
+    if bin_dir:
+        found = False
+        for fname in ("app.bin", "app_b.bin"):
+            path = os.path.join(bin_dir, fname)
+            if os.path.isfile(path):
+                with open(path, "rb") as f:
+                    lz4_cases["lz4_bin_" + fname[:-4]] = f.read()
+                found = True
+        if not found:
+            print(f"[!!] {bin_dir} 下没有 app.bin / app_b.bin，只用合成数据")
+
+    for name, raw in lz4_cases.items():
+        stream = lz4_compress(raw)
+        if lz4_decompress(stream, len(raw)) != raw:
+            print(f"[ERR] {name}: Python 自身解压核对失败")
+            return 1
+        if name.startswith("lz4_bin_"):
+            print(f"[OK ] {name}: {len(raw)} -> {len(stream)} 字节，压缩后为原来的 {len(stream) * 100 / len(raw):.1f}%")
+        put(name, ".raw", raw)
+        put(name, ".lz4", stream)
+        manifest.append(f"lz4 {name}")
+
+    # ---------- 差分 ----------
+    old = fake_image(rng, 20 * 1024, 0x08008000)
+    tweak = bytearray(old)
+    for p in rng.sample(range(len(tweak)), 40):
+        tweak[p] ^= 0x5A
+    half = len(old) // 2
+    delta_cases = {
+        "delta_same":     (old, old),
+        "delta_tweak":    (old, bytes(tweak)),
+        "delta_insert":   (old, old[:5000] + bytes(rng.randrange(256) for _ in range(333)) + old[5000:]),
+        "delta_shrink":   (old, old[:7000] + old[9000:]),
+        "delta_swap":     (old, old[half:] + old[:half]),          # 后半段搬到前面：基线位置要往回跳
+        "delta_relink":   (old, relink(old, 0x08008000, 0x08020000, 0x18000)),
+        "delta_grow":     (old[:4096], old + bytes(range(256)) * 8),
+    }
+    negative = False
+    for name, (base, new) in delta_cases.items():
+        patch = delta_diff(base, new)
+        if delta_apply(base, patch) != new:
+            print(f"[ERR] {name}: Python 自身打补丁核对失败")
+            return 1
+        negative |= has_negative_seek(patch)
+        put(name, ".old", base)
+        put(name, ".new", new)
+        put(name, ".patch", patch)
+        put(name, ".patch.lz4", lz4_compress(patch))
+        manifest.append(f"delta {name}")
+    if not negative:
+        print("[ERR] 没有一个补丁用到负的 seek，测试覆盖不到基线回跳")
+        return 1
+
+    with open(os.path.join(out_dir, "vectors.txt"), "w") as f:
+        f.write("\n".join(manifest) + "\n")
+    print(f"[OK ] {len(manifest)} 组向量写入 {out_dir}")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,32 @@
+#ifndef __CMSIS_OS_HOST_H
+#define __CMSIS_OS_HOST_H
+
+/*
+ * 主机测试用的 CMSIS-RTOS2 替身：只声明 comm_proto.c 用到的接口，由测试按模拟时间实现
+ */
+
+#include <stdint.h>
+
+typedef void *osSemaphoreId_t;
+typedef void *osThreadId_t;
+typedef struct { const char *name; } osSemaphoreAttr_t;
+
+typedef enum {
+    osOK             =  0,
+    osError          = -1,
+    osErrorTimeout   = -2,
+    osErrorResource  = -3
+} osStatus_t;
+
+#define osWaitForever  0xFFFFFFFFU
+
+osSemaphoreId_t osSemaphoreNew(uint32_t max_count, uint32_t initial_count, const osSemaphoreAttr_t *attr);
+osStatus_t      osSemaphoreAcquire(osSemaphoreId_t semaphore_id, uint32_t timeout);
+osStatus_t      osSemaphoreRelease(osSemaphoreId_t semaphore_id);
+uint32_t        osKernelGetTickCount(void);
+uint32_t        osKernelGetTickFreq(void);
+osStatus_t      osDelay(uint32_t ticks);
+osThreadId_t    osThreadGetId(void);
+uint32_t        osThreadGetStackSpace(osThreadId_t thread_id);
+
+#endif /* __CMSIS_OS_HOST_H */
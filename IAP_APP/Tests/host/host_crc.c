@@ -0,0 +1,34 @@
+/*
+ * 主机测试的 CRC 单元模型（STM32F4）：
+ *   - 写 CR.RESET：DR 复位为 0xFFFFFFFF；
+ *   - 写 DR：以当前 DR 为余数，把写入的32位字按 MSB-first、多项式 0x04C11DB7 并入，结果留在 DR；
+ *   - 没有输入/输出反转，也不能写初值，与 F4 硬件一致
+ */
+
+#include "stm32f4xx_hal.h"
+
+CRC_TypeDef host_crc = { 0xFFFFFFFFUL, 0U, 0U, 0U, 0U };
+uint32_t    host_crc_words = 0U;
+
+void Host_WriteReg(volatile uint32_t *reg, uint32_t val)
+{
+    if (reg == &host_crc.CR)
+    {
+        if (val & CRC_CR_RESET) host_crc.DR = 0xFFFFFFFFUL;   // RESET 位写1后硬件自动清零
+        return;
+    }
+
+    if (reg == &host_crc.DR)
+    {
+        uint32_t c = host_crc.DR ^ val;
+        for (uint32_t i = 0; i < 32U; i++)
+        {
+            c = (c & 0x80000000UL) ? ((c << 1) ^ 0x04C11DB7UL) : (c << 1);
+        }
+        host_crc.DR = c;
+        host_crc_words++;
+        return;
+    }
+
+    *reg = val;
+}
@@ -0,0 +1,105 @@
+/*
+ * 主机测试的 Flash 控制器模型：
+ *   - 寄存器访问都经过 Host_FlashRegs()，置 STRT 后的下一次访问按 SNB 擦除扇区并置 BSY；
+ *   - BSY 期间每次轮询推进 host_flash_poll_ns，并调用 host_flash_wait_hook 让测试在“擦除中”运行中断；
+ *   - 编程直接写映射的内存，不计耗时
+ */
+
+#include "stm32f4xx_hal.h"
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#define HOST_HAVE_MMAP 1
+#endif
+
+#define HOST_FLASH_BASE   0x08000000UL
+#define HOST_FLASH_SIZE   0x00080000UL
+
+uint64_t host_flash_erase_ns = 1000000000ULL;
+uint64_t host_flash_poll_ns  = 5000ULL;
+uint32_t host_flash_erases   = 0U;
+void   (*host_flash_wait_hook)(uint64_t ns) = NULL;
+
+SCB_Type       host_scb;
+DWT_Type       host_dwt;
+CoreDebug_Type host_coredebug;
+
+static FLASH_TypeDef host_flash;
+static uint64_t      host_erase_left = 0U;   /*!< 本次擦除还剩的模拟时间 */
+static uint8_t       host_mapped     = 0U;
+
+static const uint32_t host_sector_start[9] = {
+    0x08000000UL, 0x08004000UL, 0x08008000UL, 0x0800C000UL,
+    0x08010000UL, 0x08020000UL, 0x08040000UL, 0x08060000UL,
+    0x08080000UL
+};
+
+int Host_FlashMap(void)
+{
+#ifndef HOST_HAVE_MMAP
+    return -1;
+#else
+    if (!host_mapped)
+    {
+#ifdef MAP_FIXED_NOREPLACE
+        void *p = mmap((void *)HOST_FLASH_BASE, HOST_FLASH_SIZE, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+#else
+        void *p = mmap((void *)HOST_FLASH_BASE, HOST_FLASH_SIZE, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+#endif
+        if (p != (void *)HOST_FLASH_BASE)
+        {
+            if (p != MAP_FAILED) munmap(p, HOST_FLASH_SIZE);
+            return -1;
+        }
+        host_mapped = 1U;
+    }
+    memset((void *)HOST_FLASH_BASE, 0xFF, HOST_FLASH_SIZE);
+    return 0;
+#endif
+}
+
+uint64_t Host_FlashFinish(void)
+{
+    uint64_t left = host_erase_left;
+    host_erase_left = 0U;
+    return left;
+}
+
+FLASH_TypeDef *Host_FlashRegs(void)
+{
+    if (host_flash.CR & FLASH_CR_STRT)
+    {
+        uint32_t sector = (host_flash.CR & FLASH_CR_SNB) >> FLASH_CR_SNB_Pos;
+
+        host_flash.CR &= ~FLASH_CR_STRT;
+        if ((host_flash.CR & FLASH_CR_SER) && sector < 8U)
+        {
+            if (host_mapped)
+            {
+                memset((void *)(uintptr_t)host_sector_start[sector], 0xFF,
+                       host_sector_start[sector + 1U] - host_sector_start[sector]);
+            }
+            host_erase_left = host_flash_erase_ns;
+            host_flash.SR  |= FLASH_SR_BSY;
+        }
+        else
+        {
+            host_flash.SR |= FLASH_FLAG_OPERR;
+        }
+    }
+    else if (host_flash.SR & FLASH_SR_BSY)
+    {
+        uint64_t step = (host_erase_left < host_flash_poll_ns) ? host_erase_left : host_flash_poll_ns;
+
+        host_erase_left -= step;
+        if (host_flash_wait_hook != NULL && step != 0U) host_flash_wait_hook(step);
+        if (host_erase_left == 0U)
+        {
+            host_flash.SR &= ~FLASH_SR_BSY;
+            host_flash.SR |= FLASH_FLAG_EOP;
+            host_flash_erases++;
+        }
+    }
+    return &host_flash;
+}
@@ -0,0 +1,164 @@
+#ifndef __STM32F4xx_HAL_HOST_H
+#define __STM32F4xx_HAL_HOST_H
+
+/*
+ * 主机测试用的最小 HAL 替身：只给出 FlashCV、Lz4Stream、DeltaPatch、comm_proto 编译所需的类型和宏。
+ * 内核指令为空操作；Flash 寄存器由 host_flash.c 模拟（擦除耗时、BSY 轮询），CRC 单元由 host_crc.c 模拟，
+ * 调用 Host_FlashMap() 后 0x08000000 起的 512KB 是可读写的内存，擦写函数可以直接运行。
+ * UART 函数只有声明，由用到的测试自己实现
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+typedef enum {
+    HAL_OK      = 0x00U,
+    HAL_ERROR   = 0x01U,
+    HAL_BUSY    = 0x02U,
+    HAL_TIMEOUT = 0x03U
+} HAL_StatusTypeDef;
+
+/********* 内核与中断 *********/
+#define __NVIC_PRIO_BITS           4U
+#define FPU_IRQn                   81
+
+typedef struct { volatile uint32_t VTOR; } SCB_Type;
+extern SCB_Type host_scb;                           /*!< host_flash.c */
+#define SCB                        (&host_scb)
+
+/* DWT 周期计数器：主机上不计数，CYCCNT 保持测试写入的值 */
+typedef struct { volatile uint32_t CTRL, CYCCNT; } DWT_Type;
+typedef struct { volatile uint32_t DEMCR; } CoreDebug_Type;
+extern DWT_Type       host_dwt;                     /*!< host_flash.c */
+extern CoreDebug_Type host_coredebug;               /*!< host_flash.c */
+#define DWT                        (&host_dwt)
+#define CoreDebug                  (&host_coredebug)
+#define DWT_CTRL_CYCCNTENA_Msk     (1UL << 0)
+#define CoreDebug_DEMCR_TRCENA_Msk (1UL << 24)
+
+static inline void     __DMB(void) { }
+static inline void     __DSB(void) { }
+static inline void     __ISB(void) { }
+static inline void     __disable_irq(void) { }
+static inline uint32_t __get_PRIMASK(void) { return 0U; }
+static inline void     __set_PRIMASK(uint32_t v) { (void)v; }
+static inline uint32_t __get_BASEPRI(void) { return 0U; }
+static inline void     __set_BASEPRI(uint32_t v) { (void)v; }
+static inline void     __set_BASEPRI_MAX(uint32_t v) { (void)v; }
+static inline uint32_t __UNALIGNED_UINT32_READ(const void *p) { uint32_t v; memcpy(&v, p, 4); return v; }
+static inline uint32_t __RBIT(uint32_t v)
+{
+    uint32_t r = 0U;
+    for (uint32_t i = 0; i < 32U; i++) { r = (r << 1) | (v & 1U); v >>= 1; }
+    return r;
+}
+
+static inline void     NVIC_SystemReset(void) { __builtin_trap(); }
+
+#define SRAM1_BASE                 0x20000000UL
+#define BKPSRAM_BASE               0x40024000UL
+
+/********* 寄存器读写：写操作经过 Host_WriteReg，由它模拟有副作用的寄存器（CRC单元） *********/
+void Host_WriteReg(volatile uint32_t *reg, uint32_t val);
+#define WRITE_REG(REG, VAL)        Host_WriteReg(&(REG), (VAL))
+#define READ_REG(REG)              ((REG))
+
+/********* CRC 单元（host_crc.c）：MSB-first 0x04C11DB7，复位值 0xFFFFFFFF，按字计算 *********/
+typedef struct {
+    volatile uint32_t DR;
+    volatile uint8_t  IDR;
+    uint8_t           RESERVED0;
+    uint16_t          RESERVED1;
+    volatile uint32_t CR;
+} CRC_TypeDef;
+extern CRC_TypeDef host_crc;
+extern uint32_t    host_crc_words;                  /*!< 写入 DR 的字数，测试用它确认走了硬件路径 */
+#define CRC                        (&host_crc)
+#define CRC_CR_RESET               (1UL << 0)
+#define __HAL_RCC_CRC_CLK_ENABLE() do { } while (0)
+
+/********* Flash 接口 *********/
+typedef struct { volatile uint32_t ACR, KEYR, OPTKEYR, SR, CR, OPTCR; } FLASH_TypeDef;
+
+/* 每次访问 FLASH 寄存器都经过模型：置 STRT 后的下一次访问开始擦除，擦除期间每次轮询推进模拟时间 */
+FLASH_TypeDef *Host_FlashRegs(void);
+#define FLASH                      (Host_FlashRegs())
+
+#define FLASH_SR_BSY               (1UL << 16)
+#define FLASH_CR_PG                (1UL << 0)
+#define FLASH_CR_SER               (1UL << 1)
+#define FLASH_CR_SNB_Pos           3U
+#define FLASH_CR_SNB               (0x1FUL << FLASH_CR_SNB_Pos)
+#define FLASH_CR_STRT              (1UL << 16)
+#define FLASH_ACR_ICEN             (1UL << 9)
+#define FLASH_ACR_DCEN             (1UL << 10)
+#define FLASH_PSIZE_WORD           (2UL << 8)
+#define CR_PSIZE_MASK              0xFFFFFCFFUL
+#define FLASH_FLAG_EOP             (1UL << 0)
+#define FLASH_FLAG_OPERR           (1UL << 1)
+#define FLASH_FLAG_WRPERR          (1UL << 4)
+#define FLASH_FLAG_PGAERR          (1UL << 5)
+#define FLASH_FLAG_PGPERR          (1UL << 6)
+#define FLASH_FLAG_PGSERR          (1UL << 7)
+#define FLASH_SECTOR_6             6U
+
+#define __HAL_FLASH_CLEAR_FLAG(f)                 (FLASH->SR &= ~(f))
+#define __HAL_FLASH_INSTRUCTION_CACHE_DISABLE()   (FLASH->ACR &= ~FLASH_ACR_ICEN)
+#define __HAL_FLASH_INSTRUCTION_CACHE_ENABLE()    (FLASH->ACR |= FLASH_ACR_ICEN)
+#define __HAL_FLASH_INSTRUCTION_CACHE_RESET()     do { } while (0)
+#define __HAL_FLASH_DATA_CACHE_DISABLE()          (FLASH->ACR &= ~FLASH_ACR_DCEN)
+#define __HAL_FLASH_DATA_CACHE_ENABLE()           (FLASH->ACR |= FLASH_ACR_DCEN)
+#define __HAL_FLASH_DATA_CACHE_RESET()            do { } while (0)
+
+static inline HAL_StatusTypeDef HAL_FLASH_Unlock(void) { return HAL_OK; }
+static inline HAL_StatusTypeDef HAL_FLASH_Lock(void) { return HAL_OK; }
+
+/********* Flash 模型（host_flash.c） *********/
+extern uint64_t host_flash_erase_ns;                /*!< 一次扇区擦除的模拟耗时 */
+extern uint64_t host_flash_poll_ns;                 /*!< 擦除期间每次轮询 SR 推进的模拟时间 */
+extern uint32_t host_flash_erases;                  /*!< 已完成的扇区擦除次数 */
+extern void   (*host_flash_wait_hook)(uint64_t ns); /*!< 擦除期间推进模拟时间（测试在这里运行“中断”） */
+
+/**
+ * @brief 在 0x08000000 映射 512KB 可读写内存并填 0xFF，模拟的擦除会清空对应扇区
+ * @return 0：成功；-1：地址已被占用或系统不支持
+ */
+int Host_FlashMap(void);
+
+/**
+ * @brief 立即结束正在进行的擦除
+ * @return 擦除还剩的模拟时间（ns），没有擦除时为0
+ */
+uint64_t Host_FlashFinish(void);
+
+/********* UART（测试实现） *********/
+typedef struct { volatile uint32_t SR, DR, BRR, CR1, CR2, CR3, GTPR; } USART_TypeDef;
+extern USART_TypeDef host_usart1;
+#define USART1                     (&host_usart1)
+
+#define HAL_UART_STATE_READY       0x20U
+#define HAL_UART_ERROR_ORE         0x08U
+
+typedef struct { uint32_t BaudRate; } UART_InitTypeDef;
+
+typedef struct {
+    USART_TypeDef     *Instance;
+    UART_InitTypeDef   Init;
+    volatile uint32_t  gState;
+    volatile uint32_t  RxState;
+    volatile uint32_t  ErrorCode;
+} UART_HandleTypeDef;
+
+HAL_StatusTypeDef HAL_UART_Init(UART_HandleTypeDef *huart);
+HAL_StatusTypeDef HAL_UART_AbortReceive(UART_HandleTypeDef *huart);
+HAL_StatusTypeDef HAL_UART_Receive_IT(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef *huart, const uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef HAL_UARTEx_ReceiveToIdle_DMA(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size);
+uint32_t HAL_RCC_GetPCLK2Freq(void);
+
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart);
+void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart);
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart);
+void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef *huart, uint16_t Size);
+
+#endif /* __STM32F4xx_HAL_HOST_H */
@@ -0,0 +1,512 @@
+/*
+ * 通信层主机测试：Flash 擦除期间不丢帧。
+ * 上位机模型以窗口模式发送整个镜像，设备端在传输中途擦除一个 128KB 扇区（模拟耗时 1.5s），
+ * 擦除分别发生在：
+ *   - 空闲处理里（后台预擦除、元数据日志换扇区），通信任务不在 Comm_Process 中；
+ *   - DATA 帧处理里（Update_ReceiveChunk 内），通信任务正在处理队列。
+ * 擦除期间 UART 中断照常运行、组帧入队；中断里若调用 RTOS 接口（代码在 Flash 中）会卡到擦除结束，
+ * 这段时间 DMA 继续写环形缓冲区，未解析的数据被覆盖。
+ * 要求：传输完成且数据一致，CommStats_t 的丢帧、CRC错误、溢出都为0，DMA 缓冲区没有被覆盖，
+ * 中断没有卡在 Flash 上，且擦除期间确实收到了若干帧
+ */
+
+#include "comm_proto.h"
+#include "update_manager.h"
+#include "BootMailbox.h"
+#include "cmsis_os.h"
+#include "test_util.h"
+
+#define IMAGE_SIZE      (48U * 1024U)
+#define HOST_WINDOW     7U
+#define HOST_CHUNK      768U
+#define ERASE_AT        (12U * 1024U)                    // 收到这么多数据后擦除
+#define ERASE_NS        1500000000ULL                    // 128KB 扇区擦除 1~2s
+#define SIM_LIMIT_NS    (30ULL * 1000000000ULL)          // 模拟时间上限，超过即判失败
+#define H2D_BUF_LEN     (16U * 1024U)
+
+typedef enum {
+    ERASE_IN_IDLE = 0,      /*!< Update_ProcessInIdle 中擦除 */
+    ERASE_IN_CHUNK          /*!< Update_ReceiveChunk 中擦除 */
+} EraseWhere_t;
+
+typedef enum {
+    HOST_HANDSHAKE = 0,
+    HOST_START,
+    HOST_DATA,
+    HOST_END,
+    HOST_DONE
+} HostPhase_t;
+
+/********* 模拟时间 *********/
+static uint64_t now_ns;
+static uint64_t byte_ns;            /*!< 一个字节（10位）在线路上的时间 */
+
+/********* 上位机 -> 设备线路 *********/
+static uint8_t  h2d_buf[H2D_BUF_LEN];
+static uint32_t h2d_head, h2d_tail;
+static uint64_t h2d_next_ns;        /*!< 下一个字节收完的时刻 */
+static uint64_t idle_at_ns;
+static uint8_t  idle_armed;
+
+/********* 接收DMA（循环模式） *********/
+static uint8_t *dma_buf;
+static uint16_t dma_len;
+static uint32_t dma_written;        /*!< DMA 写入的总字节数 */
+static uint32_t dma_consumed;       /*!< 已交给接收回调的总字节数 */
+static uint32_t dma_lost;           /*!< 未解析就被覆盖的字节数 */
+static uint8_t  rx_evt_pending;
+
+/********* 发送DMA *********/
+static const uint8_t *tx_ptr;
+static uint16_t tx_n;
+static uint64_t tx_end_ns;
+static uint8_t  tx_active, tx_done_pending;
+
+/********* 中断与信号量 *********/
+static uint8_t  in_isr;
+static uint32_t isr_stalls;         /*!< 中断在擦写期间调用RTOS接口的次数 */
+static int      sem_count;
+
+/********* 上位机 *********/
+static uint8_t     image[IMAGE_SIZE];
+static uint8_t     host_rx[4096];
+static uint32_t    host_rx_len;
+static HostPhase_t host_phase;
+static uint8_t     host_sent;
+static uint8_t     host_seq;
+static uint8_t     host_window;
+static uint16_t    host_chunk;
+static uint32_t    host_next, host_acked, host_nacks;
+
+/********* 设备端升级管理器替身 *********/
+static EraseWhere_t  erase_where;
+static UpdateState_t upd_state;
+static uint8_t       received[IMAGE_SIZE];
+static uint32_t      received_bytes;
+static uint8_t       erased;
+static uint32_t      frames_during_erase;
+
+USART_TypeDef      host_usart1;
+UART_HandleTypeDef huart1 = { .Instance = USART1 };
+
+static void Line_Advance(uint64_t ns);
+
+/* 参考 CRC32（与 zlib.crc32 一致），上位机组帧、验帧用 */
+static uint32_t RefCrc(uint32_t crc, const uint8_t *p, uint32_t len)
+{
+    crc = ~crc;
+    for (uint32_t i = 0; i < len; i++)
+    {
+        crc ^= p[i];
+        for (int b = 0; b < 8; b++) crc = (crc >> 1) ^ (0xEDB88320UL & (0U - (crc & 1U)));
+    }
+    return ~crc;
+}
+
+/* ======================= 上位机模型 ======================= */
+
+static void Host_Send(uint8_t cmd, const uint8_t *data, uint16_t len)
+{
+    uint8_t hdr[6] = { COMM_HEAD1, COMM_HEAD2, cmd, host_seq++, (uint8_t)len, (uint8_t)(len >> 8) };
+    uint32_t crc = RefCrc(RefCrc(0U, &hdr[2], 4U), data, len);
+
+    if (h2d_head == h2d_tail) {
+        h2d_head = h2d_tail = 0U;
+        h2d_next_ns = now_ns + byte_ns;
+    } else if (h2d_tail != 0U) {
+        memmove(h2d_buf, &h2d_buf[h2d_tail], h2d_head - h2d_tail);
+        h2d_head -= h2d_tail;
+        h2d_tail  = 0U;
+    }
+    if (h2d_head + sizeof(hdr) + len + 4U > H2D_BUF_LEN) {
+        CHECK(0, "上位机发送缓冲区溢出");
+        return;
+    }
+    memcpy(&h2d_buf[h2d_head], hdr, sizeof(hdr));
+    h2d_head += sizeof(hdr);
+    memcpy(&h2d_buf[h2d_head], data, len);
+    h2d_head += len;
+    memcpy(&h2d_buf[h2d_head], &crc, 4U);
+    h2d_head += 4U;
+}
+
+static void Host_OnFrame(uint8_t cmd, const uint8_t *data, uint16_t len)
+{
+    if (cmd == CMD_HANDSHAKE && host_phase == HOST_HANDSHAKE && len >= sizeof(CommCaps_t)) {
+        CommCaps_t caps;
+        memcpy(&caps, &data[len - sizeof(caps)], sizeof(caps));
+        CHECK(caps.flags & COMM_CAP_WINDOW, "设备没有同意窗口模式");
+        host_window = caps.window;
+        host_chunk  = caps.chunk;
+        host_phase  = HOST_START;
+        host_sent   = 0U;
+    } else if (cmd == CMD_ACK && host_phase == HOST_START && len >= 1U) {
+        CHECK(data[0] == COMM_STATUS_OK, "START 被拒绝：%u", data[0]);
+        host_phase = HOST_DATA;
+    } else if (cmd == CMD_ACK && host_phase == HOST_DATA && len == sizeof(CommWinAck_t)) {
+        CommWinAck_t ack;
+        memcpy(&ack, data, sizeof(ack));
+        if (ack.status != COMM_STATUS_OK) host_nacks++;
+        if (ack.ack_offset > host_acked) host_acked = ack.ack_offset;
+        if (host_acked >= IMAGE_SIZE) {
+            host_phase = HOST_END;
+            host_sent  = 0U;
+        }
+    } else if (cmd == CMD_ACK && host_phase == HOST_END && len >= 1U) {
+        CHECK(data[0] == COMM_STATUS_OK, "END 被拒绝：%u", data[0]);
+        host_phase = HOST_DONE;
+    }
+}
+
+/* 上位机收到设备发来的字节：按帧格式拆帧、验CRC */
+static void Host_OnBytes(const uint8_t *p, uint16_t n)
+{
+    if (host_rx_len + n > sizeof(host_rx)) host_rx_len = 0U;
+    memcpy(&host_rx[host_rx_len], p, n);
+    host_rx_len += n;
+
+    for (;;) {
+        uint32_t i = 0U;
+        while (i + 1U < host_rx_len && !(host_rx[i] == COMM_HEAD1 && host_rx[i + 1U] == COMM_HEAD2)) i++;
+        memmove(host_rx, &host_rx[i], host_rx_len - i);
+        host_rx_len -= i;
+        if (host_rx_len < 6U) return;
+
+        uint16_t len = (uint16_t)(host_rx[4] | (host_rx[5] << 8));
+        if (host_rx_len < 10U + len) return;
+
+        uint32_t crc;
+        memcpy(&crc, &host_rx[6U + len], 4U);
+        CHECK(crc == RefCrc(0U, &host_rx[2], 4U + len), "设备发来的帧CRC错误");
+        Host_OnFrame(host_rx[2], &host_rx[6], len);
+        memmove(host_rx, &host_rx[10U + len], host_rx_len - 10U - len);
+        host_rx_len -= 10U + len;
+    }
+}
+
+/* 上位机发送：控制命令一问一答，DATA 帧在窗口内连续发送 */
+static void Host_Pump(void)
+{
+    switch (host_phase) {
+    case HOST_HANDSHAKE:
+        if (!host_sent) {
+            CommCaps_t caps = { COMM_CAPS_MAGIC, HOST_WINDOW, HOST_CHUNK, COMM_CAP_WINDOW };
+            Host_Send(CMD_HANDSHAKE, (const uint8_t *)&caps, sizeof(caps));
+            host_sent = 1U;
+        }
+        break;
+
+    case HOST_START:
+        if (!host_sent) {
+            uint32_t start[3] = { IMAGE_SIZE, RefCrc(0U, image, IMAGE_SIZE), 2U };
+            Host_Send(CMD_START_UPDATE, (const uint8_t *)start, sizeof(start));
+            host_sent = 1U;
+        }
+        break;
+
+    case HOST_DATA:
+        while (host_next < IMAGE_SIZE && host_next < host_acked + (uint32_t)host_window * host_chunk) {
+            uint8_t  frame[4U + COMM_MAX_PAYLOAD_LEN];
+            uint32_t n = IMAGE_SIZE - host_next;
+            if (n > host_chunk) n = host_chunk;
+            memcpy(frame, &host_next, 4U);
+            memcpy(&frame[4], &image[host_next], n);
+            Host_Send(CMD_DATA, frame, (uint16_t)(4U + n));
+            host_next += n;
+        }
+        break;
+
+    case HOST_END:
+        if (!host_sent) {
+            Host_Send(CMD_END_UPDATE, NULL, 0U);
+            host_sent = 1U;
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
+/* ======================= 线路与中断模型 ======================= */
+
+/* 一个字节收完：DMA 写入循环缓冲区，过半/写满时产生接收事件 */
+static void Line_RxByte(uint8_t b)
+{
+    if (dma_written - dma_consumed >= dma_len) dma_lost++;
+    dma_buf[dma_written % dma_len] = b;
+    dma_written++;
+
+    uint32_t pos = dma_written % dma_len;
+    if (pos == dma_len / 2U || pos == 0U) rx_evt_pending = 1U;
+    idle_armed = 1U;
+    idle_at_ns = now_ns + byte_ns;
+}
+
+/* 运行挂起的 USART/DMA 中断；中断不嵌套 */
+static void Isr_Run(void)
+{
+    if (in_isr) return;
+    in_isr = 1U;
+    while (rx_evt_pending || tx_done_pending) {
+        if (rx_evt_pending) {
+            uint16_t size = (uint16_t)(dma_written % dma_len);
+            if (size == 0U && dma_written != dma_consumed) size = dma_len;
+            rx_evt_pending = 0U;
+            dma_consumed   = dma_written;
+            HAL_UARTEx_RxEventCallback(&huart1, size);
+        }
+        if (tx_done_pending) {
+            tx_done_pending = 0U;
+            HAL_UART_TxCpltCallback(&huart1);
+        }
+    }
+    in_isr = 0U;
+}
+
+/* 推进模拟时间，按先后处理线路上的字节、空闲线、发送完成 */
+static void Line_Advance(uint64_t ns)
+{
+    uint64_t end = now_ns + ns;
+
+    for (;;) {
+        uint64_t t = end;
+        uint8_t  progress = 0U;
+
+        if (h2d_tail != h2d_head && h2d_next_ns < t) t = h2d_next_ns;
+        if (tx_active && tx_end_ns < t) t = tx_end_ns;
+        if (idle_armed && idle_at_ns < t) t = idle_at_ns;
+        if (t > now_ns) now_ns = t;
+
+        if (h2d_tail != h2d_head && h2d_next_ns <= now_ns) {
+            Line_RxByte(h2d_buf[h2d_tail++]);
+            h2d_next_ns += byte_ns;
+            progress = 1U;
+        }
+        if (tx_active && tx_end_ns <= now_ns) {
+            tx_active = 0U;
+            Host_OnBytes(tx_ptr, tx_n);
+            tx_done_pending = 1U;
+            progress = 1U;
+        }
+        if (idle_armed && idle_at_ns <= now_ns && h2d_tail == h2d_head) {
+            idle_armed = 0U;
+            rx_evt_pending = 1U;
+            progress = 1U;
+        }
+
+        Isr_Run();
+        Host_Pump();
+        if (!progress && now_ns >= end) break;
+    }
+}
+
+/* ======================= HAL / RTOS 替身 ======================= */
+
+HAL_StatusTypeDef HAL_UART_Init(UART_HandleTypeDef *huart) { (void)huart; return HAL_OK; }
+HAL_StatusTypeDef HAL_UART_AbortReceive(UART_HandleTypeDef *huart) { (void)huart; return HAL_OK; }
+uint32_t HAL_RCC_GetPCLK2Freq(void) { return 84000000U; }
+
+HAL_StatusTypeDef HAL_UART_Receive_IT(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size)
+{
+    (void)huart; (void)pData; (void)Size;
+    return HAL_ERROR;
+}
+
+HAL_StatusTypeDef HAL_UARTEx_ReceiveToIdle_DMA(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size)
+{
+    (void)huart;
+    dma_buf      = pData;
+    dma_len      = Size;
+    dma_written  = 0U;
+    dma_consumed = 0U;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef *huart, const uint8_t *pData, uint16_t Size)
+{
+    (void)huart;
+    if (tx_active) return HAL_BUSY;
+    tx_ptr    = pData;
+    tx_n      = Size;
+    tx_end_ns = now_ns + (uint64_t)Size * byte_ns;
+    tx_active = 1U;
+    return HAL_OK;
+}
+
+osSemaphoreId_t osSemaphoreNew(uint32_t max_count, uint32_t initial_count, const osSemaphoreAttr_t *attr)
+{
+    (void)max_count; (void)attr;
+    sem_count = (int)initial_count;
+    return &sem_count;
+}
+
+osStatus_t osSemaphoreRelease(osSemaphoreId_t semaphore_id)
+{
+    (void)semaphore_id;
+    if (FlashCV_IsBusy()) {
+        /* 内核代码在 Flash 中：中断卡到擦写结束，期间 DMA 照常写入，其他中断也得不到处理 */
+        isr_stalls++;
+        Line_Advance(Host_FlashFinish());
+    }
+    if (sem_count < 1) sem_count++;
+    return osOK;
+}
+
+osStatus_t osSemaphoreAcquire(osSemaphoreId_t semaphore_id, uint32_t timeout)
+{
+    uint64_t start = now_ns;
+
+    (void)semaphore_id;
+    while (sem_count == 0) {
+        if (now_ns - start >= (uint64_t)timeout * 1000000ULL || now_ns >= SIM_LIMIT_NS) return osErrorTimeout;
+        Line_Advance(byte_ns);
+    }
+    sem_count--;
+    return osOK;
+}
+
+uint32_t osKernelGetTickCount(void) { return (uint32_t)(now_ns / 1000000ULL); }
+uint32_t osKernelGetTickFreq(void) { return 1000U; }
+osStatus_t osDelay(uint32_t ticks) { Line_Advance((uint64_t)ticks * 1000000ULL); return osOK; }
+osThreadId_t osThreadGetId(void) { return NULL; }
+uint32_t osThreadGetStackSpace(osThreadId_t thread_id) { (void)thread_id; return 0U; }
+
+uint8_t BootMailbox_Read(BootMailbox_t *mb) { memset(mb, 0, sizeof(*mb)); return 0U; }
+
+/* ======================= 升级管理器替身 ======================= */
+
+/* 擦除元数据日志扇区（先写脏，FlashCV_EraseRange 跳过空白扇区），统计擦除期间收到的帧 */
+static void Test_EraseJournal(void)
+{
+    CommStats_t before, after;
+
+    *(volatile uint32_t *)FLASH_JOURNAL_ADDR = 0U;
+    Comm_GetStats(&before);
+    CHECK(FlashCV_EraseRange(FLASH_JOURNAL_ADDR, FLASH_JOURNAL_SIZE) == HAL_OK, "擦除失败");
+    Comm_GetStats(&after);
+    CHECK(FlashCV_IsBlank(FLASH_JOURNAL_ADDR, FLASH_JOURNAL_SIZE), "擦除后扇区不是空白");
+    frames_during_erase = after.rx_frames - before.rx_frames;
+    erased = 1U;
+}
+
+HAL_StatusTypeDef Update_Start(uint32_t total_size, uint32_t crc, uint32_t version,
+                               uint32_t encoding, uint32_t stream_size)
+{
+    (void)crc; (void)version; (void)encoding; (void)stream_size;
+    if (total_size != IMAGE_SIZE) return HAL_ERROR;
+    upd_state = UPDATE_RECEIVING;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef Update_ReceiveChunk(uint32_t offset, const uint8_t *data, uint16_t len)
+{
+    if (offset + len > IMAGE_SIZE) return HAL_ERROR;
+    memcpy(&received[offset], data, len);
+    received_bytes += len;
+    if (erase_where == ERASE_IN_CHUNK && offset == ERASE_AT) Test_EraseJournal();
+    return HAL_OK;
+}
+
+void Update_ProcessInIdle(void)
+{
+    if (erase_where == ERASE_IN_IDLE && !erased && received_bytes >= ERASE_AT) Test_EraseJournal();
+}
+
+HAL_StatusTypeDef Update_RequestFinish(void) { upd_state = UPDATE_IDLE; return HAL_OK; }
+UpdateState_t Update_GetState(void) { return upd_state; }
+uint32_t Update_GetTransferSize(void) { return IMAGE_SIZE; }
+uint32_t Update_GetResumeOffset(void) { return 0U; }
+uint32_t Update_GetMissing(uint32_t from, UpdateRange_t *ranges, uint32_t max, uint32_t *next)
+{
+    (void)from; (void)ranges; (void)max;
+    *next = 0U;
+    return 0U;
+}
+uint32_t Update_GetBlockCrcs(uint32_t first, uint32_t *crcs, uint32_t max, uint32_t *image_size)
+{
+    (void)first; (void)crcs; (void)max;
+    *image_size = 0U;
+    return 0U;
+}
+HAL_StatusTypeDef Update_CopyFromRunning(uint32_t offset, uint32_t len, const uint8_t *reloc) { (void)offset; (void)len; (void)reloc; return HAL_ERROR; }
+uint32_t Update_GetRunningSlot(void) { return 0U; }
+uint32_t Update_GetTargetSlot(void) { return 1U; }
+uint8_t Update_IsConfirmed(void) { return 1U; }
+uint8_t Update_CanRollback(void) { return 0U; }
+HAL_StatusTypeDef Update_Rollback(void) { return HAL_ERROR; }
+
+/* ======================= 用例 ======================= */
+
+static void Run(uint32_t baud, EraseWhere_t where)
+{
+    CommStats_t st;
+    int before = test_failures;
+
+    now_ns = 0U;
+    byte_ns = 10000000000ULL / baud;
+    h2d_head = h2d_tail = 0U;
+    idle_armed = rx_evt_pending = tx_active = tx_done_pending = in_isr = 0U;
+    dma_lost = isr_stalls = 0U;
+    sem_count = 0;
+    host_rx_len = 0U;
+    host_phase = HOST_HANDSHAKE;
+    host_sent = 0U;
+    host_seq = 0U;
+    host_next = host_acked = host_nacks = 0U;
+    erase_where = where;
+    upd_state = UPDATE_IDLE;
+    memset(received, 0, sizeof(received));
+    received_bytes = 0U;
+    erased = 0U;
+    frames_during_erase = 0U;
+
+    memset((void *)FLASH_BOOT_START_ADDR, 0xFF, 0x80000U);
+    host_flash_erases = 0U;
+    huart1.Init.BaudRate = baud;
+    Comm_Init();
+
+    /* 通信任务主循环，和 StartCommTask 一致 */
+    while (host_phase != HOST_DONE && now_ns < SIM_LIMIT_NS) {
+        Comm_Process(10);
+        Update_ProcessInIdle();
+    }
+    Comm_GetStats(&st);
+
+    const char *where_name = (where == ERASE_IN_IDLE) ? "空闲处理" : "DATA处理";
+    CHECK(host_phase == HOST_DONE, "%u bps/%s：传输没有完成（确认到 %u/%u）", baud, where_name, host_acked, IMAGE_SIZE);
+    CHECK(memcmp(received, image, IMAGE_SIZE) == 0, "%u bps/%s：收到的数据不一致", baud, where_name);
+    CHECK(erased && host_flash_erases == 1U, "%u bps/%s：没有执行擦除", baud, where_name);
+    CHECK(frames_during_erase >= 3U, "%u bps/%s：擦除期间只收到 %u 帧", baud, where_name, frames_during_erase);
+    CHECK(st.rx_dropped == 0U, "%u bps/%s：rx_dropped=%u", baud, where_name, st.rx_dropped);
+    CHECK(st.rx_crc_errors == 0U, "%u bps/%s：rx_crc_errors=%u", baud, where_name, st.rx_crc_errors);
+    CHECK(st.rx_overruns == 0U && st.rx_uart_errors == 0U, "%u bps/%s：UART错误 %u", baud, where_name, st.rx_uart_errors);
+    CHECK(dma_lost == 0U, "%u bps/%s：DMA缓冲区有 %u 字节未解析就被覆盖", baud, where_name, dma_lost);
+    CHECK(isr_stalls == 0U, "%u bps/%s：中断在擦写期间调用了 %u 次RTOS接口", baud, where_name, isr_stalls);
+    CHECK(host_nacks == 0U, "%u bps/%s：%u 个错误应答", baud, where_name, host_nacks);
+
+    printf("%s %7u bps，擦除在%s：用时 %.2fs，擦除期间收到 %u 帧，接收队列峰值 %u/%u，rx_overruns=%u\n",
+           (test_failures == before) ? "[OK ]" : "[FAIL]", baud, where_name, (double)now_ns / 1e9,
+           frames_during_erase, st.queue_peak, st.queue_size, st.rx_overruns);
+}
+
+int main(void)
+{
+    uint32_t seed = 0x5EEDF00DU;
+
+    if (Host_FlashMap() != 0) {
+        printf("[SKIP] 无法在 0x08000000 映射模拟Flash\n");
+        return 77;
+    }
+    host_flash_erase_ns  = ERASE_NS;
+    host_flash_wait_hook = Line_Advance;
+    for (uint32_t i = 0; i < IMAGE_SIZE; i++) image[i] = (uint8_t)Test_Rand(&seed);
+
+    Run(115200U, ERASE_IN_IDLE);
+    Run(115200U, ERASE_IN_CHUNK);
+    Run(921600U, ERASE_IN_IDLE);
+    Run(921600U, ERASE_IN_CHUNK);
+
+    printf("%s: %d 处失败\n", test_failures ? "[FAIL]" : "[OK ]", test_failures);
+    return test_failures ? 1 : 0;
+}
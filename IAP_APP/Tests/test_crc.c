@@ -0,0 +1,117 @@
+/*
+ * FlashCV CRC 主机测试：软件切片 CRC 与逐位计算的参考值比较（任意起始对齐和长度、分段累加），
+ * FlashCV_CrcCombine(CRC(A), CRC(B), len(B)) 必须等于 CRC(A||B)。
+ * 切片查表由 FlashCV_RamInit 生成，测试先让它从模拟Flash（0x08000000）搬一次向量表。
+ * FLASHCV_CRC_USE_HW=1 时长数据走 host_crc.c 模拟的 F4 CRC 单元，验证位反转和任意初值的换算
+ */
+
+#include "FlashCV.h"
+#include "test_util.h"
+
+#define DATA_SIZE   (70U * 1024U)
+
+static uint8_t g_data[DATA_SIZE + 16U];
+
+/* 逐位计算的参考 CRC32（反射多项式 0xEDB88320，与 zlib.crc32 一致） */
+static uint32_t RefCrc(const uint8_t *p, uint32_t len)
+{
+    uint32_t crc = 0xFFFFFFFFUL;
+    for (uint32_t i = 0; i < len; i++)
+    {
+        crc ^= p[i];
+        for (int b = 0; b < 8; b++) crc = (crc >> 1) ^ (0xEDB88320UL & (0U - (crc & 1U)));
+    }
+    return ~crc;
+}
+
+static uint32_t Crc(const uint8_t *p, uint32_t len)
+{
+    return FlashCV_CrcFinal(FlashCV_CrcUpdate(FlashCV_CrcInit(), p, len));
+}
+
+int main(void)
+{
+    uint32_t seed = 0x1234567U;
+
+    if (Host_FlashMap() != 0) {
+        printf("[SKIP] 无法在 0x08000000 映射模拟Flash\n");
+        return 77;
+    }
+    SCB->VTOR = FLASH_BOOT_START_ADDR;
+    FlashCV_RamInit();
+
+#if FLASHCV_CRC_USE_HW
+    /* 模型自检：复位后写入 0x12345678，F4 CRC 单元的 DR 为 0xDF8A8A2B */
+    WRITE_REG(CRC->CR, CRC_CR_RESET);
+    WRITE_REG(CRC->DR, 0x12345678UL);
+    CHECK(READ_REG(CRC->DR) == 0xDF8A8A2BUL, "CRC 单元模型自检失败：0x%08X", (unsigned)READ_REG(CRC->DR));
+    host_crc_words = 0U;
+#endif
+
+    for (uint32_t i = 0; i < sizeof(g_data); i++) g_data[i] = (uint8_t)Test_Rand(&seed);
+
+    /* 已知值："123456789" 的 CRC32 为 0xCBF43926 */
+    CHECK(Crc((const uint8_t *)"123456789", 9U) == 0xCBF43926UL, "\"123456789\" 的 CRC 不是 0xCBF43926");
+    CHECK(Crc(g_data, 0U) == 0U, "空数据的 CRC 不是 0");
+
+    /* 每种起始对齐 × 切片边界附近的长度 */
+    for (uint32_t align = 0; align < 8U; align++)
+    {
+        for (uint32_t len = 0; len <= 40U; len++)
+        {
+            CHECK(Crc(&g_data[align], len) == RefCrc(&g_data[align], len), "align=%u len=%u CRC 不一致", align, len);
+        }
+        CHECK(Crc(&g_data[align], DATA_SIZE) == RefCrc(&g_data[align], DATA_SIZE), "align=%u 长数据 CRC 不一致", align);
+    }
+
+    /* 随机分段累加与整段计算一致 */
+    uint32_t whole = RefCrc(g_data, DATA_SIZE);
+    for (uint32_t round = 0; round < 20U; round++)
+    {
+        uint32_t crc = FlashCV_CrcInit(), pos = 0;
+        while (pos < DATA_SIZE)
+        {
+            uint32_t n = 1U + Test_Rand(&seed) % (round < 10U ? 17U : 3000U);
+            if (n > DATA_SIZE - pos) n = DATA_SIZE - pos;
+            crc = FlashCV_CrcUpdate(crc, &g_data[pos], n);
+            pos += n;
+        }
+        CHECK(FlashCV_CrcFinal(crc) == whole, "第 %u 轮分段累加结果不一致", round);
+    }
+
+    /* CrcCombine：随机切点（含 0 长度的前段/后段、2 的幂附近的长度） */
+    static const uint32_t fixed[][2] = {
+        { 0U, 0U }, { 0U, 100U }, { 100U, 0U }, { 1U, 1U }, { 3U, 4096U }, { 1024U, 1024U },
+        { 5U, 65535U }, { 7U, 65536U }, { 1U, DATA_SIZE - 1U }, { DATA_SIZE - 1U, 1U },
+    };
+    for (uint32_t i = 0; i < sizeof(fixed) / sizeof(fixed[0]) + 200U; i++)
+    {
+        uint32_t a, b;
+        if (i < sizeof(fixed) / sizeof(fixed[0])) {
+            a = fixed[i][0];
+            b = fixed[i][1];
+        } else {
+            a = Test_Rand(&seed) % DATA_SIZE;
+            b = Test_Rand(&seed) % (DATA_SIZE - a + 1U);
+            if (i & 1U) b &= 0x3FFU;
+        }
+        uint32_t ca = Crc(g_data, a), cb = Crc(&g_data[a], b);
+        CHECK(FlashCV_CrcCombine(ca, cb, b) == RefCrc(g_data, a + b), "CrcCombine(len1=%u, len2=%u) 不一致", a, b);
+    }
+
+    /* 按 1KB 块合并出整段 CRC，和 update_manager 汇总块 CRC 的用法一致 */
+    uint32_t acc = 0U;
+    for (uint32_t pos = 0; pos < DATA_SIZE; pos += 1024U)
+    {
+        acc = FlashCV_CrcCombine(acc, Crc(&g_data[pos], 1024U), 1024U);
+    }
+    CHECK(acc == whole, "逐块合并的 CRC 与整段不一致");
+
+#if FLASHCV_CRC_USE_HW
+    CHECK(host_crc_words > 0U, "FLASHCV_CRC_USE_HW=1 但没有数据经过 CRC 单元");
+    printf("[INFO] CRC 单元处理了 %u 个字\n", (unsigned)host_crc_words);
+#endif
+
+    printf("%s: %d 处失败\n", test_failures ? "[FAIL]" : "[OK ]", test_failures);
+    return test_failures ? 1 : 0;
+}
@@ -0,0 +1,236 @@
+/*
+ * DeltaPatch 主机测试：用上位机 delta_diff 生成的补丁在基线上打补丁，结果必须等于新镜像。
+ * 覆盖未压缩补丁的各种切分、设备实际的 LZ4 -> DeltaPatch 串联、负的 seek、
+ * 在每个字段中间截断，以及补丁头不符、基线位置越界等错误
+ */
+
+#include "DeltaPatch.h"
+#include "Lz4Stream.h"
+#include "FlashCV.h"
+#include "test_util.h"
+
+static uint8_t *g_out;
+static uint32_t g_out_len;
+static uint32_t g_out_cap;
+static uint8_t  g_sink_gap;
+
+static DeltaPatch_t g_patch;
+static Lz4Stream_t  g_lz4;
+
+static HAL_StatusTypeDef Sink(uint32_t offset, const uint8_t *data, uint32_t len)
+{
+    if (offset != g_out_len || len == 0U || len > DELTA_OUT_BUF_SIZE) g_sink_gap = 1U;
+    if (offset + len > g_out_cap) return HAL_ERROR;
+    memcpy(&g_out[offset], data, len);
+    g_out_len = offset + len;
+    return HAL_OK;
+}
+
+/* 与 update_manager.c 一样：解压器的输出直接喂给补丁应用器 */
+static HAL_StatusTypeDef Lz4ToPatch(uint32_t offset, const uint8_t *data, uint32_t len)
+{
+    (void)offset;
+    return DeltaPatch_Feed(&g_patch, data, len);
+}
+
+static uint32_t Crc(const uint8_t *data, uint32_t len)
+{
+    return FlashCV_CrcFinal(FlashCV_CrcUpdate(FlashCV_CrcInit(), data, len));
+}
+
+static uint32_t NextChunk(uint32_t left, uint32_t max_chunk, uint32_t *seed)
+{
+    if (max_chunk == 1U) return 1U;
+    if (max_chunk > 1U) {
+        uint32_t r = 1U + Test_Rand(seed) % max_chunk;
+        if (r < left) return r;
+    }
+    return left;
+}
+
+static void Reset(const uint8_t *base, uint32_t base_len, uint32_t new_len)
+{
+    g_out_len  = 0U;
+    g_sink_gap = 0U;
+    DeltaPatch_Init(&g_patch, base, base_len, Crc(base, base_len), new_len, Sink);
+}
+
+/**
+ * @brief 喂入补丁的前 len 字节；lz 为 1 时输入是 LZ4 压缩后的补丁
+ */
+static HAL_StatusTypeDef Apply(const uint8_t *in, uint32_t len, uint8_t lz, uint32_t patch_len,
+                               uint32_t max_chunk, uint32_t seed)
+{
+    uint32_t pos = 0;
+
+    if (lz) Lz4Stream_Init(&g_lz4, patch_len, Lz4ToPatch);
+    while (pos < len)
+    {
+        uint32_t n = NextChunk(len - pos, max_chunk, &seed);
+        HAL_StatusTypeDef st = lz ? Lz4Stream_Feed(&g_lz4, &in[pos], n) : DeltaPatch_Feed(&g_patch, &in[pos], n);
+        if (st != HAL_OK) return HAL_ERROR;
+        pos += n;
+    }
+    return HAL_OK;
+}
+
+/* 统计补丁里负的 seek 数量，并记录每条记录各字段的起始位置，供截断测试使用 */
+static uint32_t ScanRecords(const uint8_t *patch, uint32_t len, uint32_t *cuts, uint32_t max_cuts, uint32_t *n_cuts)
+{
+    uint32_t pos = 16U, negative = 0U;
+
+    *n_cuts = 0U;
+    while (pos + 12U <= len)
+    {
+        uint32_t add, extra;
+        int32_t  seek;
+        memcpy(&add, &patch[pos], 4);
+        memcpy(&extra, &patch[pos + 4U], 4);
+        memcpy(&seek, &patch[pos + 8U], 4);
+        if (seek < 0) negative++;
+
+        /* 控制字段中间、差值字节中间、新字节中间各取一个截断点 */
+        uint32_t pts[3] = { pos + 5U, pos + 12U + add / 2U, pos + 12U + add + extra / 2U };
+        for (uint32_t i = 0; i < 3U && *n_cuts < max_cuts; i++) cuts[(*n_cuts)++] = pts[i];
+        pos += 12U + add + extra;
+    }
+    return negative;
+}
+
+static void RunCase(const char *dir, const char *name)
+{
+    static const uint32_t chunks[] = { 0U, 1U, 3U, 13U, 200U, 4096U };
+    char file[256];
+    uint32_t old_len = 0, new_len = 0, patch_len = 0, lz_len = 0;
+    uint32_t cuts[256], n_cuts = 0;
+
+    snprintf(file, sizeof(file), "%s.old", name);
+    uint8_t *old = Test_LoadFile(dir, file, &old_len);
+    snprintf(file, sizeof(file), "%s.new", name);
+    uint8_t *new_img = Test_LoadFile(dir, file, &new_len);
+    snprintf(file, sizeof(file), "%s.patch", name);
+    uint8_t *patch = Test_LoadFile(dir, file, &patch_len);
+    snprintf(file, sizeof(file), "%s.patch.lz4", name);
+    uint8_t *lz = Test_LoadFile(dir, file, &lz_len);
+    if (old == NULL || new_img == NULL || patch == NULL || lz == NULL) goto done;
+
+    g_out_cap = new_len + 1U;
+    g_out = malloc(g_out_cap);
+
+    /* 未压缩补丁与 LZ4 压缩补丁，各种切分方式 */
+    for (uint8_t use_lz = 0; use_lz <= 1U; use_lz++)
+    {
+        for (uint32_t c = 0; c < sizeof(chunks) / sizeof(chunks[0]); c++)
+        {
+            for (uint32_t seed = 1; seed <= (chunks[c] > 1U ? 3U : 1U); seed++)
+            {
+                Reset(old, old_len, new_len);
+                HAL_StatusTypeDef st = Apply(use_lz ? lz : patch, use_lz ? lz_len : patch_len, use_lz, patch_len,
+                                             chunks[c], seed * 0x9E3779B9U);
+                CHECK(st == HAL_OK, "%s: lz=%u chunk=%u seed=%u 打补丁失败", name, use_lz, chunks[c], seed);
+                CHECK(g_out_len == new_len && memcmp(g_out, new_img, new_len) == 0,
+                      "%s: lz=%u chunk=%u seed=%u 结果不一致（%u/%u 字节）", name, use_lz, chunks[c], seed,
+                      g_out_len, new_len);
+                CHECK(DeltaPatch_Done(&g_patch), "%s: lz=%u chunk=%u 结束时 Done=0", name, use_lz, chunks[c]);
+                CHECK(!use_lz || Lz4Stream_Done(&g_lz4), "%s: chunk=%u 解压器没有结束", name, chunks[c]);
+                CHECK(!g_sink_gap, "%s: lz=%u chunk=%u 输出回调偏移不连续", name, use_lz, chunks[c]);
+            }
+        }
+    }
+
+    /* 截断在头部和各记录的控制字段、差值字节、新字节中间：不能算完成，已输出的是新镜像的前缀 */
+    uint32_t negative = ScanRecords(patch, patch_len, cuts, 250U, &n_cuts);
+    if (strcmp(name, "delta_swap") == 0) CHECK(negative > 0U, "%s: 补丁里没有负的 seek", name);
+    cuts[n_cuts++] = 7U;
+    cuts[n_cuts++] = patch_len - 1U;
+    for (uint32_t i = 0; i < n_cuts; i++)
+    {
+        if (cuts[i] >= patch_len) continue;
+        Reset(old, old_len, new_len);
+        HAL_StatusTypeDef st = Apply(patch, cuts[i], 0U, patch_len, 1U, 1U);
+        CHECK(st == HAL_OK, "%s: 截断在 %u 处时 Feed 报错", name, cuts[i]);
+        CHECK(!DeltaPatch_Done(&g_patch), "%s: 截断在 %u 处被当成完整的补丁", name, cuts[i]);
+        CHECK(g_out_len <= new_len && memcmp(g_out, new_img, g_out_len) == 0,
+              "%s: 截断在 %u 处时输出不是前缀", name, cuts[i]);
+    }
+
+    /* 补丁头与基线不符：基线CRC、基线大小、新镜像大小任一不同都拒绝，且不输出任何数据 */
+    g_out_len = 0U;
+    DeltaPatch_Init(&g_patch, old, old_len, Crc(old, old_len) ^ 1U, new_len, Sink);
+    CHECK(DeltaPatch_Feed(&g_patch, patch, patch_len) == HAL_ERROR && g_out_len == 0U, "%s: 基线CRC不符没有报错", name);
+    DeltaPatch_Init(&g_patch, old, old_len - 1U, Crc(old, old_len), new_len, Sink);
+    CHECK(DeltaPatch_Feed(&g_patch, patch, patch_len) == HAL_ERROR && g_out_len == 0U, "%s: 基线大小不符没有报错", name);
+    DeltaPatch_Init(&g_patch, old, old_len, Crc(old, old_len), new_len + 4U, Sink);
+    CHECK(DeltaPatch_Feed(&g_patch, patch, patch_len) == HAL_ERROR && g_out_len == 0U, "%s: 新镜像大小不符没有报错", name);
+    CHECK(DeltaPatch_Feed(&g_patch, patch, 1U) == HAL_ERROR, "%s: 出错后仍接受输入", name);
+
+    free(g_out);
+done:
+    free(old);
+    free(new_img);
+    free(patch);
+    free(lz);
+}
+
+/* 手工构造的补丁：seek 跳到基线开头之前或末尾之后，下一条记录读基线时必须报错 */
+static void RunBadSeek(void)
+{
+    static uint8_t base[64];
+    uint8_t out[64];
+    uint8_t p[16 + 12 + 1 + 12 + 1];
+    uint32_t hdr[4] = { DELTA_PATCH_MAGIC, sizeof(base), 0U, 2U };
+    uint32_t rec1[3] = { 1U, 0U, 0U };
+    uint32_t rec2[3] = { 1U, 0U, 0U };
+    int32_t  seeks[] = { -2, 63, 64 };   /* 第一条记录用掉 base[0]，之后 base_pos 为 1 */
+
+    for (uint32_t i = 0; i < sizeof(base); i++) base[i] = (uint8_t)(i * 7U);
+    hdr[2] = Crc(base, sizeof(base));
+    g_out = out;
+    g_out_cap = sizeof(out);
+
+    for (uint32_t k = 0; k < sizeof(seeks) / sizeof(seeks[0]); k++)
+    {
+        rec1[2] = (uint32_t)seeks[k];
+        memcpy(&p[0], hdr, 16);
+        memcpy(&p[16], rec1, 12);
+        p[28] = 1U;
+        memcpy(&p[29], rec2, 12);
+        p[41] = 1U;
+
+        Reset(base, sizeof(base), 2U);
+        HAL_StatusTypeDef st = Apply(p, sizeof(p), 0U, sizeof(p), 1U, 1U);
+        CHECK(st == HAL_ERROR, "seek=%d 越过基线范围没有报错", seeks[k]);
+        CHECK(!DeltaPatch_Done(&g_patch), "seek=%d 越界后 Done=1", seeks[k]);
+    }
+
+    /* 合法的负 seek：第一条记录读 base[0..3]，往回跳 3 字节后第二条记录再读 base[1] */
+    {
+        uint8_t q[16 + 12 + 4 + 12 + 1];
+        uint32_t h[4] = { DELTA_PATCH_MAGIC, sizeof(base), hdr[2], 5U };
+        uint32_t r1[3] = { 4U, 0U, (uint32_t)-3 };
+        uint32_t r2[3] = { 1U, 0U, 0U };
+        memcpy(&q[0], h, 16);
+        memcpy(&q[16], r1, 12);
+        memset(&q[28], 0, 4);
+        memcpy(&q[32], r2, 12);
+        q[44] = 0x10U;
+
+        Reset(base, sizeof(base), 5U);
+        CHECK(Apply(q, sizeof(q), 0U, sizeof(q), 0U, 1U) == HAL_OK, "合法的负 seek 被拒绝");
+        CHECK(DeltaPatch_Done(&g_patch) && g_out_len == 5U && memcmp(out, base, 4) == 0 &&
+              out[4] == (uint8_t)(base[1] + 0x10U), "负 seek 之后读到的基线位置不对");
+    }
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        printf("用法: %s <向量目录>\n", argv[0]);
+        return 2;
+    }
+    int cases = Test_ForEachVector(argv[1], "delta", RunCase);
+    RunBadSeek();
+    CHECK(cases > 0, "没有找到 delta 用例");
+    printf("%s: %d 组用例，%d 处失败\n", test_failures ? "[FAIL]" : "[OK ]", cases, test_failures);
+    return test_failures ? 1 : 0;
+}
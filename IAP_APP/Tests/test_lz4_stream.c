@@ -0,0 +1,133 @@
+/*
+ * Lz4Stream 主机测试：把上位机 lz4_compress 生成的压缩流按整段、逐字节和随机长度切分喂给解压器，
+ * 解出的数据必须与原始数据一致；截断的流不能被当成完整的流，输出上限不足时必须报错
+ */
+
+#include "Lz4Stream.h"
+#include "test_util.h"
+
+static uint8_t *g_out;        /* 解压结果 */
+static uint32_t g_out_len;    /* 输出回调写到的末尾 */
+static uint32_t g_out_cap;
+static uint8_t  g_sink_gap;   /* 1: 输出回调收到的偏移不连续 */
+
+static HAL_StatusTypeDef Sink(uint32_t offset, const uint8_t *data, uint32_t len)
+{
+    if (offset != g_out_len || len == 0U || len > LZ4S_WINDOW_SIZE) g_sink_gap = 1U;
+    if (offset + len > g_out_cap) return HAL_ERROR;
+    memcpy(&g_out[offset], data, len);
+    g_out_len = offset + len;
+    return HAL_OK;
+}
+
+/**
+ * @brief 按 max_chunk 随机切分（max_chunk 为 0 时整段、为 1 时逐字节）喂入前 len 字节
+ * @return 所有 Feed 都返回 HAL_OK 时为 HAL_OK
+ */
+static HAL_StatusTypeDef Decode(Lz4Stream_t *s, const uint8_t *lz, uint32_t len, uint32_t limit,
+                                uint32_t max_chunk, uint32_t seed)
+{
+    uint32_t pos = 0;
+
+    g_out_len  = 0U;
+    g_sink_gap = 0U;
+    Lz4Stream_Init(s, limit, Sink);
+    while (pos < len)
+    {
+        uint32_t n = len - pos;
+        if (max_chunk == 1U) {
+            n = 1U;
+        } else if (max_chunk > 1U) {
+            uint32_t r = 1U + Test_Rand(&seed) % max_chunk;
+            if (r < n) n = r;
+        }
+        if (Lz4Stream_Feed(s, &lz[pos], n) != HAL_OK) return HAL_ERROR;
+        pos += n;
+    }
+    return HAL_OK;
+}
+
+static void RunCase(const char *dir, const char *name)
+{
+    static Lz4Stream_t s;
+    static const uint32_t chunks[] = { 0U, 1U, 2U, 7U, 64U, 300U, 5000U };
+    char file[256];
+    uint32_t raw_len = 0, lz_len = 0;
+
+    snprintf(file, sizeof(file), "%s.raw", name);
+    uint8_t *raw = Test_LoadFile(dir, file, &raw_len);
+    snprintf(file, sizeof(file), "%s.lz4", name);
+    uint8_t *lz = Test_LoadFile(dir, file, &lz_len);
+    if (raw == NULL || lz == NULL) goto done;
+
+    g_out_cap = raw_len + 1U;
+    g_out = malloc(g_out_cap);
+    if (raw_len > 0U) {
+        printf("[INFO] %s: %u -> %u 字节 (%.1f%%)\n", name, raw_len, lz_len, lz_len * 100.0 / raw_len);
+    }
+
+    /* 各种切分方式：结果与原始数据一致，且解压器认为流已完整结束 */
+    for (uint32_t c = 0; c < sizeof(chunks) / sizeof(chunks[0]); c++)
+    {
+        for (uint32_t seed = 1; seed <= (chunks[c] > 1U ? 4U : 1U); seed++)
+        {
+            HAL_StatusTypeDef st = Decode(&s, lz, lz_len, raw_len, chunks[c], seed * 2654435761U);
+            CHECK(st == HAL_OK, "%s: chunk=%u seed=%u 解压失败", name, chunks[c], seed);
+            CHECK(s.out == raw_len && g_out_len == raw_len && memcmp(g_out, raw, raw_len) == 0,
+                  "%s: chunk=%u seed=%u 输出不一致（%u/%u 字节）", name, chunks[c], seed, g_out_len, raw_len);
+            CHECK(Lz4Stream_Done(&s), "%s: chunk=%u 结束时 Done=0", name, chunks[c]);
+            CHECK(!g_sink_gap, "%s: chunk=%u 输出回调偏移不连续", name, chunks[c]);
+        }
+    }
+
+    /* 截断：已输出的部分必须是原始数据的前缀，且不会被当成完整解出了 raw_len 字节 */
+    uint32_t step = (lz_len > 600U) ? lz_len / 200U : 1U;
+    for (uint32_t cut = 0; cut < lz_len; cut += step)
+    {
+        HAL_StatusTypeDef st = Decode(&s, lz, cut, raw_len, 1U, 1U);
+        CHECK(st == HAL_OK, "%s: 截断在 %u 处时 Feed 报错", name, cut);
+        CHECK(g_out_len <= raw_len && memcmp(g_out, raw, g_out_len) == 0, "%s: 截断在 %u 处时输出不是前缀", name, cut);
+        CHECK(!(Lz4Stream_Done(&s) && s.out == raw_len), "%s: 截断在 %u 处被当成完整的流", name, cut);
+    }
+
+    /* 输出上限比原始数据少一个字节：必须报错，并且之后的输入全部拒绝 */
+    if (raw_len > 0U)
+    {
+        HAL_StatusTypeDef st = Decode(&s, lz, lz_len, raw_len - 1U, 64U, 7U);
+        CHECK(st == HAL_ERROR, "%s: 输出超过上限没有报错", name);
+        CHECK(!Lz4Stream_Done(&s), "%s: 出错后 Done=1", name);
+        CHECK(Lz4Stream_Feed(&s, lz, 1U) == HAL_ERROR, "%s: 出错后仍接受输入", name);
+    }
+
+    free(g_out);
+done:
+    free(raw);
+    free(lz);
+}
+
+/* 手工构造的非法流：匹配距离为 0、距离超过已解出的数据 */
+static void RunMalformed(void)
+{
+    static Lz4Stream_t s;
+    static const uint8_t zero_off[] = { 0x10, 'A', 0x00, 0x00, 0x00 };
+    static const uint8_t far_off[]  = { 0x10, 'A', 0x02, 0x00, 0x00 };
+    uint8_t buf[64];
+
+    g_out = buf;
+    g_out_cap = sizeof(buf);
+    CHECK(Decode(&s, zero_off, sizeof(zero_off), sizeof(buf), 0U, 1U) == HAL_ERROR, "匹配距离为 0 没有报错");
+    CHECK(Decode(&s, far_off, sizeof(far_off), sizeof(buf), 1U, 1U) == HAL_ERROR, "匹配距离超出已解出数据没有报错");
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        printf("用法: %s <向量目录>\n", argv[0]);
+        return 2;
+    }
+    int cases = Test_ForEachVector(argv[1], "lz4", RunCase);
+    RunMalformed();
+    CHECK(cases > 0, "没有找到 lz4 用例");
+    printf("%s: %d 组用例，%d 处失败\n", test_failures ? "[FAIL]" : "[OK ]", cases, test_failures);
+    return test_failures ? 1 : 0;
+}
@@ -0,0 +1,99 @@
+#ifndef __TEST_UTIL_H
+#define __TEST_UTIL_H
+
+/*
+ * 主机测试的公共工具：读向量文件、可复现的伪随机数、失败计数
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int test_failures = 0;
+
+#define CHECK(cond, ...)                                               \
+    do {                                                               \
+        if (!(cond)) {                                                 \
+            test_failures++;                                           \
+            printf("[FAIL] %s:%d: ", __FILE__, __LINE__);              \
+            printf(__VA_ARGS__);                                       \
+            printf("\n");                                              \
+        }                                                              \
+    } while (0)
+
+/**
+ * @brief 读入整个文件
+ * @param dir 目录
+ * @param name 文件名（不含目录）
+ * @param len 输出：文件长度
+ * @return 文件内容（malloc，调用者释放）；失败返回 NULL
+ */
+static uint8_t *Test_LoadFile(const char *dir, const char *name, uint32_t *len)
+{
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        printf("[FAIL] 打不开 %s\n", path);
+        test_failures++;
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    long n = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t *buf = malloc((size_t)n + 1U);
+    if (buf == NULL || fread(buf, 1, (size_t)n, f) != (size_t)n) {
+        printf("[FAIL] 读取 %s 失败\n", path);
+        test_failures++;
+        fclose(f);
+        free(buf);
+        return NULL;
+    }
+    fclose(f);
+    *len = (uint32_t)n;
+    return buf;
+}
+
+/**
+ * @brief xorshift32 伪随机数，种子相同时切分方式可复现
+ */
+static uint32_t Test_Rand(uint32_t *state)
+{
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+/**
+ * @brief 逐行读取 vectors.txt 中指定类型的用例名
+ * @param dir 向量目录
+ * @param kind "lz4" 或 "delta"
+ * @param cb 每个用例调用一次
+ * @return 找到的用例数
+ */
+static int Test_ForEachVector(const char *dir, const char *kind, void (*cb)(const char *dir, const char *name))
+{
+    char path[512], line[256], k[32], name[200];
+    int count = 0;
+    snprintf(path, sizeof(path), "%s/vectors.txt", dir);
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        printf("[FAIL] 打不开 %s\n", path);
+        test_failures++;
+        return 0;
+    }
+    while (fgets(line, sizeof(line), f) != NULL) {
+        if (sscanf(line, "%31s %199s", k, name) == 2 && strcmp(k, kind) == 0) {
+            cb(dir, name);
+            count++;
+        }
+    }
+    fclose(f);
+    return count;
+}
+
+#endif /* __TEST_UTIL_H */
@@ -0,0 +1,196 @@
+"""
+停等 / 滑动窗口吞吐量对比（纯 Python，不需要开发板）。
+
+用模拟的串口链路和设备模型驱动 iap_send.py 中真正的 send_data_stop_and_wait / send_data_windowed：
+  - 链路：波特率决定每字节时间，单向时延模拟 USB 转串口的缓冲（FTDI 默认 latency timer 16ms），
+    每帧（两个方向）按给定概率丢失；
+  - 设备：按到达顺序逐帧处理，每字编程耗时 FLASH_US_PER_WORD，窗口模式回累计确认偏移 + 位图；
+  - 时间全部是模拟时间（替换 iap_send 里的 time），几秒内跑完。
+停等帧长用 iap_send.CHUNK_SIZE，窗口模式用设备协商的窗口和块大小（COMM_WIN_MAX=7，768 字节）。
+
+用法：python bench_window.py [--size KB] [--baud 115200,921600] [--latency 1,4,16] [--loss 0,0.01,0.05]
+"""
+import argparse
+import contextlib
+import io
+import os
+import random
+import struct
+import sys
+import types
+
+# 只用到组帧/收帧和发送逻辑，没装 pyserial 的机器上用一个空模块顶替
+try:
+    import serial  # noqa: F401
+except ImportError:
+    _serial = types.ModuleType("serial")
+    _serial.Serial = object
+    sys.modules["serial"] = _serial
+
+import iap_send  # noqa: E402
+from iap_send import (CMD_DATA, CMD_ACK, COMM_STATUS_OK, WIN_ACK_FMT,  # noqa: E402
+                      build_frame, send_data_stop_and_wait, send_data_windowed)
+
+DEVICE_WINDOW      = 7            # COMM_WIN_MAX
+DEVICE_CHUNK       = 768          # 设备把 1020 向下取整到 UPDATE_BLOCK_SIZE 的倍数
+FLASH_US_PER_WORD  = 16.0         # F407 按字编程典型值（数据手册 16us）
+
+
+class SimClock:
+    """替换 iap_send.time：time() 返回模拟时间，sleep() 推进模拟时间"""
+
+    def __init__(self):
+        self.now = 0.0
+
+    def time(self) -> float:
+        return self.now
+
+    def sleep(self, s: float):
+        self.now += s
+
+
+class SimLink:
+    """
+    模拟串口 + 设备。write() 时就能算出这一帧何时到达设备、设备何时处理完、应答何时到达上位机：
+    设备按到达顺序处理，两个方向的线路各自串行发送
+    """
+
+    def __init__(self, clock: SimClock, baud: int, latency: float, loss: float, windowed: bool,
+                 total: int, chunk: int, seed: int = 1):
+        self.clock = clock
+        self.byte_time = 10.0 / baud
+        self.latency = latency
+        self.loss = loss
+        self.windowed = windowed
+        self.total = total
+        self.chunk = chunk
+        self.rng = random.Random(seed)
+        self.timeout = 0.1
+        self.h2d_free = 0.0               # 上位机发送线路空闲时刻
+        self.d2h_free = 0.0               # 设备发送线路空闲时刻
+        self.dev_free = 0.0               # 设备处理完上一帧的时刻
+        self.rx = []                      # 发往上位机的字节：[(到达时刻, bytes)]
+        self.rx_buf = bytearray()
+        self.ack_offset = 0
+        self.sack = 0
+        self.got = set()
+        self.frames = 0
+        self.lost = 0
+
+    # ---------- pyserial 接口 ----------
+    def write(self, frame: bytes):
+        now = self.clock.now
+        start = max(now, self.h2d_free)
+        self.h2d_free = start + len(frame) * self.byte_time
+        self.frames += 1
+        if self.rng.random() < self.loss:
+            self.lost += 1
+            return len(frame)
+        self._device(frame, self.h2d_free + self.latency)
+        return len(frame)
+
+    def read(self, n: int = 1) -> bytes:
+        while len(self.rx_buf) < n:
+            self.rx.sort(key=lambda x: x[0])
+            if self.rx and self.rx[0][0] <= self.clock.now:
+                self.rx_buf += self.rx.pop(0)[1]
+                continue
+            deadline = self.clock.now + self.timeout
+            if self.rx and self.rx[0][0] <= deadline:
+                self.clock.now = self.rx[0][0]
+                continue
+            self.clock.now = deadline
+            break
+        out = bytes(self.rx_buf[:n])
+        del self.rx_buf[:n]
+        return out
+
+    # ---------- 设备模型 ----------
+    def _device(self, frame: bytes, arrive: float):
+        cmd, seq, length = frame[2], frame[3], frame[4] | (frame[5] << 8)
+        payload = frame[6:6 + length]
+        if cmd != CMD_DATA:
+            return
+        offset = struct.unpack_from("<I", payload)[0]
+        data = payload[4:]
+        start = max(arrive, self.dev_free)
+        new = offset not in self.got
+        self.dev_free = start + (((len(data) + 3) // 4) * FLASH_US_PER_WORD * 1e-6 if new else 0.0)
+        self.got.add(offset)
+
+        if self.windowed:
+            while self.ack_offset < self.total and self.ack_offset in self.got:
+                self.ack_offset = min(self.ack_offset + self.chunk, self.total)
+            self.sack = 0
+            for bit in range(32):                 # 与 comm_proto.h 一致：bit i 对应 ack_offset + i*chunk
+                if self.ack_offset + bit * self.chunk in self.got:
+                    self.sack |= 1 << bit
+            reply = struct.pack(WIN_ACK_FMT, COMM_STATUS_OK, CMD_DATA, seq, 1, self.ack_offset, self.sack)
+        else:
+            reply = bytes([COMM_STATUS_OK, CMD_DATA, seq])
+        ack = build_frame(CMD_ACK, 0, reply)
+
+        self.frames += 1
+        if self.rng.random() < self.loss:
+            self.lost += 1
+            return
+        tx = max(self.dev_free, self.d2h_free)
+        self.d2h_free = tx + len(ack) * self.byte_time
+        self.rx.append((self.d2h_free + self.latency, ack))
+
+
+def run(fw: bytes, baud: int, latency: float, loss: float, windowed: bool):
+    """跑一次完整的数据阶段，返回 (是否成功, 模拟耗时秒, 链路上的帧数, 丢失帧数)"""
+    clock = SimClock()
+    chunk = DEVICE_CHUNK if windowed else iap_send.CHUNK_SIZE
+    link = SimLink(clock, baud, latency, loss, windowed, len(fw), chunk)
+    saved_time = iap_send.time
+    iap_send.time = clock
+    try:
+        with contextlib.redirect_stdout(io.StringIO()):
+            if windowed:
+                ok, _ = send_data_windowed(link, fw, 0, DEVICE_WINDOW, DEVICE_CHUNK)
+            else:
+                ok, _ = send_data_stop_and_wait(link, fw, 0, chunk)
+    finally:
+        iap_send.time = saved_time
+    ok = ok and all(off in link.got for off in range(0, len(fw), chunk))
+    return ok, clock.now, link.frames, link.lost
+
+
+def main() -> int:
+    ap = argparse.ArgumentParser(description="停等 / 滑动窗口吞吐量对比（模拟链路）")
+    ap.add_argument("--size", type=int, default=64, help="镜像大小（KB）")
+    ap.add_argument("--baud", default="115200,921600", help="波特率列表")
+    ap.add_argument("--latency", default="1,4,16", help="单向时延列表（ms）")
+    ap.add_argument("--loss", default="0,0.01,0.05", help="每帧丢失概率列表")
+    args = ap.parse_args()
+
+    fw = os.urandom(args.size * 1024)
+    bauds = [int(x) for x in args.baud.split(",")]
+    latencies = [float(x) for x in args.latency.split(",")]
+    losses = [float(x) for x in args.loss.split(",")]
+
+    print(f"镜像 {args.size}KB；停等每帧 {iap_send.CHUNK_SIZE} 字节，窗口 {DEVICE_WINDOW} 帧 x {DEVICE_CHUNK} 字节；"
+          f"编程 {FLASH_US_PER_WORD:g}us/字")
+    print(f"{'波特率':>8} {'时延ms':>6} {'丢帧':>6} | {'停等 KB/s':>10} {'窗口 KB/s':>10} {'加速':>6} | {'线速 KB/s':>9}")
+    failed = False
+    for baud in bauds:
+        line_rate = baud / 10 / 1024
+        for lat in latencies:
+            for loss in losses:
+                res = []
+                for windowed in (False, True):
+                    ok, t, _, _ = run(fw, baud, lat / 1000.0, loss, windowed)
+                    failed |= not ok
+                    res.append(len(fw) / 1024 / t if ok else 0.0)
+                speedup = f"{res[1] / res[0]:.2f}x" if res[0] > 0 else "-"
+                print(f"{baud:>8} {lat:>6g} {loss * 100:>5g}% | {res[0]:>10.2f} {res[1]:>10.2f} {speedup:>6} | "
+                      f"{line_rate:>9.2f}")
+    if failed:
+        print("[ERR] 有传输没有完成（0.00 表示失败）")
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,175 @@
+"""
+擦除期间串口接收压力测试（需要连接开发板）。
+
+让设备擦除下载目标槽，擦除期间上位机不停地向设备灌字节，
+擦完后查询通信统计，看接收溢出（ORE）次数有没有增加。
+固件统计里有接收解析耗时和通信任务栈余量时一并打印：写标记块期间每帧的 DWT 周期数、
+单次 Comm_OnBytesReceived 的最长周期数、commTask 栈的历史最少剩余字节数。
+串口中断链和Flash驱动在SRAM中、擦写期间Flash里的中断被 BASEPRI 挡住时，溢出次数应为0。
+
+测试会在目标槽里写两块数据再重新开始会话，保证第二次 START_UPDATE 一定要擦除首尾两个扇区；
+测试留下的会话超时后作废，下一次正式升级会重新擦除目标槽，不影响运行中的固件。
+
+记录：中断改为擦写期间不调用 RTOS 接口之后，还没有在板上跑过本测试，rx_overruns 没有实测值。
+IAP_APP/Tests 的 test_comm_erase 在主机模型里报告 rx_overruns=0（115200 / 921600 bps），
+但模型里的 DMA 总能及时搬走字节，产生不了硬件的 ORE，不能代替本测试。
+"""
+import queue
+import struct
+import sys
+import threading
+import time
+
+import serial
+
+import iap_send
+from iap_send import (PORT, BAUDRATE, AUTO_BAUD, CMD_START_UPDATE, CMD_DATA, CMD_QUERY_STATS, CMD_ACK,
+                      COMM_STATUS_OK, COMM_CAP_BAUD, SLOT_A_SIZE, send_frame, recv_frame,
+                      handshake, negotiate_baud, query_slot)
+
+STATS_FMT      = "<IIIIBBBBIIHHHHI"   # CommStats_t：..., rx_overruns 在最后
+STATS_EXT_FMT  = "<III"               # 紧随其后：rx_isr_cycles, rx_isr_cycles_max, task_stack_free（旧固件没有）
+FILL_CHUNK     = bytes(256)           # 0x00 不是帧头，设备接收状态机逐字节丢弃
+ERASE_TIMEOUT  = 15.0                 # 等待 START_UPDATE 应答（即擦除结束）的最长时间（秒）
+MARK_SIZE      = 256                  # 写在目标槽首尾的标记块大小
+
+
+def query_stats(ser: serial.Serial):
+    """
+    查询 CommStats_t，返回 (字段元组, 扩展字段元组)；旧固件没有 rx_overruns 时返回 None，
+    没有解析耗时和栈余量时扩展字段为 None
+    """
+    send_frame(ser, CMD_QUERY_STATS, 0, b"")
+    frame = recv_frame(ser, timeout=1.0)
+    base = struct.calcsize(STATS_FMT)
+    if frame is None or frame[0] != CMD_QUERY_STATS or len(frame[2]) < base:
+        return None
+    ext = None
+    if len(frame[2]) >= base + struct.calcsize(STATS_EXT_FMT):
+        ext = struct.unpack_from(STATS_EXT_FMT, frame[2], base)
+    return struct.unpack_from(STATS_FMT, frame[2]), ext
+
+
+def start_while_streaming(ser: serial.Serial, seq: int, size: int, crc: int):
+    """
+    发 START_UPDATE 后一直灌字节，直到收到它的应答。
+    返回 (应答状态, 应答耗时秒, 灌入字节数)，超时状态为 None
+    """
+    frames = queue.Queue()
+    stop = threading.Event()
+
+    def reader():
+        while not stop.is_set():
+            frame = recv_frame(ser, timeout=0.2)
+            if frame is not None:
+                frames.put(frame)
+
+    t = threading.Thread(target=reader, daemon=True)
+    t.start()
+
+    send_frame(ser, CMD_START_UPDATE, seq, struct.pack("<III", size, crc, 0xFFFFFFFF))
+    t0 = time.time()
+    streamed = 0
+    status = None
+
+    while time.time() - t0 < ERASE_TIMEOUT and status is None:
+        ser.write(FILL_CHUNK)
+        streamed += len(FILL_CHUNK)
+        try:
+            while True:
+                cmd, _, payload = frames.get_nowait()
+                if cmd == CMD_ACK and len(payload) >= 3 and payload[1] == CMD_START_UPDATE:
+                    status = payload[0]
+                    break
+        except queue.Empty:
+            pass
+
+    elapsed = time.time() - t0
+    stop.set()
+    t.join()
+    return status, elapsed, streamed
+
+
+def write_mark(ser: serial.Serial, seq: int, offset: int) -> bool:
+    """在目标槽 offset 处写一块标记数据（让对应扇区不再空白）"""
+    send_frame(ser, CMD_DATA, seq, struct.pack("<I", offset) + bytes([0x5A]) * MARK_SIZE)
+    deadline = time.time() + 2.0
+    while time.time() < deadline:
+        frame = recv_frame(ser, timeout=max(deadline - time.time(), 0.0))
+        if frame is not None and frame[0] == CMD_ACK and len(frame[2]) >= 2 and frame[2][1] == CMD_DATA:
+            return frame[2][0] == COMM_STATUS_OK
+    return False
+
+
+def main() -> int:
+    try:
+        ser = serial.Serial(PORT, BAUDRATE, timeout=0.1)
+    except Exception as e:
+        print(f"[ERR] 打开串口失败: {e}")
+        return 1
+
+    time.sleep(0.5)
+    try:
+        # 停等模式：标记块写在目标槽末尾，超出滑动窗口的范围
+        iap_send.WINDOW_SIZE = 1
+        caps = handshake(ser)
+        if caps is None:
+            return 1
+        if AUTO_BAUD and caps["flags"] & COMM_CAP_BAUD:
+            negotiate_baud(ser)
+
+        info = query_slot(ser)
+        size = info["size"] if info is not None else SLOT_A_SIZE
+
+        before = query_stats(ser)
+        if before is None:
+            print("[ERR] 设备不支持 rx_overruns 统计（旧固件？）")
+            return 1
+
+        # 第一次 START：目标槽不干净时就地擦除；随后在首尾各写一块，保证第二次 START 必须擦除
+        status, elapsed, streamed = start_while_streaming(ser, 1, size, int(time.time()))
+        if status != COMM_STATUS_OK:
+            print(f"[ERR] 第一次 START_UPDATE 失败：status={status}")
+            return 1
+        print(f"[*] 第一次 START_UPDATE：{elapsed:.2f}s，灌入 {streamed} 字节")
+
+        pre_mark = query_stats(ser)
+        if not write_mark(ser, 2, 0) or not write_mark(ser, 3, size - MARK_SIZE):
+            print("[ERR] 写入标记块失败")
+            return 1
+        post_mark = query_stats(ser)
+
+        status, elapsed, streamed = start_while_streaming(ser, 4, size, int(time.time()) ^ 0x5A5A5A5A)
+        if status != COMM_STATUS_OK:
+            print(f"[ERR] 第二次 START_UPDATE 失败：status={status}")
+            return 1
+        print(f"[*] 第二次 START_UPDATE（擦除 {size // 1024}KB 目标槽）：{elapsed:.2f}s，"
+              f"灌入 {streamed} 字节（{ser.baudrate} bps）")
+
+        time.sleep(0.2)
+        after = query_stats(ser)
+        if after is None:
+            print("[ERR] 擦除后查询统计失败，设备没有响应")
+            return 1
+
+        overruns = after[0][-1] - before[0][-1]
+        uart_errors = after[0][3] - before[0][3]
+        print(f"[*] 接收溢出 +{overruns}，UART错误 +{uart_errors}，丢帧 +{after[0][2] - before[0][2]}")
+        if after[1] is not None:
+            # 两次查询之间只有两个标记块DATA帧和一个查询帧，没有填充字节
+            if pre_mark is not None and post_mark is not None and post_mark[0][0] > pre_mark[0][0]:
+                cycles = (post_mark[1][0] - pre_mark[1][0]) & 0xFFFFFFFF
+                print(f"[*] 接收解析：每帧平均 {cycles // (post_mark[0][0] - pre_mark[0][0])} 周期"
+                      f"（{MARK_SIZE}字节DATA帧为主）")
+            print(f"[*] 接收解析单次最长 {after[1][1]} 周期，commTask 栈最少剩余 {after[1][2]} 字节")
+        if overruns != 0:
+            print("[FAIL] 擦除期间发生接收溢出")
+            return 1
+        print("[PASS] 擦除期间没有接收溢出")
+        return 0
+    finally:
+        ser.close()
+
+
+if __name__ == "__main__":
+    sys.exit(main())
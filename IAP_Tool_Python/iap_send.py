@@ -1,286 +1,1156 @@
-import serial
-import struct
-import zlib
-import time
-import sys
-
-# ======= 根据自己情况修改这里 =======
-PORT      = "COM3"          # 串口号：Windows COM5 / Linux "/dev/ttyUSB0"
-BAUDRATE  = 115200
-BIN_PATH = "D:\\Code\\Clion\\Cubemx\\STM32F407VET6\\BOOTL_APP\\cmake-build-debug-stm32\\app.bin"       # 要烧录的固件 bin 文件
-VERSION   = 0x00000001      # 固件版本号，自定义
-CHUNK_SIZE = 512            # 每帧数据负载大小（建议 256~1024）
-ACK_TIMEOUT = 2.0           # 等待 ACK 超时时间（秒）
-MAX_RETRY  = 5              # 单帧最大重试次数
-# ===================================
-
-# 帧头
-COMM_HEAD1 = 0x55
-COMM_HEAD2 = 0xAA
-
-# 命令字（必须和 comm_proto.h 一致）
-CMD_HANDSHAKE      = 0x01
-CMD_START_UPDATE   = 0x02
-CMD_DATA           = 0x03
-CMD_END_UPDATE     = 0x04
-CMD_QUERY_VERSION  = 0x05
-CMD_ACK            = 0x06
-
-# ACK 状态码（和 MCU 侧 CommStatus_t 对应）
-COMM_STATUS_OK          = 0x00
-COMM_STATUS_FRAME_CRC   = 0x01
-COMM_STATUS_PARAM_ERR   = 0x02
-COMM_STATUS_FLASH_ERR   = 0x03
-COMM_STATUS_STATE_ERR   = 0x04
-
-
-def calc_crc32(data: bytes) -> int:
-    """
-    使用和 MCU 一样的 CRC32 算法：
-    - 多项式 0xEDB88320
-    - 初值 0xFFFFFFFF
-    - 结果异或 0xFFFFFFFF
-    Python 的 zlib.crc32 就是这一套。
-    """
-    return zlib.crc32(data) & 0xFFFFFFFF
-
-
-def build_frame(cmd: int, seq: int, payload: bytes) -> bytes:
-    length = len(payload)
-    len_l = length & 0xFF
-    len_h = (length >> 8) & 0xFF
-
-    header = bytes([
-        COMM_HEAD1,
-        COMM_HEAD2,
-        cmd,
-        seq,
-        len_l,
-        len_h
-    ])
-
-    # 帧 CRC：从 CMD 开始，到 DATA 结束
-    crc_input = bytes([cmd, seq, len_l, len_h]) + payload
-    crc = calc_crc32(crc_input)
-    crc_bytes = struct.pack("<I", crc)  # 小端
-
-    return header + payload + crc_bytes
-
-
-def send_frame(ser: serial.Serial, cmd: int, seq: int, payload: bytes):
-    frame = build_frame(cmd, seq, payload)
-    ser.write(frame)
-
-
-def recv_frame(ser: serial.Serial, timeout: float = 1.0):
-    """
-    从串口读取一帧：
-    返回 (cmd, seq, payload) 或 None
-    """
-    ser.timeout = 0.1
-    start_time = time.time()
-
-    state = 0
-    buf = bytearray()
-
-    while True:
-        if time.time() - start_time > timeout:
-            return None
-
-        b = ser.read(1)
-        if not b:
-            continue
-
-        ch = b[0]
-
-        if state == 0:
-            if ch == COMM_HEAD1:
-                state = 1
-        elif state == 1:
-            if ch == COMM_HEAD2:
-                state = 2
-                buf.clear()
-            else:
-                state = 0
-        elif state >= 2:
-            buf.append(ch)
-            # 至少要有 CMD、SEQ、LEN_L、LEN_H
-            if len(buf) == 4:
-                length = buf[2] | (buf[3] << 8)
-                # 后面还有 payload + 4 字节 CRC
-                expected_len = 4 + length + 4
-            # 收满整帧
-            if 'expected_len' in locals() and len(buf) >= expected_len:
-                cmd = buf[0]
-                seq = buf[1]
-                length = buf[2] | (buf[3] << 8)
-                payload = bytes(buf[4:4+length])
-                crc_recv = struct.unpack("<I", buf[4+length:4+length+4])[0]
-
-                crc_input = bytes([cmd, seq, buf[2], buf[3]]) + payload
-                crc_calc = calc_crc32(crc_input)
-
-                if crc_calc == crc_recv:
-                    return cmd, seq, payload
-                else:
-                    # CRC 错误就丢弃这帧，继续找下一帧
-                    state = 0
-                    buf.clear()
-
-
-def wait_ack(ser: serial.Serial, expect_cmd: int, expect_seq: int, desc: str) -> bool:
-    """
-    等待一帧 ACK，并检查状态码
-    """
-    frame = recv_frame(ser, timeout=ACK_TIMEOUT)
-    if frame is None:
-        print(f"[ERR] 等待 {desc} 的 ACK 超时")
-        return False
-
-    cmd, seq, payload = frame
-
-    if cmd != CMD_ACK:
-        print(f"[ERR] 收到非 ACK 帧：cmd=0x{cmd:02X}, seq={seq}")
-        return False
-
-    if len(payload) < 3:
-        print(f"[ERR] ACK payload 长度错误：len={len(payload)}")
-        return False
-
-    status = payload[0]
-    cmd_echo = payload[1]
-    seq_echo = payload[2]
-
-    if cmd_echo != expect_cmd or seq_echo != expect_seq:
-        print(f"[ERR] ACK 回显不匹配：cmd_echo=0x{cmd_echo:02X}, seq_echo={seq_echo}")
-        return False
-
-    if status != COMM_STATUS_OK:
-        print(f"[ERR] ACK 状态错误：status=0x{status:02X}")
-        return False
-
-    print(f"[OK ] {desc} -> ACK")
-    return True
-
-
-def handshake(ser: serial.Serial) -> bool:
-    print("[*] 发送握手帧...")
-    # 握手可以 payload 为空，也可以带点字符串
-    payload = b"PC_HANDSHAKE"
-    send_frame(ser, CMD_HANDSHAKE, 0, payload)
-
-    frame = recv_frame(ser, timeout=2.0)
-    if frame is None:
-        print("[ERR] 等待握手响应超时")
-        return False
-
-    cmd, seq, payload = frame
-    if cmd != CMD_HANDSHAKE:
-        print(f"[ERR] 握手响应命令错误：0x{cmd:02X}")
-        return False
-
-    print(f"[OK ] 握手成功，返回：{payload!r}")
-    return True
-
-
-def main():
-    # 读取固件文件
-    try:
-        with open(BIN_PATH, "rb") as f:
-            fw = f.read()
-    except FileNotFoundError:
-        print(f"[ERR] 找不到固件文件：{BIN_PATH}")
-        return
-
-    total_size = len(fw)
-    if total_size == 0:
-        print("[ERR] 固件大小为 0")
-        return
-
-    # 整体 CRC 与 MCU 的 FlashCV_CalcCRC 保持一致
-    image_crc = calc_crc32(fw)
-    print(f"[*] 固件大小: {total_size} 字节, CRC32: 0x{image_crc:08X}")
-
-    # 打开串口
-    try:
-        ser = serial.Serial(PORT, BAUDRATE, timeout=0.1)
-    except Exception as e:
-        print(f"[ERR] 打开串口失败: {e}")
-        return
-
-    time.sleep(0.5)
-
-    try:
-        # 1) 握手
-        if not handshake(ser):
-            return
-
-        # 2) 发送 START_UPDATE
-        print("[*] 发送 START_UPDATE...")
-        payload = struct.pack("<III", total_size, image_crc, VERSION)
-        seq = 1
-        send_frame(ser, CMD_START_UPDATE, seq, payload)
-
-        if not wait_ack(ser, CMD_START_UPDATE, seq, "START_UPDATE"):
-            return
-
-        # 3) 分块发送数据
-        print("[*] 开始发送固件数据...")
-        offset = 0
-        seq += 1
-        frame_index = 0
-
-        while offset < total_size:
-            chunk = fw[offset:offset+CHUNK_SIZE]
-            payload = struct.pack("<I", offset) + chunk  # [offset | data...]
-            ok = False
-
-            for retry in range(MAX_RETRY):
-                print(f"[-->] 发送数据帧 #{frame_index}, offset={offset}, len={len(chunk)}, 重试={retry}")
-                send_frame(ser, CMD_DATA, seq & 0xFF, payload)
-
-                if wait_ack(ser, CMD_DATA, seq & 0xFF, f"DATA 帧 #{frame_index}"):
-                    ok = True
-                    break
-                else:
-                    print("[!!] 重发该帧")
-
-            if not ok:
-                print("[ERR] 数据帧发送失败，放弃升级")
-                return
-
-            offset += len(chunk)
-            seq += 1
-            frame_index += 1
-
-        print("[*] 固件数据全部发送完成")
-
-        # 4) 发送 END_UPDATE
-        print("[*] 发送 END_UPDATE...")
-
-        dummy_payload = b"\x00"  # 1 字节占位数据，MCU 端不使用它
-        ok = False
-
-        for retry in range(MAX_RETRY):
-            print(f"[-->] 发送 END_UPDATE 帧, 重试={retry}")
-            send_frame(ser, CMD_END_UPDATE, seq & 0xFF, dummy_payload)
-
-            if wait_ack(ser, CMD_END_UPDATE, seq & 0xFF, "END_UPDATE"):
-                ok = True
-                break
-            else:
-                print("[!!] END_UPDATE ACK 异常，准备重发")
-
-        if not ok:
-            print("[ERR] END_UPDATE 多次失败，放弃升级")
-            return
-
-        print("[*] MCU 已接受结束升级请求，接下来会在 Idle 中做整体 CRC 校验 + 写 Meta + 复位")
-        print("[*] 请等待板子自动重启（BootLoader 搬运 APP 后再次运行）")
-
-    finally:
-        ser.close()
-
-
-if __name__ == "__main__":
-    main()
+import serial
+import os
+import struct
+import zlib
+import time
+import sys
+
+# ======= 根据自己情况修改这里 =======
+PORT      = "COM3"          # 串口号：Windows COM5 / Linux "/dev/ttyUSB0"
+BAUDRATE  = 115200
+BIN_PATH = "D:\\Code\\Clion\\Cubemx\\STM32F407VET6\\BOOTL_APP\\cmake-build-debug-stm32\\app.bin"       # 要烧录的固件 bin 文件
+VERSION   = 0x00000001      # 固件版本号，自定义
+CHUNK_SIZE = 512            # 每帧数据负载大小（建议 256~1024）
+ACK_TIMEOUT = 2.0           # 等待 ACK 超时时间（秒）
+MAX_RETRY  = 5              # 单帧最大重试次数
+WINDOW_SIZE = 8             # 滑动窗口大小（帧），设备会按自身能力裁剪；<=1 表示停等
+AUTO_BAUD  = True           # 握手后切换到设备和串口都支持的最快波特率
+ROLLBACK   = False          # True：不发送固件，让设备切回另一个槽中的上一版固件（也可在命令行加 --rollback）
+COMPRESS   = True           # 设备支持时用 LZ4 压缩传输，设备边收边解压写入 Flash
+BASE_PATH  = ""             # 设备上当前固件的 app.bin（差分升级的基线，同目录要有 app_b.bin）；留空则整包传输
+DEDUP      = True           # 设备支持时比较块CRC，和运行镜像相同的块让设备本地复制，不再传输
+# ===================================
+
+# 帧头
+COMM_HEAD1 = 0x55
+COMM_HEAD2 = 0xAA
+
+# 命令字（必须和 comm_proto.h 一致）
+CMD_HANDSHAKE      = 0x01
+CMD_START_UPDATE   = 0x02
+CMD_DATA           = 0x03
+CMD_END_UPDATE     = 0x04
+CMD_QUERY_VERSION  = 0x05
+CMD_ACK            = 0x06
+CMD_QUERY_STATS    = 0x07
+CMD_SET_BAUD       = 0x08
+CMD_BAUD_PROBE     = 0x09
+CMD_QUERY_MISSING  = 0x0A
+CMD_QUERY_BOOT     = 0x0B
+CMD_QUERY_SLOT     = 0x0C
+CMD_ROLLBACK       = 0x0D
+CMD_QUERY_BLOCK_CRCS = 0x0E
+CMD_COPY_BLOCKS    = 0x0F
+
+# ACK 状态码（和 MCU 侧 CommStatus_t 对应）
+COMM_STATUS_OK          = 0x00
+COMM_STATUS_FRAME_CRC   = 0x01
+COMM_STATUS_PARAM_ERR   = 0x02
+COMM_STATUS_FLASH_ERR   = 0x03
+COMM_STATUS_STATE_ERR   = 0x04
+
+# 握手能力协商（和 comm_proto.h 中 CommCaps_t 对应）
+COMM_CAPS_MAGIC    = 0xC5
+COMM_CAP_WINDOW    = 1 << 0
+COMM_CAP_BAUD      = 1 << 1
+COMM_CAP_LZ4       = 1 << 2
+COMM_CAP_DELTA     = 1 << 3
+COMM_CAP_BLOCKS    = 1 << 4
+COMM_CAP_RELOC     = 1 << 5       # CMD_COPY_BLOCKS 带重定位位图
+CAPS_FMT           = "<BBHI"      # magic, window, chunk, flags
+WIN_ACK_FMT        = "<BBBBII"    # status, cmd, seq, count(合并的帧数), ack_offset, sack
+FAST_RETX_DUPS     = 2            # 缺口被后续应答越过几次后立即补发
+
+# 波特率协商
+DEFAULT_BAUD       = 115200       # 设备上电 / 探测失败回退的波特率
+BAUD_CANDIDATES    = [2000000, 1500000, 1000000, 921600, 460800, 230400]   # 从快到慢尝试
+BAUD_PROBE_TRIES   = 3            # 新波特率下探测帧重试次数
+BAUD_PROBE_TIMEOUT = 1.0          # 设备等待探测帧的时间（秒，和 COMM_BAUD_PROBE_MS 一致）
+
+# 启动邮箱（和 BootMailbox.h 中 BootMailbox_t 对应）
+BOOT_MAILBOX_MAGIC = 0xB007B0C5
+BOOT_INFO_FMT      = "<7I5II"     # magic, request, size, crc, version, boot_count, last_result, phase_us[5], crc
+BOOT_PHASE_NAMES   = ["读元数据", "预校验", "搬运+校验", "启动槽校验", "总计"]
+BOOT_RESULT_NAMES  = {0: "无升级", 1: "已安装", 2: "元数据无效", 3: "下载区CRC错误",
+                      4: "搬运失败", 5: "应用区CRC错误", 6: "活动槽无效，已回退到另一个槽",
+                      7: "新固件未确认，已自动回滚"}
+BOOT_REPORT_WAIT   = 10.0         # END_UPDATE 后等待设备复位并应答的时间（秒）
+
+# A/B 槽（和 FlashCV.h、comm_proto.h 中 CommSlotInfo_t 对应）
+SLOT_A             = 0
+SLOT_B             = 1
+SLOT_NAMES         = ["A", "B"]
+SLOT_A_ADDR        = 0x08008000   # 旧固件不支持槽查询时按单槽布局：镜像链接在槽A
+SLOT_A_SIZE        = 96 * 1024
+SLOT_ADDRS         = [SLOT_A_ADDR, 0x08020000]   # 槽A、槽B的链接地址，用于计算重定位的地址差
+SLOT_INFO_FMT      = "<BBBBII"    # running, target, confirmed, rollback, target_addr, target_size
+SLOT_BASE_FMT      = "<III"       # 紧随其后：运行镜像 size, crc, version（旧固件没有）
+
+# 传输编码（和 update_manager.h 的 UPDATE_ENC_* 一致）
+UPDATE_ENC_RAW     = 0
+UPDATE_ENC_LZ4     = 1
+UPDATE_ENC_DELTA   = 2
+LZ4_WINDOW         = 4096         # 最远匹配距离，等于设备解压窗口 LZ4S_WINDOW_SIZE
+LZ4_MIN_MATCH      = 4
+LZ4_MAX_CHAIN      = 32           # 每个位置最多比较的候选数，越大压缩率越高、越慢
+DELTA_MAGIC        = 0x31464442   # 补丁头 "BDF1"（和 DeltaPatch.h 一致）
+DELTA_SEED         = 8            # 在基线里找匹配起点用的字节数
+DELTA_MAX_CAND     = 8            # 每个起点最多尝试的基线位置数
+DELTA_SLACK        = 32           # 近似匹配时允许得分回落的字节数，越大越能跨过改动的地址常量
+BLOCK_CRC_HDR_FMT  = "<III"       # CMD_QUERY_BLOCK_CRCS 应答头：块大小, 运行镜像大小, 起始块号
+DEDUP_COPY_MAX     = 16 * 1024    # 单条 CMD_COPY_BLOCKS 最多复制的字节数，免得设备应答超过 ACK_TIMEOUT
+
+
+def calc_crc32(data: bytes) -> int:
+    """
+    使用和 MCU 一样的 CRC32 算法：
+    - 多项式 0xEDB88320
+    - 初值 0xFFFFFFFF
+    - 结果异或 0xFFFFFFFF
+    Python 的 zlib.crc32 就是这一套。
+    """
+    return zlib.crc32(data) & 0xFFFFFFFF
+
+
+def build_frame(cmd: int, seq: int, payload: bytes) -> bytes:
+    length = len(payload)
+    len_l = length & 0xFF
+    len_h = (length >> 8) & 0xFF
+
+    header = bytes([
+        COMM_HEAD1,
+        COMM_HEAD2,
+        cmd,
+        seq,
+        len_l,
+        len_h
+    ])
+
+    # 帧 CRC：从 CMD 开始，到 DATA 结束
+    crc_input = bytes([cmd, seq, len_l, len_h]) + payload
+    crc = calc_crc32(crc_input)
+    crc_bytes = struct.pack("<I", crc)  # 小端
+
+    return header + payload + crc_bytes
+
+
+def send_frame(ser: serial.Serial, cmd: int, seq: int, payload: bytes):
+    frame = build_frame(cmd, seq, payload)
+    ser.write(frame)
+
+
+def recv_frame(ser: serial.Serial, timeout: float = 1.0):
+    """
+    从串口读取一帧：
+    返回 (cmd, seq, payload) 或 None
+    """
+    ser.timeout = 0.1
+    start_time = time.time()
+
+    state = 0
+    buf = bytearray()
+
+    while True:
+        if time.time() - start_time > timeout:
+            return None
+
+        b = ser.read(1)
+        if not b:
+            continue
+
+        ch = b[0]
+
+        if state == 0:
+            if ch == COMM_HEAD1:
+                state = 1
+        elif state == 1:
+            if ch == COMM_HEAD2:
+                state = 2
+                buf.clear()
+            else:
+                state = 0
+        elif state >= 2:
+            buf.append(ch)
+            # 至少要有 CMD、SEQ、LEN_L、LEN_H
+            if len(buf) == 4:
+                length = buf[2] | (buf[3] << 8)
+                # 后面还有 payload + 4 字节 CRC
+                expected_len = 4 + length + 4
+            # 收满整帧
+            if 'expected_len' in locals() and len(buf) >= expected_len:
+                cmd = buf[0]
+                seq = buf[1]
+                length = buf[2] | (buf[3] << 8)
+                payload = bytes(buf[4:4+length])
+                crc_recv = struct.unpack("<I", buf[4+length:4+length+4])[0]
+
+                crc_input = bytes([cmd, seq, buf[2], buf[3]]) + payload
+                crc_calc = calc_crc32(crc_input)
+
+                if crc_calc == crc_recv:
+                    return cmd, seq, payload
+                else:
+                    # CRC 错误就丢弃这帧，继续找下一帧
+                    state = 0
+                    buf.clear()
+
+
+def wait_ack(ser: serial.Serial, expect_cmd: int, expect_seq: int, desc: str) -> bool:
+    """
+    等待一帧 ACK，并检查状态码
+    """
+    deadline = time.time() + ACK_TIMEOUT
+    while True:
+        frame = recv_frame(ser, timeout=max(deadline - time.time(), 0.0))
+        if frame is None:
+            print(f"[ERR] 等待 {desc} 的 ACK 超时")
+            return False
+
+        cmd, seq, payload = frame
+        # 窗口模式下重复发送的 DATA 帧可能还有应答在路上，跳过
+        if (cmd == CMD_ACK and expect_cmd != CMD_DATA
+                and len(payload) >= 3 and payload[1] == CMD_DATA):
+            continue
+        break
+
+    if cmd != CMD_ACK:
+        print(f"[ERR] 收到非 ACK 帧：cmd=0x{cmd:02X}, seq={seq}")
+        return False
+
+    if len(payload) < 3:
+        print(f"[ERR] ACK payload 长度错误：len={len(payload)}")
+        return False
+
+    status = payload[0]
+    cmd_echo = payload[1]
+    seq_echo = payload[2]
+
+    if cmd_echo != expect_cmd or seq_echo != expect_seq:
+        print(f"[ERR] ACK 回显不匹配：cmd_echo=0x{cmd_echo:02X}, seq_echo={seq_echo}")
+        return False
+
+    if status != COMM_STATUS_OK:
+        print(f"[ERR] ACK 状态错误：status=0x{status:02X}")
+        return False
+
+    print(f"[OK ] {desc} -> ACK")
+    return True
+
+
+def handshake(ser: serial.Serial):
+    """
+    握手并协商能力，返回设备同意的 {"window", "chunk", "flags"}，失败返回 None。
+    设备不认识能力块（旧固件）时 window=1，即停等模式。
+    """
+    print("[*] 发送握手帧...")
+    # 握手字符串后面附带请求的能力块
+    caps = COMM_CAP_BAUD if AUTO_BAUD else 0
+    if WINDOW_SIZE > 1:
+        caps |= COMM_CAP_WINDOW
+    if COMPRESS:
+        caps |= COMM_CAP_LZ4
+    if BASE_PATH:
+        caps |= COMM_CAP_DELTA
+    if DEDUP:
+        caps |= COMM_CAP_BLOCKS | COMM_CAP_RELOC
+    payload = b"PC_HANDSHAKE" + struct.pack(CAPS_FMT, COMM_CAPS_MAGIC, WINDOW_SIZE, CHUNK_SIZE, caps)
+    send_frame(ser, CMD_HANDSHAKE, 0, payload)
+
+    frame = recv_frame(ser, timeout=2.0)
+    if frame is None:
+        print("[ERR] 等待握手响应超时")
+        return None
+
+    cmd, seq, payload = frame
+    if cmd != CMD_HANDSHAKE:
+        print(f"[ERR] 握手响应命令错误：0x{cmd:02X}")
+        return None
+
+    result = {"window": 1, "chunk": CHUNK_SIZE, "flags": 0}
+    size = struct.calcsize(CAPS_FMT)
+    if len(payload) >= size:
+        magic, window, chunk, flags = struct.unpack(CAPS_FMT, payload[-size:])
+        if magic == COMM_CAPS_MAGIC:
+            payload = payload[:-size]
+            result["flags"] = flags
+            if flags & COMM_CAP_WINDOW:
+                result["window"] = window
+                result["chunk"] = chunk
+
+    print(f"[OK ] 握手成功，返回：{payload!r}，窗口={result['window']}，块大小={result['chunk']}")
+    return result
+
+
+def negotiate_baud(ser: serial.Serial) -> int:
+    """
+    从快到慢尝试 BAUD_CANDIDATES，返回最终使用的波特率。
+    设备以旧波特率应答 SET_BAUD 后立即切换，主机随后切换并发探测帧；
+    探测不通时两边都退回 DEFAULT_BAUD（设备在 BAUD_PROBE_TIMEOUT 后自动回退）。
+    """
+    for baud in BAUD_CANDIDATES:
+        if baud <= ser.baudrate:
+            break
+
+        print(f"[*] 尝试切换波特率到 {baud}...")
+        send_frame(ser, CMD_SET_BAUD, 0, struct.pack("<I", baud))
+        if not wait_ack(ser, CMD_SET_BAUD, 0, f"SET_BAUD {baud}"):
+            continue    # 设备不支持该波特率，仍在原波特率
+
+        switched = True
+        try:
+            ser.baudrate = baud
+        except Exception as e:
+            print(f"[!!] 串口不支持 {baud}: {e}")
+            switched = False
+
+        if switched:
+            time.sleep(0.02)
+            ser.reset_input_buffer()
+            for _ in range(BAUD_PROBE_TRIES):
+                send_frame(ser, CMD_BAUD_PROBE, 0, b"BAUD_PROBE")
+                frame = recv_frame(ser, timeout=0.2)
+                if frame is not None and frame[0] == CMD_BAUD_PROBE:
+                    print(f"[OK ] 已切换到 {baud} 波特率")
+                    return baud
+
+        print(f"[!!] {baud} 探测失败，退回 {DEFAULT_BAUD}")
+        ser.baudrate = DEFAULT_BAUD
+        time.sleep(BAUD_PROBE_TIMEOUT)      # 等设备超时退回默认波特率
+        ser.reset_input_buffer()
+
+    return ser.baudrate
+
+
+def query_missing(ser: serial.Serial, seq: int, total_size: int):
+    """
+    查询设备接收位图中尚未收到的数据区间（CMD_QUERY_MISSING），分页直到扫描到固件末尾。
+    返回 [(offset, length), ...]；设备不支持该命令或应答异常时返回 None
+    """
+    ranges = []
+    start = 0
+    while start < total_size:
+        send_frame(ser, CMD_QUERY_MISSING, seq & 0xFF, struct.pack("<I", start))
+        deadline = time.time() + ACK_TIMEOUT
+        while True:
+            frame = recv_frame(ser, timeout=max(deadline - time.time(), 0.0))
+            if frame is None:
+                print("[!!] 设备未应答缺失区间查询（旧固件？）")
+                return None
+            cmd, _, payload = frame
+            if cmd == CMD_QUERY_MISSING:
+                break
+            if cmd == CMD_ACK and len(payload) >= 2 and payload[1] == CMD_QUERY_MISSING:
+                print(f"[ERR] 缺失区间查询被拒绝：status=0x{payload[0]:02X}")
+                return None
+            # 其他迟到的应答直接跳过
+
+        if len(payload) < 4 or (len(payload) - 4) % 8 != 0:
+            print(f"[ERR] 缺失区间应答长度错误：len={len(payload)}")
+            return None
+
+        next_start = struct.unpack_from("<I", payload, 0)[0]
+        for i in range((len(payload) - 4) // 8):
+            ranges.append(struct.unpack_from("<II", payload, 4 + 8 * i))
+        if next_start <= start:
+            break
+        start = next_start
+
+    return ranges
+
+
+def resend_missing(ser: serial.Serial, fw: bytes, seq: int, chunk_size: int):
+    """
+    END_UPDATE 之前按设备的接收位图补发缺口（停等模式）：只重发缺失区间，直到设备报告没有缺口。
+    返回 (是否成功, 下一个 seq)；设备不支持查询时视为成功，交给 END_UPDATE 判断
+    """
+    for _ in range(MAX_RETRY):
+        missing = query_missing(ser, seq, len(fw))
+        seq += 1
+        if not missing:
+            return True, seq
+
+        print(f"[!!] 设备报告 {len(missing)} 个缺口，共 {sum(n for _, n in missing)} 字节，开始补发")
+        for off, length in missing:
+            end = off + length
+            while off < end:
+                n = min(chunk_size, end - off)
+                payload = struct.pack("<I", off) + fw[off:off + n]
+                send_frame(ser, CMD_DATA, seq & 0xFF, payload)
+                ok = wait_ack(ser, CMD_DATA, seq & 0xFF, f"补发 offset={off}")
+                seq += 1
+                if not ok:
+                    break       # 下一轮查询时仍会报告这个缺口
+                off += n
+
+    print("[ERR] 多轮补发后仍有缺口")
+    return False, seq
+
+
+def query_slot(ser: serial.Serial, log_func=print):
+    """
+    查询设备的A/B槽信息（CMD_QUERY_SLOT），返回 {"running", "target", "confirmed", "rollback", "addr", "size"}；
+    设备不应答（旧固件）时返回 None，按单槽布局发送槽A镜像
+    """
+    send_frame(ser, CMD_QUERY_SLOT, 0, b"\x00")
+    frame = recv_frame(ser, timeout=1.0)
+    if frame is None or frame[0] != CMD_QUERY_SLOT or len(frame[2]) < struct.calcsize(SLOT_INFO_FMT):
+        log_func("[!!] 设备未应答槽查询（旧固件？），按单槽布局发送槽A镜像")
+        return None
+    running, target, confirmed, rollback, addr, size = struct.unpack_from(SLOT_INFO_FMT, frame[2])
+    base_size = base_crc = base_version = 0
+    if len(frame[2]) >= struct.calcsize(SLOT_INFO_FMT) + struct.calcsize(SLOT_BASE_FMT):
+        base_size, base_crc, base_version = struct.unpack_from(SLOT_BASE_FMT, frame[2],
+                                                               struct.calcsize(SLOT_INFO_FMT))
+    log_func(f"[*] 设备运行在槽{SLOT_NAMES[running & 1]}（{'已确认' if confirmed else '试运行中'}），"
+             f"本次写入槽{SLOT_NAMES[target & 1]}（0x{addr:08X}，{size // 1024}KB，"
+             f"{'有可回滚的镜像' if rollback else '无可回滚的镜像'}）")
+    return {"running": running, "target": target, "confirmed": confirmed, "rollback": rollback,
+            "addr": addr, "size": size,
+            "base_size": base_size, "base_crc": base_crc, "base_version": base_version}
+
+
+def slot_bin_path(bin_path: str, slot: int) -> str:
+    """槽B镜像和槽A镜像在同一目录：app.bin <-> app_b.bin，给出哪一个都可以"""
+    root, ext = os.path.splitext(bin_path)
+    if root.endswith("_b"):
+        root = root[:-2]
+    return root + ("_b" if slot == SLOT_B else "") + ext
+
+
+def load_slot_image(ser: serial.Serial, bin_path: str, log_func=print):
+    """
+    按设备的下载目标槽选择镜像文件并检查向量表：栈顶在SRAM内、复位向量落在目标槽内，
+    否则说明是为另一个槽链接的。返回 (固件内容, 槽信息)，失败时固件内容为 None
+    """
+    info = query_slot(ser, log_func)
+    slot = info["target"] if info else SLOT_A
+    addr = info["addr"] if info else SLOT_A_ADDR
+    size = info["size"] if info else SLOT_A_SIZE
+    path = slot_bin_path(bin_path, slot)
+
+    try:
+        with open(path, "rb") as f:
+            fw = f.read()
+    except FileNotFoundError:
+        log_func(f"[ERR] 找不到固件文件：{path}")
+        return None, info
+
+    if len(fw) == 0:
+        log_func("[ERR] 固件大小为 0")
+        return None, info
+    if len(fw) > size:
+        log_func(f"[ERR] 固件 {len(fw)} 字节超出槽{SLOT_NAMES[slot]}容量 {size} 字节")
+        return None, info
+
+    sp, reset = struct.unpack_from("<II", fw) if len(fw) >= 8 else (0, 0)
+    if not (0x20000000 <= sp <= 0x20020000 and addr <= (reset & ~1) < addr + len(fw)):
+        log_func(f"[ERR] {path} 不是按槽{SLOT_NAMES[slot]}（0x{addr:08X}）链接的镜像："
+                 f"复位向量=0x{reset:08X}")
+        return None, info
+
+    log_func(f"[*] 使用固件：{path}")
+    return fw, info
+
+
+def read_slot_build(bin_path: str, slot: int):
+    """读取同一次构建里按 slot 链接的那份镜像（槽A: app.bin，槽B: app_b.bin），没有时返回 None"""
+    try:
+        with open(slot_bin_path(bin_path, slot), "rb") as f:
+            return f.read()
+    except FileNotFoundError:
+        return None
+
+
+def is_running_image(bin_path: str, info) -> bool:
+    """
+    设备运行槽里是否已经是这次要发的固件：按运行槽取同一次构建的镜像（槽A: app.bin，槽B: app_b.bin），
+    大小和CRC与运行槽的槽头一致。两个槽链接地址不同，要和运行槽对应的那份比较
+    """
+    if info is None or info["base_size"] == 0:
+        return False
+    image = read_slot_build(bin_path, info["running"])
+    return image is not None and len(image) == info["base_size"] and calc_crc32(image) == info["base_crc"]
+
+
+def load_base_image(base_path: str, info, log_func=print):
+    """
+    读取差分基线：设备运行槽对应的那份旧镜像（槽A: base_path，槽B: 同目录 *_b.bin），
+    大小和CRC必须与设备运行槽的槽头一致，否则返回 None（改为整包传输）
+    """
+    if info is None or info["base_size"] == 0:
+        log_func("[!!] 设备没有报告运行镜像的槽头，不能差分升级")
+        return None
+    path = slot_bin_path(base_path, info["running"])
+    try:
+        with open(path, "rb") as f:
+            base = f.read()
+    except FileNotFoundError:
+        log_func(f"[!!] 找不到差分基线：{path}")
+        return None
+    if len(base) != info["base_size"] or calc_crc32(base) != info["base_crc"]:
+        log_func(f"[!!] 差分基线 {path} 与设备运行的固件（版本 0x{info['base_version']:08X}，"
+                 f"{info['base_size']} 字节，CRC 0x{info['base_crc']:08X}）不一致，改为整包传输")
+        return None
+    log_func(f"[*] 差分基线：{path}")
+    return base
+
+
+# ===================== LZ4 压缩（和 Lz4Stream.c 对应） =====================
+
+def _lz4_put_len(out: bytearray, n: int):
+    """token 中的长度字段满 15 后，剩余长度按 255 一个字节续写"""
+    while n >= 255:
+        out.append(255)
+        n -= 255
+    out.append(n)
+
+
+def lz4_compress(data: bytes, window: int = LZ4_WINDOW) -> bytes:
+    """
+    压缩成 LZ4 块格式，匹配距离不超过 window（设备解压窗口 LZ4S_WINDOW_SIZE）。
+    哈希链贪心匹配，每个位置最多比较 LZ4_MAX_CHAIN 个候选；按 LZ4 规范最后 5 字节为字面量，
+    最后一个匹配在结尾 12 字节之前开始，结果也能用标准 LZ4 库解开
+    """
+    n = len(data)
+    out = bytearray()
+    head = {}                  # 4 字节前缀 -> 最近出现的位置
+    prev = [-1] * n            # 同一前缀上一次出现的位置
+    match_limit = n - 5        # 匹配不能覆盖最后 5 字节
+    start_limit = n - 12       # 匹配起点必须在结尾 12 字节之前
+    anchor = 0
+    i = 0
+
+    def insert(pos: int):
+        key = data[pos:pos + 4]
+        prev[pos] = head.get(key, -1)
+        head[key] = pos
+
+    while i < start_limit:
+        best_len, best_off = 0, 0
+        cand = head.get(data[i:i + 4], -1)
+        depth = 0
+        while cand >= 0 and i - cand <= window and depth < LZ4_MAX_CHAIN:
+            # 先比较能否超过当前最长匹配的那个字节，多数候选在这里就被排除
+            if i + best_len < match_limit and data[cand + best_len] == data[i + best_len]:
+                k = 0
+                while i + k < match_limit and data[cand + k] == data[i + k]:
+                    k += 1
+                if k > best_len:
+                    best_len, best_off = k, i - cand
+            cand = prev[cand]
+            depth += 1
+
+        if best_len < LZ4_MIN_MATCH:
+            insert(i)
+            i += 1
+            continue
+
+        lit = data[anchor:i]
+        ml = best_len - LZ4_MIN_MATCH
+        out.append((min(len(lit), 15) << 4) | min(ml, 15))
+        if len(lit) >= 15:
+            _lz4_put_len(out, len(lit) - 15)
+        out += lit
+        out += struct.pack("<H", best_off)
+        if ml >= 15:
+            _lz4_put_len(out, ml - 15)
+
+        for p in range(i, min(i + best_len, start_limit)):
+            insert(p)
+        i += best_len
+        anchor = i
+
+    # 最后一个序列只有字面量
+    lit = data[anchor:]
+    out.append(min(len(lit), 15) << 4)
+    if len(lit) >= 15:
+        _lz4_put_len(out, len(lit) - 15)
+    out += lit
+    return bytes(out)
+
+
+def lz4_decompress(stream: bytes, size: int, window: int = LZ4_WINDOW) -> bytes:
+    """解压 lz4_compress 的结果，发送前用来核对压缩流；数据错误时抛 ValueError"""
+    out = bytearray()
+    i = 0
+    while i < len(stream):
+        token = stream[i]
+        i += 1
+        lit = token >> 4
+        if lit == 15:
+            while True:
+                b = stream[i]
+                i += 1
+                lit += b
+                if b != 255:
+                    break
+        out += stream[i:i + lit]
+        i += lit
+        if i >= len(stream):
+            break
+        off = stream[i] | (stream[i + 1] << 8)
+        i += 2
+        ml = token & 0x0F
+        if ml == 15:
+            while True:
+                b = stream[i]
+                i += 1
+                ml += b
+                if b != 255:
+                    break
+        ml += LZ4_MIN_MATCH
+        if off == 0 or off > window or off > len(out):
+            raise ValueError(f"匹配距离越界：offset={off}")
+        for _ in range(ml):
+            out.append(out[-off])
+    if len(out) != size:
+        raise ValueError(f"解压长度不符：{len(out)} != {size}")
+    return bytes(out)
+
+
+def compress_image(fw: bytes, log_func=print):
+    """
+    压缩固件并用 lz4_decompress 核对一遍，返回 (编码, 传输数据)；
+    压缩后没有变小或核对失败时退回原样传输
+    """
+    t0 = time.time()
+    stream = lz4_compress(fw)
+    try:
+        ok = lz4_decompress(stream, len(fw)) == fw
+    except (ValueError, IndexError):
+        ok = False
+    if not ok:
+        log_func("[!!] 压缩流核对失败，改为原样传输")
+        return UPDATE_ENC_RAW, fw
+    if len(stream) >= len(fw):
+        log_func("[*] 固件压缩后没有变小，原样传输")
+        return UPDATE_ENC_RAW, fw
+    log_func(f"[*] LZ4 压缩：{len(fw)} -> {len(stream)} 字节（{100 * len(stream) / len(fw):.1f}%），"
+             f"耗时 {time.time() - t0:.2f}s")
+    return UPDATE_ENC_LZ4, stream
+
+
+# ===================== 差分升级（和 DeltaPatch.c 对应） =====================
+
+def _delta_extend(old: bytes, new: bytes, op: int, np: int):
+    """
+    从 old[op]、new[np] 开始向后做近似匹配：相同的字节 +1、不同的 -1，
+    取得分最高的位置为匹配长度；得分比最高点低 DELTA_SLACK 时停止。返回 (长度, 得分)
+    """
+    limit = min(len(old) - op, len(new) - np)
+    score = best_score = best_len = 0
+    k = 0
+    while k < limit:
+        score += 1 if old[op + k] == new[np + k] else -1
+        k += 1
+        if score > best_score:
+            best_score, best_len = score, k
+        elif score < best_score - DELTA_SLACK:
+            break
+    return best_len, best_score
+
+
+def delta_diff(old: bytes, new: bytes) -> bytes:
+    """
+    生成 bsdiff 风格的顺序补丁：头部 {magic, 基线大小, 基线CRC, 新固件大小}，之后是若干记录
+    {add_len, extra_len, seek} + add_len 个差值字节（新 - 旧，按字节取模）+ extra_len 个新字节，
+    每条记录结束后基线位置移动 seek。换链接地址、改几个常量时差值几乎全是 0，交给 LZ4 压得很小
+    """
+    index = {}
+    for p in range(len(old) - DELTA_SEED + 1):
+        index.setdefault(old[p:p + DELTA_SEED], []).append(p)
+
+    matches = []               # (new 偏移, old 偏移, 长度)
+    i = 0
+    expect = 0                 # 上一段匹配顺延过来的 old 偏移，改了几个字节后多半从这里接着匹配
+    while i <= len(new) - DELTA_SEED:
+        cands = index.get(new[i:i + DELTA_SEED], [])[-DELTA_MAX_CAND:]
+        if 0 <= expect < len(old):
+            cands = [expect] + cands
+        best_len, best_score, best_op = 0, 0, 0
+        for op in cands:
+            n, score = _delta_extend(old, new, op, i)
+            if score > best_score:
+                best_len, best_score, best_op = n, score, op
+        if best_score < DELTA_SEED:
+            i += 1
+            expect += 1
+            continue
+        matches.append((i, best_op, best_len))
+        i += best_len
+        expect = best_op + best_len
+
+    out = bytearray(struct.pack("<IIII", DELTA_MAGIC, len(old), calc_crc32(old), len(new)))
+    np, op = 0, 0
+    for k in range(len(matches) + 1):
+        m_np, m_op, m_len = matches[k] if k < len(matches) else (len(new), op, 0)
+        # 上一段匹配之后到这段匹配之前的新字节原样放入 extra；第一条记录没有 add 部分
+        extra = new[np:m_np]
+        if k == 0:
+            out += struct.pack("<IIi", 0, len(extra), m_op - op)
+            out += extra
+        else:
+            p_np, p_op, p_len = matches[k - 1]
+            out += struct.pack("<IIi", p_len, len(extra), m_op - (p_op + p_len))
+            out += bytes((new[p_np + j] - old[p_op + j]) & 0xFF for j in range(p_len))
+            out += extra
+        np = m_np + m_len
+        op = m_op
+    return bytes(out)
+
+
+def delta_apply(old: bytes, patch: bytes) -> bytes:
+    """按 delta_diff 的格式打补丁，发送前用来核对；数据错误时抛 ValueError"""
+    magic, base_size, base_crc, size = struct.unpack_from("<IIII", patch)
+    if magic != DELTA_MAGIC or base_size != len(old) or base_crc != calc_crc32(old):
+        raise ValueError("补丁与基线固件不匹配")
+    out = bytearray()
+    i, op = 16, 0
+    while i < len(patch):
+        add_len, extra_len, seek = struct.unpack_from("<IIi", patch, i)
+        i += 12
+        if op < 0 or op + add_len > len(old):
+            raise ValueError(f"基线偏移越界：{op}+{add_len}")
+        out += bytes((old[op + j] + patch[i + j]) & 0xFF for j in range(add_len))
+        i += add_len
+        out += patch[i:i + extra_len]
+        i += extra_len
+        op += add_len + seek
+    if len(out) != size:
+        raise ValueError(f"补丁输出长度不符：{len(out)} != {size}")
+    return bytes(out)
+
+
+def delta_image(base: bytes, fw: bytes, log_func=print):
+    """
+    生成 LZ4 压缩的差分补丁并按设备的解法核对一遍，返回 (UPDATE_ENC_DELTA, 传输数据)；
+    核对失败时返回 None
+    """
+    t0 = time.time()
+    patch = delta_diff(base, fw)
+    stream = lz4_compress(patch)
+    try:
+        ok = delta_apply(base, lz4_decompress(stream, len(patch))) == fw
+    except (ValueError, IndexError, struct.error):
+        ok = False
+    if not ok:
+        log_func("[!!] 差分补丁核对失败，改为整包传输")
+        return None
+    log_func(f"[*] 差分：固件 {len(fw)} 字节，补丁 {len(patch)} 字节，压缩后 {len(stream)} 字节"
+             f"（{100 * len(stream) / len(fw):.1f}%），耗时 {time.time() - t0:.2f}s")
+    return UPDATE_ENC_DELTA, stream
+
+
+def query_boot_info(ser: serial.Serial, log_func=print) -> bool:
+    """
+    END_UPDATE 之后等板子复位重新进入 App，读回备份SRAM邮箱（CMD_QUERY_BOOT），
+    打印本次启动结果和 Bootloader 各阶段耗时。设备未应答（旧固件 / 还在搬运）时返回 False
+    """
+    ser.baudrate = DEFAULT_BAUD            # 复位后设备回到默认波特率
+    deadline = time.time() + BOOT_REPORT_WAIT
+    while time.time() < deadline:
+        time.sleep(0.5)
+        ser.reset_input_buffer()
+        send_frame(ser, CMD_QUERY_BOOT, 0, b"\x00")
+        frame = recv_frame(ser, timeout=1.0)
+        if frame is None or frame[0] != CMD_QUERY_BOOT:
+            continue
+        payload = frame[2]
+        if len(payload) < struct.calcsize(BOOT_INFO_FMT):
+            log_func(f"[ERR] 启动邮箱应答长度错误：len={len(payload)}")
+            return False
+        fields = struct.unpack_from(BOOT_INFO_FMT, payload)
+        magic, _reserved, size, crc, ver, boot_count, result = fields[:7]
+        phase_us = fields[7:12]
+        if magic != BOOT_MAILBOX_MAGIC:
+            log_func("[!!] 设备的启动邮箱无效（掉电后备份SRAM内容丢失？）")
+            return False
+        log_func(f"[*] 启动次数={boot_count}，版本=0x{ver:08X}，大小={size}，CRC=0x{crc:08X}，"
+                 f"结果={BOOT_RESULT_NAMES.get(result, result)}")
+        log_func("[*] Bootloader 耗时(us)：" + "，".join(
+            f"{name}={us}" for name, us in zip(BOOT_PHASE_NAMES, phase_us)))
+        return True
+    log_func("[!!] 等待设备复位后应答启动邮箱超时")
+    return False
+
+
+def rollback(ser: serial.Serial, log_func=print) -> bool:
+    """
+    让设备切回另一个槽中的上一版固件（CMD_ROLLBACK）：设备只追加一条元数据记录并复位，
+    不传输固件。另一个槽里没有有效镜像（从未升级过 / 已被新的下载擦除）时返回 False
+    """
+    info = query_slot(ser, log_func)
+    if info is None or not info["rollback"]:
+        log_func("[ERR] 设备没有可回滚的镜像")
+        return False
+
+    send_frame(ser, CMD_ROLLBACK, 1, b"\x00")
+    if not wait_ack(ser, CMD_ROLLBACK, 1, "ROLLBACK"):
+        return False
+
+    log_func(f"[*] 设备将从槽{SLOT_NAMES[info['target'] & 1]}启动，等待复位...")
+    if query_boot_info(ser, log_func):
+        query_slot(ser, log_func)
+    return True
+
+
+def query_block_crcs(ser: serial.Serial):
+    """
+    分页读取设备运行镜像的块CRC（CMD_QUERY_BLOCK_CRCS），返回 (块大小, 运行镜像大小, [crc, ...])；
+    设备应答异常时返回 None
+    """
+    crcs = []
+    hdr_size = struct.calcsize(BLOCK_CRC_HDR_FMT)
+    while True:
+        send_frame(ser, CMD_QUERY_BLOCK_CRCS, 0, struct.pack("<I", len(crcs)))
+        frame = recv_frame(ser, timeout=ACK_TIMEOUT)
+        if frame is None or frame[0] != CMD_QUERY_BLOCK_CRCS or len(frame[2]) < hdr_size:
+            print("[!!] 设备未应答块CRC查询")
+            return None
+        payload = frame[2]
+        block_size, image_size, first = struct.unpack_from(BLOCK_CRC_HDR_FMT, payload)
+        n = (len(payload) - hdr_size) // 4
+        if first != len(crcs) or block_size == 0:
+            print("[ERR] 块CRC应答错误")
+            return None
+        crcs += struct.unpack_from(f"<{n}I", payload, hdr_size)
+        if n == 0 or len(crcs) * block_size >= image_size:
+            return block_size, image_size, crcs
+
+
+def _reloc_bitmap(old: bytes, new: bytes, delta: int):
+    """
+    old 加上重定位能否得到 new：不同的字都必须正好差 delta（槽地址差）。
+    能则返回位图（每字一位，LSB 先；全0时为空），否则返回 None
+    """
+    bits = bytearray((len(new) + 31) // 32)
+    for p in range(0, len(new), 4):
+        if old[p:p + 4] == new[p:p + 4]:
+            continue
+        if p + 4 > len(new) or (struct.unpack_from("<I", old, p)[0] + delta) & 0xFFFFFFFF != \
+                struct.unpack_from("<I", new, p)[0]:
+            return None
+        bits[p // 32] |= 1 << ((p // 4) & 7)
+    return bytes(bits) if any(bits) else b""
+
+
+def plan_dedup(fw: bytes, block_size: int, image_size: int, crcs, run_fw: bytes = None, delta: int = 0):
+    """
+    逐块比较新镜像和运行镜像的CRC（长度也必须相同），返回 (可由设备复制的区间 [(offset, length, 重定位位图), ...],
+    需要发送的字节数)。fw 按目标槽链接；给出 run_fw（同一次构建里按运行槽链接的那份）时用它和运行镜像比较，
+    链接地址相同才比得上，比上的块与 fw 只差在槽地址差 delta 的字上时，设备复制时按位图修正这些字。
+    相邻的区间合并，单个区间不超过 DEDUP_COPY_MAX
+    """
+    copies = []
+    send = 0
+    for i in range((len(fw) + block_size - 1) // block_size):
+        off = i * block_size
+        n = min(block_size, len(fw) - off)
+        reloc = None
+        if i < len(crcs) and n == min(block_size, image_size - off):
+            if calc_crc32(fw[off:off + n]) == crcs[i]:
+                reloc = b""
+            elif run_fw is not None and len(run_fw) == len(fw) and calc_crc32(run_fw[off:off + n]) == crcs[i]:
+                reloc = _reloc_bitmap(run_fw[off:off + n], fw[off:off + n], delta)
+        if reloc is None:
+            send += n
+            continue
+        # 前一段按整字节的位图拼接，长度必须是32字节的倍数（整块都是）
+        prev = copies[-1] if copies else None
+        if prev and prev[0] + prev[1] == off and prev[1] + n <= DEDUP_COPY_MAX and prev[1] % 32 == 0:
+            bits = b""
+            if prev[2] or reloc:
+                bits = prev[2].ljust(prev[1] // 32, b"\0") + reloc.ljust((n + 31) // 32, b"\0")
+            copies[-1] = (prev[0], prev[1] + n, bits)
+        else:
+            copies.append((off, n, reloc))
+    return copies, send
+
+
+def dedup_cost(copies, send: int, n_crcs: int) -> int:
+    """分块去重的估算流量：变化的块 + 每块4字节的CRC列表 + 每条复制命令约16字节和它的重定位位图"""
+    return send + 4 * n_crcs + sum(16 + len(bits) for _, _, bits in copies)
+
+
+def copy_blocks(ser: serial.Serial, seq: int, copies):
+    """让设备把未变的区间从运行槽复制到目标槽（CMD_COPY_BLOCKS），返回 (是否成功, 下一个 seq)"""
+    for off, n, bits in copies:
+        ok = False
+        for _ in range(MAX_RETRY):
+            send_frame(ser, CMD_COPY_BLOCKS, seq & 0xFF, struct.pack("<II", off, n) + bits)
+            if wait_ack(ser, CMD_COPY_BLOCKS, seq & 0xFF, f"复制 offset={off}, len={n}"):
+                ok = True
+                break
+        seq += 1
+        if not ok:
+            print("[ERR] 设备复制未变的块失败，放弃升级")
+            return False, seq
+    return True, seq
+
+
+def query_resume_offset(ser: serial.Serial, seq: int, total_size: int) -> int:
+    """
+    START_UPDATE 之后查询续传起点：设备保留着同一固件（大小+CRC+版本）的会话时，
+    第一个缺口之前的数据不用再发。设备不支持查询时从0开始
+    """
+    missing = query_missing(ser, seq, total_size)
+    if missing is None:
+        return 0
+    resume = missing[0][0] if missing else total_size
+    if resume > 0:
+        print(f"[*] 续传：设备已有 {resume}/{total_size} 字节，从 offset={resume} 继续")
+    return resume
+
+
+def send_data_stop_and_wait(ser: serial.Serial, fw: bytes, seq: int, chunk_size: int,
+                            start_offset: int = 0):
+    """
+    停等方式发送全部 DATA 帧：每帧等到 ACK 再发下一帧，超时或出错重发，最多 MAX_RETRY 次。
+    返回 (是否成功, 下一个 seq)
+    """
+    offset = start_offset
+    frame_index = 0
+    while offset < len(fw):
+        chunk = fw[offset:offset + chunk_size]
+        payload = struct.pack("<I", offset) + chunk  # [offset | data...]
+        ok = False
+
+        for retry in range(MAX_RETRY):
+            print(f"[-->] 发送数据帧 #{frame_index}, offset={offset}, len={len(chunk)}, 重试={retry}")
+            send_frame(ser, CMD_DATA, seq & 0xFF, payload)
+
+            if wait_ack(ser, CMD_DATA, seq & 0xFF, f"DATA 帧 #{frame_index}"):
+                ok = True
+                break
+            else:
+                print("[!!] 重发该帧")
+
+        if not ok:
+            print("[ERR] 数据帧发送失败，放弃升级")
+            return False, seq
+
+        offset += len(chunk)
+        seq += 1
+        frame_index += 1
+
+    return True, seq
+
+
+def send_data_windowed(ser: serial.Serial, fw: bytes, seq: int, window: int, chunk_size: int,
+                       start_offset: int = 0):
+    """
+    滑动窗口发送全部 DATA 帧。
+    - 最多 window 帧未确认；设备每帧回扩展 ACK（累计确认偏移 + 位图）
+    - 某个缺口被后续应答越过 FAST_RETX_DUPS 次即立即补发，超时则再补发
+    - 帧只靠 offset 识别，seq 只做回显，8 位回绕不影响判断
+    - 续传时从 start_offset 所在的块开始（与设备端窗口起点一致）
+    返回 (是否成功, 下一个 seq)
+    """
+    total_size = len(fw)
+    n_chunks = (total_size + chunk_size - 1) // chunk_size
+    acked = [False] * n_chunks
+    sent_at = [0.0] * n_chunks
+    retries = [0] * n_chunks
+    dups = [0] * n_chunks
+    base = min(start_offset // chunk_size, n_chunks)   # 第一个未确认块
+    next_idx = base     # 下一个从未发送过的块
+    win_ack_size = struct.calcsize(WIN_ACK_FMT)
+
+    def send_chunk(idx: int):
+        nonlocal seq
+        off = idx * chunk_size
+        payload = struct.pack("<I", off) + fw[off:off + chunk_size]
+        send_frame(ser, CMD_DATA, seq & 0xFF, payload)
+        seq += 1
+        sent_at[idx] = time.time()
+        dups[idx] = 0
+
+    while base < n_chunks:
+        # 填满窗口
+        while next_idx < n_chunks and next_idx - base < window:
+            send_chunk(next_idx)
+            next_idx += 1
+
+        frame = recv_frame(ser, timeout=0.2)
+        if frame is not None:
+            cmd, _, payload = frame
+            if cmd == CMD_ACK and len(payload) >= win_ack_size and payload[1] == CMD_DATA:
+                status, _, _, _, ack_offset, sack = struct.unpack(WIN_ACK_FMT, payload[:win_ack_size])
+                if status != COMM_STATUS_OK:
+                    print(f"[ERR] DATA ACK 状态错误：status=0x{status:02X}")
+                    return False, seq
+
+                cum = min((ack_offset + chunk_size - 1) // chunk_size, n_chunks)
+                for i in range(base, cum):
+                    acked[i] = True
+                highest = cum
+                for bit in range(32):
+                    if sack & (1 << bit) and cum + bit < n_chunks:
+                        acked[cum + bit] = True
+                        highest = cum + bit + 1
+                while base < n_chunks and acked[base]:
+                    base += 1
+
+                # 快速重传：后面的块已到，缺口却还在
+                for i in range(base, highest):
+                    if not acked[i]:
+                        dups[i] += 1
+                        if dups[i] == FAST_RETX_DUPS:
+                            print(f"[!!] 快速重传 offset={i * chunk_size}")
+                            send_chunk(i)
+                            dups[i] = FAST_RETX_DUPS + 1   # 等到超时前不再快速重传
+
+                print(f"[OK ] 累计确认 {min(base * chunk_size, total_size)}/{total_size}")
+
+        # 超时重传
+        now = time.time()
+        for i in range(base, next_idx):
+            if not acked[i] and now - sent_at[i] > ACK_TIMEOUT:
+                retries[i] += 1
+                if retries[i] >= MAX_RETRY:
+                    print(f"[ERR] offset={i * chunk_size} 多次重传失败，放弃升级")
+                    return False, seq
+                print(f"[!!] 超时重传 offset={i * chunk_size}, 重试={retries[i]}")
+                send_chunk(i)
+
+    return True, seq
+
+
+def main():
+    # 打开串口
+    try:
+        ser = serial.Serial(PORT, BAUDRATE, timeout=0.1)
+    except Exception as e:
+        print(f"[ERR] 打开串口失败: {e}")
+        return
+
+    time.sleep(0.5)
+
+    try:
+        # 1) 握手
+        caps = handshake(ser)
+        if caps is None:
+            return
+
+        # 回滚只需要一条命令，不传输固件，也不必提速
+        if ROLLBACK or "--rollback" in sys.argv[1:]:
+            rollback(ser)
+            return
+
+        # 1.5) 提速
+        if AUTO_BAUD and caps["flags"] & COMM_CAP_BAUD:
+            negotiate_baud(ser)
+
+        # 1.6) 按下载目标槽选择镜像（槽A: BIN_PATH，槽B: 同目录下的 *_b.bin）
+        fw, info = load_slot_image(ser, BIN_PATH)
+        if fw is None:
+            return
+        if is_running_image(BIN_PATH, info):
+            print("[OK ] 设备已经在运行这个固件，不需要升级")
+            return
+
+        # 整体 CRC 与 MCU 的 FlashCV_CalcCRC 保持一致
+        total_size = len(fw)
+        image_crc = calc_crc32(fw)
+        print(f"[*] 固件大小: {total_size} 字节, CRC32: 0x{image_crc:08X}")
+
+        # 1.7) 设备支持时压缩；之后发送的偏移、缺口、续传都按压缩流计算
+        encoding, data = UPDATE_ENC_RAW, fw
+        if COMPRESS and caps["flags"] & COMM_CAP_LZ4:
+            encoding, data = compress_image(fw)
+
+        # 1.8) 有和设备一致的基线时生成差分补丁，比整包传输小才用
+        if BASE_PATH and caps["flags"] & COMM_CAP_DELTA:
+            base = load_base_image(BASE_PATH, info)
+            delta = delta_image(base, fw) if base is not None else None
+            if delta is not None and len(delta[1]) < len(data):
+                encoding, data = delta
+
+        # 1.9) 分块去重：和运行镜像相同的块由设备本地复制，只发变化的块（原样传输），比上面的方式小才用
+        copies = None
+        if DEDUP and caps["flags"] & COMM_CAP_BLOCKS:
+            blocks = query_block_crcs(ser)
+            if blocks is not None:
+                block_size, image_size, crcs = blocks
+                run_fw, delta = None, 0
+                if info is not None and caps["flags"] & COMM_CAP_RELOC:
+                    run_fw = read_slot_build(BIN_PATH, info["running"])
+                    delta = SLOT_ADDRS[info["target"]] - SLOT_ADDRS[info["running"]]
+                plan, send = plan_dedup(fw, block_size, image_size, crcs, run_fw, delta)
+                cost = dedup_cost(plan, send, len(crcs))
+                print(f"[*] 分块去重：{sum(n for _, n, _ in plan) // 1024}KB 与运行镜像相同，"
+                         f"需要发送 {send} 字节（含查询和复制命令约 {cost} 字节）")
+                if cost < len(data):
+                    encoding, data, copies = UPDATE_ENC_RAW, fw, plan
+
+        # 2) 发送 START_UPDATE（旧固件只解析前 12 字节，设备不支持压缩时不会协商到 LZ4）
+        print("[*] 发送 START_UPDATE...")
+        payload = struct.pack("<IIIII", total_size, image_crc, VERSION, encoding, len(data))
+        seq = 1
+        send_frame(ser, CMD_START_UPDATE, seq, payload)
+
+        if not wait_ack(ser, CMD_START_UPDATE, seq, "START_UPDATE"):
+            return
+
+        # 3) 分块发送数据
+        print("[*] 开始发送固件数据...")
+        seq += 1
+        offset = query_resume_offset(ser, seq, len(data))
+        seq += 1
+
+        if copies is not None:
+            # 先让设备复制未变的块，再按接收位图只补发变化的块
+            ok, seq = copy_blocks(ser, seq, copies)
+            if not ok:
+                return
+            ok, seq = resend_missing(ser, fw, seq, caps["chunk"])
+            if not ok:
+                return
+        elif caps["window"] > 1:
+            print(f"[*] 滑动窗口模式：窗口 {caps['window']} 帧，每帧 {caps['chunk']} 字节")
+            ok, seq = send_data_windowed(ser, data, seq, caps["window"], caps["chunk"],
+                                         start_offset=offset)
+            if not ok:
+                return
+        else:
+            ok, seq = send_data_stop_and_wait(ser, data, seq, CHUNK_SIZE, start_offset=offset)
+            if not ok:
+                return
+
+            # 停等模式下按设备的接收位图核对一遍，只补发缺口
+            ok, seq = resend_missing(ser, data, seq, CHUNK_SIZE)
+            if not ok:
+                return
+
+        print("[*] 固件数据全部发送完成")
+
+        # 4) 发送 END_UPDATE
+        print("[*] 发送 END_UPDATE...")
+
+        dummy_payload = b"\x00"  # 1 字节占位数据，MCU 端不使用它
+        ok = False
+
+        for retry in range(MAX_RETRY):
+            print(f"[-->] 发送 END_UPDATE 帧, 重试={retry}")
+            send_frame(ser, CMD_END_UPDATE, seq & 0xFF, dummy_payload)
+
+            if wait_ack(ser, CMD_END_UPDATE, seq & 0xFF, "END_UPDATE"):
+                ok = True
+                break
+            else:
+                print("[!!] END_UPDATE ACK 异常，准备重发")
+
+        if not ok:
+            print("[ERR] END_UPDATE 多次失败，放弃升级")
+            return
+
+        print("[*] MCU 已接受结束升级请求，接下来会在 Idle 中做整体 CRC 校验 + 提交槽头切换活动槽 + 复位")
+        print("[*] 请等待板子自动重启（BootLoader 直接从新槽启动）")
+        query_boot_info(ser)
+
+    finally:
+        ser.close()
+
+
+if __name__ == "__main__":
+    main()
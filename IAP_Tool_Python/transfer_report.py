@@ -0,0 +1,89 @@
+"""
+连续几次构建之间升级的传输量统计（不需要开发板）。
+
+每个参数是一次构建的输出目录（含 app.bin 和 app_b.bin，也可以直接给 app.bin 的路径），按构建先后排列。
+对每一对相邻的构建（旧 -> 新）、两个升级方向（设备运行槽A、下载到槽B，以及反过来）分别计算：
+  - 整包：新镜像原样发送的字节数
+  - LZ4：compress_image 的压缩流
+  - 差分：delta_image 的 LZ4 压缩补丁（基线是运行槽对应的那份旧镜像）
+  - 去重：plan_dedup 按 1KB 块比较运行槽旧镜像和新构建里按运行槽链接的那份，比上的块带重定位位图复制，
+    估算的流量（变化的块 + CRC列表 + 复制命令和位图）
+编码和核对都用 iap_send.py 里真正的函数，和工具实际发送的一致。
+
+用法：python transfer_report.py <构建1> <构建2> [<构建3> ...]
+"""
+import os
+import sys
+import types
+
+# 只用到编码函数，没装 pyserial 的机器上用一个空模块顶替
+try:
+    import serial  # noqa: F401
+except ImportError:
+    _serial = types.ModuleType("serial")
+    _serial.Serial = object
+    sys.modules["serial"] = _serial
+
+from iap_send import (SLOT_A, SLOT_ADDRS, SLOT_B, SLOT_NAMES, UPDATE_ENC_LZ4,  # noqa: E402
+                      calc_crc32, compress_image, dedup_cost, delta_image, plan_dedup, slot_bin_path)
+
+DEDUP_BLOCK = 1024            # 设备 CMD_QUERY_BLOCK_CRCS 的块大小
+
+
+def load_build(arg: str):
+    """返回 {槽: 镜像}；给的是目录时取其中的 app.bin / app_b.bin"""
+    path = os.path.join(arg, "app.bin") if os.path.isdir(arg) else arg
+    images = {}
+    for slot in (SLOT_A, SLOT_B):
+        with open(slot_bin_path(path, slot), "rb") as f:
+            images[slot] = f.read()
+    return images
+
+
+def dedup_size(base: bytes, fw: bytes, run_fw: bytes, delta: int) -> int:
+    """和 iap_send.main 的估算一致：run_fw 是新构建里按运行槽链接的那份，delta 是目标槽减运行槽的地址差"""
+    crcs = [calc_crc32(base[off:off + DEDUP_BLOCK]) for off in range(0, len(base), DEDUP_BLOCK)]
+    plan, send = plan_dedup(fw, DEDUP_BLOCK, len(base), crcs, run_fw, delta)
+    return dedup_cost(plan, send, len(crcs))
+
+
+def main() -> int:
+    if len(sys.argv) < 3:
+        print(__doc__)
+        return 2
+    quiet = lambda *_: None    # noqa: E731
+    builds = []
+    for arg in sys.argv[1:]:
+        try:
+            builds.append((arg, load_build(arg)))
+        except FileNotFoundError as e:
+            print(f"[ERR] {e}")
+            return 1
+
+    print(f"{'升级':<28} {'槽':>5} | {'整包':>8} {'LZ4':>8} {'差分':>8} {'去重':>8} | {'最小':>8} {'节省':>6}")
+    totals = [0, 0]
+    failed = False
+    for (old_name, old), (new_name, new) in zip(builds, builds[1:]):
+        label = f"{os.path.basename(os.path.normpath(old_name))} -> {os.path.basename(os.path.normpath(new_name))}"
+        for running, target in ((SLOT_A, SLOT_B), (SLOT_B, SLOT_A)):
+            base, fw = old[running], new[target]
+            enc, lz = compress_image(fw, quiet)
+            lz_size = len(lz) if enc == UPDATE_ENC_LZ4 else len(fw)
+            delta = delta_image(base, fw, quiet)
+            failed |= delta is None
+            delta_size = len(delta[1]) if delta is not None else len(fw)
+            dedup = dedup_size(base, fw, new[running], SLOT_ADDRS[target] - SLOT_ADDRS[running])
+            best = min(len(fw), lz_size, delta_size, dedup)
+            totals[0] += len(fw)
+            totals[1] += best
+            slots = f"{SLOT_NAMES[running]}->{SLOT_NAMES[target]}"
+            print(f"{label:<28} {slots:>5} | {len(fw):>8} {lz_size:>8} {delta_size:>8} {dedup:>8} | "
+                  f"{best:>8} {100 - 100 * best / len(fw):>5.1f}%")
+    print(f"合计：整包 {totals[0]} 字节，按最小的方式 {totals[1]} 字节，节省 {100 - 100 * totals[1] / totals[0]:.1f}%")
+    if failed:
+        print("[ERR] 有差分补丁核对失败（按整包计）")
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())